@@ -19,8 +19,9 @@ As long as this comment is preserved at the top of the file
 
 //  Statics
 
-size_t Node::numAdj = 1;
-bool Tape::multi = false;
+thread_local size_t Node::numAdj = 1;
+thread_local bool Tape::multi = false;
+thread_local bool Tape::emulateFloatDers = false;
 
 Tape globalTape;
 thread_local Tape* Number::tape = &globalTape;
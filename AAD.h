@@ -19,11 +19,23 @@ As long as this comment is preserved at the top of the file
 //  So we can instrument Gaussians like standard math functions
 #include "gaussians.h"
 #include <memory>
+#include <numeric>
+#include <iterator>
+#include <type_traits>
 
 //  Use traditional AAD of chapter 10 (false)
 //      or expression templated (AADET) of chapter 15 (true)
 #define AADET   true
 
+//  Precision of the local derivatives stored on tape:
+//      double (false) or float (true)
+//  Adjoints are accumulated in double either way
+//  Float halves the memory and bandwidth of derivatives in the backward sweep,
+//      the resulting error on risks is measured by precisionReport() in main.h
+#ifndef AADFLOATDERS
+#define AADFLOATDERS    false
+#endif
+
 #if AADET
 
 #include "AADExpr.h"
@@ -37,24 +49,54 @@ As long as this comment is preserved at the top of the file
 //  Routines for multi-dimensional AAD (chapter 14)
 //  Set static context for multi-dimensional AAD
 
-//	RAII: reset dimension 1 on destruction
+//	RAII: reset previous dimension on destruction, 
+//      1 unless set in an enclosing scope
+//  The context is thread local, parallel tasks set their own, see mcBase.h
 struct numResultsResetterForAAD
 {
+	const bool		prevMulti;
+	const size_t	prevNumAdj;
+
+	numResultsResetterForAAD(const bool multi, const size_t numAdj) :
+		prevMulti(multi), prevNumAdj(numAdj) {}
+
 	~numResultsResetterForAAD()
 	{
-		Tape::multi = false;
-		Node::numAdj = 1;
+		Tape::multi = prevMulti;
+		Node::numAdj = prevNumAdj;
 	}
 };
 
 //  Routine: set dimension and get RAII resetter
 inline auto setNumResultsForAAD(const bool multi = false, const size_t numResults = 1)
 {
+	auto resetter = make_unique<numResultsResetterForAAD>(Tape::multi, Node::numAdj);
 	Tape::multi = multi;
 	Node::numAdj = numResults;
-	return make_unique<numResultsResetterForAAD>();
+	return resetter;
 }
 
+//  Diagnostics: float derivatives emulated on this thread, see Tape::emulateFloatDers
+//  RAII: reset previous setting on destruction
+//  Thread local like the dimension, parallel tasks set the one of their calculation
+struct floatDersEmulation
+{
+	const bool		prevEmulate;
+
+	floatDersEmulation(const bool emulate) : prevEmulate(Tape::emulateFloatDers)
+	{
+		Tape::emulateFloatDers = emulate;
+	}
+
+	~floatDersEmulation()
+	{
+		Tape::emulateFloatDers = prevEmulate;
+	}
+
+	floatDersEmulation(const floatDersEmulation&) = delete;
+	floatDersEmulation& operator=(const floatDersEmulation&) = delete;
+};
+
 //  Other utilities
 
 //	Put collection on tape
@@ -72,3 +114,63 @@ inline void convertCollection(It1 srcBegin, It1 srcEnd, It2 destBegin)
     transform(srcBegin, srcEnd, destBegin, 
         [](const auto& source) { return destType(source); });
 }
+
+//  Fused sums and inner products
+//  With Numbers, record one node with n arguments and constant derivatives
+//      in place of the n - 1 additions and n multiplications 
+//      of the standard algorithms
+//  With doubles, same as the standard algorithms
+
+//  Sum of a range
+template <class It>
+inline auto sum(It first, It last)
+{
+    using T = remove_const_t<typename iterator_traits<It>::value_type>;
+    if constexpr (is_same_v<T, Number>)
+    {
+        return Number::linearNode(first, distance(first, last), nullptr);
+    }
+    else
+    {
+        return accumulate(first, last, T(0.0));
+    }
+}
+
+//  Inner product of a range with weights
+//  Fused when one side is Number and the other double,
+//      Number by Number falls back to the standard algorithm
+template <class It, class WIt, class = enable_if_t<!is_integral_v<WIt>>>
+inline auto dot(It first, It last, WIt weights)
+{
+    using T = remove_const_t<typename iterator_traits<It>::value_type>;
+    using W = remove_const_t<typename iterator_traits<WIt>::value_type>;
+    if constexpr (is_same_v<T, Number> && is_same_v<W, double>)
+    {
+        return Number::linearNode(first, distance(first, last), weights);
+    }
+    else if constexpr (is_same_v<T, double> && is_same_v<W, Number>)
+    {
+        const size_t n = distance(first, last);
+        return Number::linearNode(weights, n, first);
+    }
+    else
+    {
+        return inner_product(first, last, weights, conditional_t<is_same_v<W, Number>, W, T>(0.0));
+    }
+}
+
+//  accumulate() on Numbers, fused
+template <class It>
+inline Number accumulate(It first, It last, const Number& init)
+{
+    return init + sum(first, last);
+}
+
+//  inner_product() of Numbers and doubles, fused
+template <class It, class WIt, class = enable_if_t<
+    is_same_v<remove_const_t<typename iterator_traits<It>::value_type>, Number>
+    && is_same_v<remove_const_t<typename iterator_traits<WIt>::value_type>, double>>>
+inline Number inner_product(It first, It last, WIt weights, const Number& init)
+{
+    return init + dot(first, last, weights);
+}
@@ -94,7 +94,7 @@ public:
         //  Push on the left
         if (LHS::numNumbers > 0)
         {
-            lhs.pushAdjoint<N, n>(
+            lhs.template pushAdjoint<N, n>(
                 exprNode, 
                 adjoint * OP::leftDerivative(lhs.value(), rhs.value(), value()));
         }
@@ -104,7 +104,7 @@ public:
         {
             //  Note left push processed LHS::numNumbers numbers
             //  So the next number to be processed is n + LHS::numNumbers
-            rhs.pushAdjoint<N, n + LHS::numNumbers>(
+            rhs.template pushAdjoint<N, n + LHS::numNumbers>(
                 exprNode, 
                 adjoint * OP::rightDerivative(lhs.value(), rhs.value(), value()));
         }
@@ -352,7 +352,7 @@ public:
         //  Push into argument
         if (ARG::numNumbers > 0)
         {
-            arg.pushAdjoint<N, n>(
+            arg.template pushAdjoint<N, n>(
                 exprNode, 
                 adjoint * OP::derivative(arg.value(), value(), dArg));
         }
@@ -417,6 +417,34 @@ struct OPFabs
     }
 };
 
+struct OPSin
+{
+    static const double eval(const double r, const double d)
+    {
+        return sin(r);
+    }
+
+    static const double derivative
+    (const double r, const double v, const double d)
+    {
+        return cos(r);
+    }
+};
+
+struct OPCos
+{
+    static const double eval(const double r, const double d)
+    {
+        return cos(r);
+    }
+
+    static const double derivative
+    (const double r, const double v, const double d)
+    {
+        return -sin(r);
+    }
+};
+
 struct OPNormalDens
 {
     static const double eval(const double r, const double d)
@@ -623,6 +651,18 @@ UnaryExpression<ARG, OPFabs> fabs(const Expression<ARG>& arg)
     return UnaryExpression<ARG, OPFabs>(arg);
 }
 
+template <class ARG>
+UnaryExpression<ARG, OPSin> sin(const Expression<ARG>& arg)
+{
+    return UnaryExpression<ARG, OPSin>(arg);
+}
+
+template <class ARG>
+UnaryExpression<ARG, OPCos> cos(const Expression<ARG>& arg)
+{
+    return UnaryExpression<ARG, OPCos>(arg);
+}
+
 template <class ARG>
 UnaryExpression<ARG, OPNormalDens> normalDens(const Expression<ARG>& arg)
 {
@@ -879,7 +919,7 @@ class Number : public Expression<Number>
         auto* node = createMultiNode<E::numNumbers>();
         
         //  Push adjoints through expression with adjoint = 1 on top
-        static_cast<const E&>(e).pushAdjoint<E::numNumbers, 0>(*node, 1.0);
+        static_cast<const E&>(e).template pushAdjoint<E::numNumbers, 0>(*node, 1.0);
 
         //  Set my node
         myNode = node;
@@ -906,10 +946,10 @@ public:
         //  note n: index of this number on the node on tape
 
         //  Register adjoint
-        exprNode.pAdjPtrs[n] = Tape::multi? myNode->pAdjoints : &myNode->mAdjoint;
+        exprNode.pAdjPtrs[n] = tape->adjPtr(*myNode);
 		
         //  Register derivative
-        exprNode.pDerivatives[n] = adjoint;
+        exprNode.pDerivatives[n] = static_cast<Derivative>(adjoint);
     }
 
     //  Static access to tape, same as traditional
@@ -960,6 +1000,60 @@ public:
     explicit operator double& () { return myValue; }
     explicit operator double () const { return myValue; }
 
+    //  Fused linear node: constant + sum of weights[i] * args[i], i < n
+    //      recorded as one node with n arguments and constant derivatives,
+    //      in place of a chain of binary nodes
+    //  Weights are doubles, nullptr for a plain sum
+    //  Used by sum(), dot() and accumulate(), see AAD.h
+    template <class It, class WIt>
+    static Number linearNode(
+        It                  args,
+        const size_t        n,
+        WIt                 weights,
+        const double        constant = 0.0)
+    {
+        constexpr bool weighted = !is_same_v<WIt, nullptr_t>;
+
+        //  Split nodes that don't fit in a block of the tape
+        if (n > Tape::maxArgs)
+        {
+            const size_t half = n / 2;
+            Number lo, hi;
+            if constexpr (weighted)
+            {
+                lo = linearNode(args, half, weights, constant);
+                hi = linearNode(next(args, half), n - half, next(weights, half));
+            }
+            else
+            {
+                lo = linearNode(args, half, nullptr, constant);
+                hi = linearNode(next(args, half), n - half, nullptr);
+            }
+            return lo + hi;
+        }
+
+        Number result;
+        result.myValue = constant;
+        result.myNode = tape->recordNode(n);
+        Node& node = *result.myNode;
+
+        for (size_t i = 0; i < n; ++i, ++args)
+        {
+            double w = 1.0;
+            if constexpr (weighted)
+            {
+                w = *weights;
+                ++weights;
+            }
+            const Number& arg = *args;
+            result.myValue += w * arg.myValue;
+            node.pDerivatives[i] = static_cast<Derivative>(w);
+            node.pAdjPtrs[i] = tape->adjPtr(*arg.myNode);
+        }
+
+        return result;
+    }
+
     //  All the normal accessors and propagators, same as traditional 
     
     //  Put on tape
@@ -999,6 +1093,19 @@ public:
         return myNode->adjoint(n);
     }
 
+    //  Hand-coded adjoints, see Model::generatePathAdjoint()
+    //  Number of adjoints per node, the number of results in the multi-dimensional case
+    static size_t numAdjoints()
+    {
+        return Tape::multi ? Node::numAdj : 1;
+    }
+    //  Pointer to the numAdjoints() adjoints of this number, as seen from the tape:
+    //      numbers in a shared region have private adjoints, see Tape::share()
+    double* adjointPtr() const
+    {
+        return tape->adjPtr(*myNode);
+    }
+
 	//  Reset all adjoints on the tape
 	//		note we don't use this method
 	void resetAdjoints()
@@ -1008,19 +1115,34 @@ public:
 
     //  Propagation
 
-    //  Propagate adjoints
-    //      from and to both INCLUSIVE
-    static void propagateAdjoints(
-		Tape::iterator propagateFrom,
-		Tape::iterator propagateTo)
+    //  Backward sweep from and to both INCLUSIVE
+    //  Multi: all adjoints, chapter 14, otherwise one
+    //  RoundDers: see Tape::emulateFloatDers
+    template <bool Multi, bool RoundDers>
+    static void sweep(
+        Tape::iterator propagateFrom,
+        Tape::iterator propagateTo)
     {
         auto it = propagateFrom;
         while (it != propagateTo)
         {
-            it->propagateOne();
+            if constexpr (Multi) it->template propagateAll<RoundDers>();
+            else it->template propagateOne<RoundDers>();
+            if (it.firstInBlock()) tape->releaseAfter(*it);
             --it;
         }
-        it->propagateOne();
+        if constexpr (Multi) it->template propagateAll<RoundDers>();
+        else it->template propagateOne<RoundDers>();
+    }
+
+    //  Propagate adjoints
+    //      from and to both INCLUSIVE
+    static void propagateAdjoints(
+		Tape::iterator propagateFrom,
+		Tape::iterator propagateTo)
+    {
+        if (Tape::emulateFloatDers) sweep<false, true>(propagateFrom, propagateTo);
+        else sweep<false, false>(propagateFrom, propagateTo);
     }
 
     //  Convenient overloads
@@ -1034,14 +1156,9 @@ public:
         //  Set this adjoint to 1
         adjoint() = 1.0;
         //  Find node on tape
-        auto it = tape->find(myNode);
+        auto propagateFrom = tape->find(myNode);
         //  Reverse and propagate until we hit the stop
-        while (it != propagateTo)
-        {
-            it->propagateOne();
-            --it;
-        }
-        it->propagateOne();
+        propagateAdjoints(propagateFrom, propagateTo);
     }
 
     //  These 2 set the adjoint to 1 on this node
@@ -1069,13 +1186,8 @@ public:
 		Tape::iterator propagateFrom,
 		Tape::iterator propagateTo)
     {
-        auto it = propagateFrom;
-        while (it != propagateTo)
-        {
-            it->propagateAll();
-            --it;
-        }
-        it->propagateAll();
+        if (Tape::emulateFloatDers) sweep<true, true>(propagateFrom, propagateTo);
+        else sweep<true, false>(propagateFrom, propagateTo);
     }
 
     //  Unary operators
@@ -26,6 +26,13 @@ As long as this comment is preserved at the top of the file
 #include <exception>
 using namespace std;
 
+//  Storage type of local derivatives, see AAD.h
+#if AADFLOATDERS
+using Derivative = float;
+#else
+using Derivative = double;
+#endif
+
 class Node 
 {
 	friend class Tape;
@@ -42,14 +49,16 @@ class Node
 	//  Data lives in separate memory
 
     //  the n derivatives to arguments,
-    double*         pDerivatives;    
+    Derivative*     pDerivatives;    
 
     //  the n pointers to the adjoints of arguments
     double**        pAdjPtrs;
 
     //  Number of adjoints (results) to propagate, usually 1
     //  See chapter 14
-    static size_t   numAdj;
+    //  Thread local, so calculations on different threads don't interfere,
+    //      parallel tasks set it on their worker thread
+    static thread_local size_t   numAdj;
 
     //  Number of childs (arguments)
     const size_t    n;
@@ -67,9 +76,21 @@ public:
 	//	multi
 	double& adjoint(const size_t n) { return pAdjoints[n]; }
     
+    //  Local derivative i in double
+    //  RoundDers: rounded to float, 
+    //      emulates float storage in a double build, see Tape::emulateFloatDers
+    template <bool RoundDers = false>
+    double derivative(const size_t i) const
+    {
+        return RoundDers 
+            ? static_cast<double>(static_cast<float>(pDerivatives[i])) 
+            : static_cast<double>(pDerivatives[i]);
+    }
+
     //  Back-propagate adjoints to arguments adjoints
 
     //  Single case, chapter 10
+    template <bool RoundDers = false>
     void propagateOne() 
 {
 		//  Nothing to propagate
@@ -77,26 +98,39 @@ public:
 
 		for (size_t i = 0; i < n; ++i)
         {
-			*(pAdjPtrs[i]) += pDerivatives[i] * mAdjoint;
+			*(pAdjPtrs[i]) += derivative<RoundDers>(i) * mAdjoint;
         }
     }
 
     //  Multi case, chapter 14
+    //  Only the range of non-zero adjoints is propagated:
+    //      when payoffs depend on parameters sparsely, 
+    //      e.g. European options of increasing maturities in Dupire,
+    //      most nodes only contribute to a few contiguous payoffs
+    template <bool RoundDers = false>
     void propagateAll()
 {
+        //  Nothing to propagate
+        if (!n) return;
+
+        //  Range of non-zero adjoints
+        size_t lo = 0, hi = numAdj;
+        while (lo < hi && !pAdjoints[lo]) ++lo;
         //  No adjoint to propagate
-        if (!n || all_of(pAdjoints, pAdjoints + numAdj,
-            [](const double& x) { return !x; }))
-            return;
+        if (lo == hi) return;
+        while (!pAdjoints[hi - 1]) --hi;
+
+        const double* adjoints = pAdjoints + lo;
+        const size_t m = hi - lo;
 
         for (size_t i = 0; i < n; ++i)
         {
-            double *adjPtrs = pAdjPtrs[i], ders = pDerivatives[i];
+            double *adjPtrs = pAdjPtrs[i] + lo, ders = derivative<RoundDers>(i);
 
             //  Vectorized!
-            for (size_t j = 0; j < numAdj; ++j)
+            for (size_t j = 0; j < m; ++j)
             {
-                adjPtrs[j] += ders * pAdjoints[j];
+                adjPtrs[j] += ders * adjoints[j];
             }
         }
     }
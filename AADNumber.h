@@ -62,9 +62,9 @@ class Number
 
     //	Convenient access to node data for friends
 
-    double& derivative() { return myNode->pDerivatives[0]; }
-    double& lDer() { return myNode->pDerivatives[0]; }
-    double& rDer() { return myNode->pDerivatives[1]; }
+    Derivative& derivative() { return myNode->pDerivatives[0]; }
+    Derivative& lDer() { return myNode->pDerivatives[0]; }
+    Derivative& rDer() { return myNode->pDerivatives[1]; }
 
     double*& adjPtr() { return myNode->pAdjPtrs[0]; }
     double*& leftAdj() { return myNode->pAdjPtrs[0]; }
@@ -78,9 +78,7 @@ class Number
     {
         createNode<1>();
 
-		myNode->pAdjPtrs[0] = Tape::multi
-			? arg.pAdjoints 
-			: &arg.mAdjoint;
+		myNode->pAdjPtrs[0] = tape->adjPtr(arg);
     }
 
 	//	Binary
@@ -89,16 +87,8 @@ class Number
 	{
         createNode<2>();
         
-        if (Tape::multi)
-		{
-			myNode->pAdjPtrs[0] = lhs.pAdjoints;
-			myNode->pAdjPtrs[1] = rhs.pAdjoints;
-		}
-		else
-    {
-			myNode->pAdjPtrs[0] = &lhs.mAdjoint;
-			myNode->pAdjPtrs[1] = &rhs.mAdjoint;
-		}
+		myNode->pAdjPtrs[0] = tape->adjPtr(lhs);
+		myNode->pAdjPtrs[1] = tape->adjPtr(rhs);
     }
 
 public:
@@ -136,6 +126,60 @@ public:
     explicit operator double& () { return myValue; }
     explicit operator double() const { return myValue; }
 
+    //  Fused linear node: constant + sum of weights[i] * args[i], i < n
+    //      recorded as one node with n arguments and constant derivatives,
+    //      in place of a chain of binary nodes
+    //  Weights are doubles, nullptr for a plain sum
+    //  Used by sum(), dot() and accumulate(), see AAD.h
+    template <class It, class WIt>
+    static Number linearNode(
+        It                  args,
+        const size_t        n,
+        WIt                 weights,
+        const double        constant = 0.0)
+    {
+        constexpr bool weighted = !is_same_v<WIt, nullptr_t>;
+
+        //  Split nodes that don't fit in a block of the tape
+        if (n > Tape::maxArgs)
+        {
+            const size_t half = n / 2;
+            Number lo, hi;
+            if constexpr (weighted)
+            {
+                lo = linearNode(args, half, weights, constant);
+                hi = linearNode(next(args, half), n - half, next(weights, half));
+            }
+            else
+            {
+                lo = linearNode(args, half, nullptr, constant);
+                hi = linearNode(next(args, half), n - half, nullptr);
+            }
+            return lo + hi;
+        }
+
+        Number result;
+        result.myValue = constant;
+        result.myNode = tape->recordNode(n);
+        Node& node = *result.myNode;
+
+        for (size_t i = 0; i < n; ++i, ++args)
+        {
+            double w = 1.0;
+            if constexpr (weighted)
+            {
+                w = *weights;
+                ++weights;
+            }
+            const Number& arg = *args;
+            result.myValue += w * arg.myValue;
+            node.pDerivatives[i] = static_cast<Derivative>(w);
+            node.pAdjPtrs[i] = tape->adjPtr(*arg.myNode);
+        }
+
+        return result;
+    }
+
     //  Accessors: value and adjoint
 
     double& value()
@@ -165,6 +209,19 @@ public:
 		return myNode->adjoint(n);
     }
 
+    //  Hand-coded adjoints, see Model::generatePathAdjoint()
+    //  Number of adjoints per node, the number of results in the multi-dimensional case
+    static size_t numAdjoints()
+    {
+        return Tape::multi ? Node::numAdj : 1;
+    }
+    //  Pointer to the numAdjoints() adjoints of this number, as seen from the tape:
+    //      numbers in a shared region have private adjoints, see Tape::share()
+    double* adjointPtr() const
+    {
+        return tape->adjPtr(*myNode);
+    }
+
     //  Reset all adjoints on the tape
 	//		note we don't use this method
     void resetAdjoints()
@@ -174,19 +231,34 @@ public:
 
 	//  Propagation
 
-    //  Propagate adjoints
-    //      from and to both INCLUSIVE
-    static void propagateAdjoints(
+    //  Backward sweep from and to both INCLUSIVE
+    //  Multi: all adjoints, chapter 14, otherwise one
+    //  RoundDers: see Tape::emulateFloatDers
+    template <bool Multi, bool RoundDers>
+    static void sweep(
         Tape::iterator propagateFrom,
         Tape::iterator propagateTo)
     {
         auto it = propagateFrom;
         while (it != propagateTo)
         {
-            it->propagateOne();
+            if constexpr (Multi) it->template propagateAll<RoundDers>();
+            else it->template propagateOne<RoundDers>();
+            if (it.firstInBlock()) tape->releaseAfter(*it);
             --it;
         }
-        it->propagateOne();
+        if constexpr (Multi) it->template propagateAll<RoundDers>();
+        else it->template propagateOne<RoundDers>();
+    }
+
+    //  Propagate adjoints
+    //      from and to both INCLUSIVE
+    static void propagateAdjoints(
+        Tape::iterator propagateFrom,
+        Tape::iterator propagateTo)
+    {
+        if (Tape::emulateFloatDers) sweep<false, true>(propagateFrom, propagateTo);
+        else sweep<false, false>(propagateFrom, propagateTo);
     }
 
     //  Convenient overloads
@@ -227,13 +299,8 @@ public:
 		Tape::iterator propagateFrom,
 		Tape::iterator propagateTo)
 	{
-		auto it = propagateFrom;
-		while (it != propagateTo)
-		{
-			it->propagateAll();
-			--it;
-		}
-		it->propagateAll();
+		if (Tape::emulateFloatDers) sweep<true, true>(propagateFrom, propagateTo);
+		else sweep<true, false>(propagateFrom, propagateTo);
     }
 
     //  Operator overloading
@@ -571,6 +638,28 @@ public:
         return result;
     }
 
+    inline friend Number sin(const Number& arg)
+    {
+        const double e = sin(arg.value());
+        //  Eagerly evaluate and put on tape
+		Number result(arg.node(), e);
+        //  Eagerly compute derivatives
+		result.derivative() = cos(arg.value());
+
+        return result;
+    }
+
+    inline friend Number cos(const Number& arg)
+    {
+        const double e = cos(arg.value());
+        //  Eagerly evaluate and put on tape
+		Number result(arg.node(), e);
+        //  Eagerly compute derivatives
+		result.derivative() = -sin(arg.value());
+
+        return result;
+    }
+
     inline friend Number normalDens(const Number& arg)
     {
         const double e = normalDens(arg.value());
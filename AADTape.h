@@ -25,26 +25,166 @@ As long as this comment is preserved at the top of the file
 
 #include "blocklist.h"
 #include "AADNode.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 constexpr size_t BLOCKSIZE  = 16384;		//	Number of nodes
 constexpr size_t ADJSIZE    = 32768;		//	Number of adjoints
 constexpr size_t DATASIZE   = 65536;		//	Data in bytes
 
+//  Region of a tape recorded once and read by other tapes, see Tape::share()
+//  Nodes are indexed in the order of the tape,
+//      by runs of contiguous nodes, one per block
+class SharedRegion
+{
+    struct Run
+    {
+        Node*   first;
+        size_t  size;
+        size_t  index;
+    };
+
+    //  In the order of the tape, and sorted by address for lookups
+    vector<Run>     myRuns;
+    vector<Run>     myRunsByAddress;
+    size_t          mySize;
+    //  Address span of the nodes
+    const Node*     myLo = nullptr;
+    const Node*     myHi = nullptr;
+
+public:
+
+    static constexpr size_t npos = size_t(-1);
+
+    //  Nodes in [from, to)
+    template <class It>
+    SharedRegion(It from, const It to) : mySize(0)
+    {
+        for (; from != to; ++from)
+        {
+            Node* node = &*from;
+            if (myRuns.empty() || node != myRuns.back().first + myRuns.back().size)
+            {
+                myRuns.push_back({ node, 0, mySize });
+            }
+            ++myRuns.back().size;
+            ++mySize;
+        }
+
+        myRunsByAddress = myRuns;
+        sort(myRunsByAddress.begin(), myRunsByAddress.end(), 
+            [](const Run& a, const Run& b) { return less<const Node*>()(a.first, b.first); });
+
+        if (!myRunsByAddress.empty())
+        {
+            myLo = myRunsByAddress.front().first;
+            for (const Run& run : myRunsByAddress)
+            {
+                myHi = max(myHi, static_cast<const Node*>(run.first + run.size), less<const Node*>());
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return mySize;
+    }
+
+    //  Is the node within the address span of the region
+    //  Cheap test before find(), nodes outside can't be in the region
+    bool spans(const Node* node) const
+    {
+        return !less<const Node*>()(node, myLo) && less<const Node*>()(node, myHi);
+    }
+
+    //  Index of a node, npos if not in the region
+    size_t find(const Node* node) const
+    {
+        if (!spans(node)) return npos;
+        auto it = upper_bound(myRunsByAddress.begin(), myRunsByAddress.end(), node,
+            [](const Node* n, const Run& r) { return less<const Node*>()(n, r.first); });
+        if (it == myRunsByAddress.begin()) return npos;
+        --it;
+        const size_t k = (uintptr_t(node) - uintptr_t(it->first)) / sizeof(Node);
+        return k < it->size ? it->index + k : npos;
+    }
+
+    //  Add adjoints indexed like the region, numAdj per node, 
+    //      to the adjoints of its nodes
+    void addAdjoints(const vector<double>& adjoints, const bool multi, const size_t numAdj) const
+    {
+        const double* adj = adjoints.data();
+        for (const Run& run : myRuns)
+        {
+            for (Node* node = run.first; node != run.first + run.size; ++node)
+            {
+                if (multi)
+                {
+                    for (size_t j = 0; j < numAdj; ++j) node->adjoint(j) += adj[j];
+                    adj += numAdj;
+                }
+                else
+                {
+                    node->adjoint() += *adj++;
+                }
+            }
+        }
+    }
+
+    //  One adjoint per node, see AADRiskBatches in mcBase.h
+
+    //  Add the adjoints of the nodes to adjoints indexed like the region,
+    //      and reset them to 0
+    void takeAdjoints(vector<double>& adjoints) const
+    {
+        double* adj = adjoints.data();
+        for (const Run& run : myRuns)
+        {
+            for (Node* node = run.first; node != run.first + run.size; ++node)
+            {
+                *adj++ += node->adjoint();
+                node->adjoint() = 0.0;
+            }
+        }
+    }
+
+    //  Set the adjoints of the nodes
+    void setAdjoints(const vector<double>& adjoints) const
+    {
+        const double* adj = adjoints.data();
+        for (const Run& run : myRuns)
+        {
+            for (Node* node = run.first; node != run.first + run.size; ++node)
+            {
+                node->adjoint() = *adj++;
+            }
+        }
+    }
+};
+
 class Tape
 {
 	//	Working with multiple results / adjoints?
-	static bool							multi;
+	//	Thread local, like Node::numAdj
+	static thread_local bool			multi;
 
 	//  Storage for adjoints in multi-dimensional case (chapter 14)
     blocklist<double, ADJSIZE>			myAdjointsMulti;
     
 	//  Storage for derivatives and child adjoint pointers
-	blocklist<double, DATASIZE>			myDers;
+	//	Derivatives in float or double, see AAD.h
+	blocklist<Derivative, DATASIZE>		myDers;
 	blocklist<double*, DATASIZE>		myArgPtrs;
 
     //  Storage for the nodes
 	blocklist<Node, BLOCKSIZE>		    myNodes;
 
+    //  Region of another tape read by this one, see share()
+    const SharedRegion*                 myShared = nullptr;
+    //  and the adjoints of its nodes, private to this tape
+    vector<double>                      mySharedAdjoints;
+
 	//	Padding so tapes in a vector don't interfere
     char                                myPad[64];
 
@@ -54,6 +194,13 @@ class Tape
 
 public:
 
+	//	Diagnostics: round local derivatives to float in the backward sweep,
+	//		so a double build reproduces the risks of a float build exactly,
+	//		see precisionReport() in main.h
+	//	Thread local, like multi, so it only applies to the calculation that sets it,
+	//		parallel tasks set the one of their calculation, see floatDersEmulation in AAD.h
+	static thread_local bool			emulateFloatDers;
+
     //  Build note in place and return a pointer
 	//	N : number of childs (arguments)
     template <size_t N>
@@ -80,6 +227,76 @@ public:
         return node;
     }
 
+    //  Same with the number of arguments known at run time
+    //  Used for fused n-ary sums and inner products, see AAD.h
+    //  N is limited to maxArgs
+    static constexpr size_t maxArgs = DATASIZE;
+
+    Node* recordNode(const size_t N)
+    {
+        Node* node = myNodes.emplace_back(N);
+
+        if (multi)
+        {
+            node->pAdjoints = myAdjointsMulti.emplace_back_multi(Node::numAdj);
+            fill(node->pAdjoints, node->pAdjoints + Node::numAdj, 0.0);
+        }
+
+        if (N)
+        {
+            node->pDerivatives = myDers.emplace_back_multi(N);
+            node->pAdjPtrs = myArgPtrs.emplace_back_multi(N);
+        }
+
+        return node;
+    }
+
+    //  Pointer to the adjoint(s) of the argument of a node being recorded
+    //  Arguments in the shared region, if any, 
+    //      accumulate into the private adjoints of this tape
+    //  Arguments outside the span of the region, or in the block being recorded,
+    //      the vast majority, skip the lookup
+    double* adjPtr(Node& arg)
+    {
+        if (myShared && myShared->spans(&arg) && !myNodes.inCurrentBlock(&arg))
+        {
+            const size_t i = myShared->find(&arg);
+            if (i != SharedRegion::npos) return mySharedAdjoints.data() + i * Node::numAdj;
+        }
+        return multi ? arg.pAdjoints : &arg.mAdjoint;
+    }
+
+    //  Read the nodes of a region of another tape, instead of recording them again
+    //  Typically the model parameters and initialization, before the mark,
+    //      recorded once and shared by the tapes of the threads of a simulation
+    //  Clears this tape and marks it at the start
+    //  The region is only read: this tape propagates into private adjoints,
+    //      added to the region with mergeShared() once all tapes are done, 
+    //      before the region itself is propagated, once
+    //  The number of results for AAD must be set as it will be for recording
+    void share(const SharedRegion& region)
+    {
+        clear();
+        myShared = &region;
+        mySharedAdjoints.assign(region.size() * (multi ? Node::numAdj : 1), 0.0);
+        mark();
+    }
+
+    void mergeShared() const
+    {
+        if (myShared) myShared->addAdjoints(mySharedAdjoints, multi, Node::numAdj);
+    }
+
+    //  Add the private adjoints of the region to adjoints, and reset them to 0
+    void takeShared(vector<double>& adjoints)
+    {
+        for (size_t i = 0; i < mySharedAdjoints.size(); ++i)
+        {
+            adjoints[i] += mySharedAdjoints[i];
+        }
+        fill(mySharedAdjoints.begin(), mySharedAdjoints.end(), 0.0);
+    }
+
     //  Reset all adjoints to 0
 	void resetAdjoints()
 	{
@@ -94,6 +311,7 @@ public:
 				node.mAdjoint = 0;
 			}
 		}
+        fill(mySharedAdjoints.begin(), mySharedAdjoints.end(), 0.0);
 	}
 
     //  Clear
@@ -103,6 +321,8 @@ public:
 		myDers.clear();
 		myArgPtrs.clear();
         myNodes.clear();
+        myShared = nullptr;
+        mySharedAdjoints.clear();
     }
 
     //  Rewind
@@ -155,10 +375,38 @@ public:
 		myNodes.rewind_to_mark();
     }
 
+    //  Out-of-core tapes, see blocklist.h
+    //  Backward sweep: drop from RAM the data recorded after the node
+    void releaseAfter(const Node& node)
+    {
+        if (node.n)
+        {
+            myDers.releaseAfter(node.pDerivatives);
+            myArgPtrs.releaseAfter(node.pAdjPtrs);
+        }
+        if (multi)
+        {
+            myAdjointsMulti.releaseAfter(node.pAdjoints);
+        }
+    }
+
     //  Iterators
     
     using iterator = blocklist<Node, BLOCKSIZE>::iterator;
 
+    //  Diagnostics, see mcCost.h
+    //  Number of nodes and of their arguments in [from, to)
+    pair<size_t, size_t> footprint(iterator from, const iterator to)
+    {
+        size_t nodes = 0, args = 0;
+        for (; from != to; ++from)
+        {
+            ++nodes;
+            args += from->n;
+        }
+        return { nodes, args };
+    }
+
     auto begin()
     {
         return myNodes.begin();
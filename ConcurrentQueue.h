@@ -3,19 +3,39 @@
 //  Concurrent queue of chapter 3, 
 //  Used in the thread pool
 
+//  With Levels > 1, the queue holds one lane per priority level,
+//      0 being the highest: pop() serves the lanes in order of priority,
+//      first in first out within a lane
+
+//  pop() may also stop waiting on a condition of the caller,
+//      checked again when wakeAll() is called,
+//      used by the thread pool to retire idle workers
+
 #include <queue>
 #include <mutex>
+#include <condition_variable>
 using namespace std;
 
-template <class T>
+template <class T, size_t Levels = 1>
 class ConcurrentQueue
 {
 
-    queue<T> myQueue;
+    queue<T> myQueues[Levels];
 	mutable mutex myMutex;
 	condition_variable myCV;
 	bool myInterrupt;
 
+    //  Highest priority non-empty lane up to maxLevel, or Levels if none
+    //  Call under lock
+    size_t firstLane(const size_t maxLevel = Levels - 1) const
+    {
+        for (size_t l = 0; l <= maxLevel; ++l)
+        {
+            if (!myQueues[l].empty()) return l;
+        }
+        return Levels;
+    }
+
 public:
 
 	ConcurrentQueue() : myInterrupt(false) {}
@@ -25,32 +45,34 @@ public:
 	{
 		//	Lock
 		lock_guard<mutex> lk(myMutex);
-		//	Access underlying queue
-		return myQueue.empty();
+		//	Access underlying queues
+		return firstLane() == Levels;
 	}	//	Unlock
 
     //	Pop into argument
-	bool tryPop(T& t)
+    //  Only from the lanes of priority maxLevel or higher
+	bool tryPop(T& t, const size_t maxLevel = Levels - 1)
 	{
 		//	Lock
 		lock_guard<mutex> lk(myMutex);
-		if (myQueue.empty()) return false;
+        const size_t l = firstLane(maxLevel);
+		if (l == Levels) return false;
 		//	Move from queue
-		t = move(myQueue.front());
-		//	Combine front/pop
-		myQueue.pop();
+		t = move(myQueues[l].front());
+		//	Combine front/pop 
+		myQueues[l].pop();
 
 		return true;
 	}	//	Unlock
 
     //	Pass t byVal or move with push( move( t))
-	void push(T t)
+	void push(T t, const size_t level = 0)
 	{
 		{
 			//	Lock
 			lock_guard<mutex> lk(myMutex);
 			//	Move into queue
-			myQueue.push(move(t));
+			myQueues[level].push(move(t));
 		}	//	Unlock before notification
 
         //	Unlock before notification 
@@ -58,22 +80,28 @@ public:
 	}
 
 	//	Wait if empty
-	bool pop(T& t)
+    //  Or until quit() returns true, then return false
+	template <class Quit>
+	bool pop(T& t, const Quit& quit)
 	{
 		//	(Unique) lock
 		unique_lock<mutex> lk(myMutex);
 
 		//	Wait if empty, release lock until notified 
-		while (!myInterrupt && myQueue.empty()) myCV.wait(lk);
+		while (!myInterrupt && firstLane() == Levels && !quit()) myCV.wait(lk);
 
 		//	Re-acquire lock, resume 
 
 		//  Check for interruption
 		if (myInterrupt) return false;
 
+        //  Quit with nothing to pop
+        if (firstLane() == Levels) return false;
+
 		//	Combine front/pop 
-		t = move(myQueue.front());
-		myQueue.pop();
+        const size_t l = firstLane();
+		t = move(myQueues[l].front());
+		myQueues[l].pop();
 
 		return true;
 
@@ -88,6 +116,22 @@ public:
 		myCV.notify_all();
 	}
 
+	bool pop(T& t)
+	{
+		return pop(t, [] { return false; });
+	}
+
+    //  Wake up the threads waiting in pop() to check their quit condition
+    //  Taking the lock ensures that a change of the condition 
+    //      made before the call is seen
+    void wakeAll()
+    {
+        {
+            lock_guard<mutex> lk(myMutex);
+        }
+        myCV.notify_all();
+    }
+
     void resetInterrupt()
     {
         myInterrupt = false;
@@ -95,7 +139,10 @@ public:
 
     void clear()
     {
-        queue<T> empty;
-        swap(myQueue, empty);
+        for (auto& q : myQueues)
+        {
+            queue<T> empty;
+            swap(q, empty);
+        }
     }
-};
\ No newline at end of file
+};
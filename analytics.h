@@ -90,6 +90,116 @@ inline T merton(
     return result;
 }
 
+//  Merton by Fourier-cosine expansion (COS, Fang and Oosterlee, 2008), templated
+//  Prices calls for a vector of strikes on one maturity in one pass:
+//      the characteristic function is computed once on (at most) numTerms frequencies,
+//      only the phase depends on the strike
+//  Puts are expanded on the truncation range of log(spot(mat) / strike), 
+//      set numStd standard deviations around all the strikes, 
+//      and calls are found by parity
+//  The range is computed in double: it does not carry sensitivities
+
+template<class T>
+inline vector<T> mertonCos(
+    const double            spot,
+    const vector<double>&   strikes,
+    const T&                vol,
+    const double            mat,
+    const T&                intens,
+    const T&                meanJmp,
+    const T&                stdJmp,
+    const size_t            numTerms = 256,
+    const double            numStd = 10.0)
+{
+    const size_t n = strikes.size();
+    vector<T> results(n);
+    if (!n) return results;
+
+    //  Cumulants of log(spot(mat) / spot), in double
+    const double v = double(vol), l = double(intens), m = double(meanJmp), s = double(stdJmp);
+    const double c1 = mat * (-0.5 * v * v - l * (exp(m + 0.5 * s * s) - 1) + l * m);
+    const double c2 = mat * (v * v + l * (m * m + s * s));
+    const double c4 = mat * l * (m * m * m * m + 6 * m * m * s * s + 3 * s * s * s * s);
+    const double width = numStd * sqrt(c2 + sqrt(c4));
+
+    //  Log moneyness and truncation range, wide enough for all the strikes 
+    vector<double> x(n);
+    transform(strikes.begin(), strikes.end(), x.begin(), 
+        [spot](const double k) { return log(spot / k); });
+    const double a = min(*min_element(x.begin(), x.end()) + c1 - width, -width);
+    const double b = max(*max_element(x.begin(), x.end()) + c1 + width, width);
+    const double pi = 3.14159265358979323846;
+    const double freq = pi / (b - a);
+
+    //  Characteristic function of log(spot(mat) / spot) on the frequencies
+    //  exp(re) * (cos(im) + i sin(im))
+    //  Its modulus is bounded by exp(-0.5 u^2 vol^2 mat), 
+    //      we stop at the first frequency where it is negligible, 
+    //      or after numTerms
+    const T var = vol * vol;
+    const T comp = intens * (exp(meanJmp + 0.5 * stdJmp * stdJmp) - 1.0);
+    const T drift = mat * (-0.5 * var - comp);
+    const T intensT = intens * mat;
+    const T varJmp = stdJmp * stdJmp;
+    vector<T> cfRe, cfIm;
+    cfRe.reserve(numTerms);
+    cfIm.reserve(numTerms);
+    for (size_t k = 0; k < numTerms; ++k)
+    {
+        const double u = k * freq;
+        const T jmpMod = exp(-0.5 * u * u * varJmp);
+        const T re = -0.5 * u * u * mat * var + intensT * (jmpMod * cos(u * meanJmp) - 1.0);
+        const T im = u * drift + intensT * jmpMod * sin(u * meanJmp);
+        const T mod = exp(re);
+        if (double(mod) < 1.0e-16) break;
+        cfRe.push_back(mod * cos(im));
+        cfIm.push_back(mod * sin(im));
+    }
+    const size_t terms = cfRe.size();
+
+    //  Put payoff coefficients, in double
+    vector<double> payCoefs(terms);
+    for (size_t k = 0; k < terms; ++k)
+    {
+        const double u = k * freq;
+        const double chi = (cos(u * a) - exp(a) - u * sin(u * a)) / (1.0 + u * u);
+        const double psi = k ? -sin(u * a) / u : -a;
+        payCoefs[k] = 2.0 / (b - a) * (psi - chi);
+    }
+    payCoefs[0] *= 0.5;
+
+    //  Frequency by frequency, all the strikes together, 
+    //      the phases exp(i u (x - a)) by recursion
+    vector<double> phRe(n, 1.0), phIm(n, 0.0), rotRe(n), rotIm(n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        rotRe[j] = cos(freq * (x[j] - a));
+        rotIm[j] = sin(freq * (x[j] - a));
+    }
+    vector<T> puts(n, T(0.0));
+    for (size_t k = 0; k < terms; ++k)
+    {
+        const T wRe = payCoefs[k] * cfRe[k];
+        const T wIm = payCoefs[k] * cfIm[k];
+        for (size_t j = 0; j < n; ++j)
+        {
+            //  Re(cf * phase) = cfRe * phRe - cfIm * phIm
+            puts[j] += wRe * phRe[j] - wIm * phIm[j];
+            const double re = phRe[j] * rotRe[j] - phIm[j] * rotIm[j];
+            phIm[j] = phRe[j] * rotIm[j] + phIm[j] * rotRe[j];
+            phRe[j] = re;
+        }
+    }
+
+    //  Parity
+    for (size_t j = 0; j < n; ++j)
+    {
+        results[j] = strikes[j] * puts[j] + spot - strikes[j];
+    }
+
+    return results;
+}
+
 //	Up and out call in Black-Scholes, untemplated
 
 inline double BlackScholesKO(
@@ -23,16 +23,75 @@ As long as this comment is preserved at the top of the file
 #include <array>
 #include <list>
 #include <iterator>
+#include <algorithm>
+#include <cstring>
 using namespace std;
 
+#include "mappedFile.h"
+
+//  Out-of-core tapes
+//  When a window is set, every blocklist keeps its first window bytes in RAM,
+//      further blocks are backed by a memory mapped temporary file:
+//      when they fall more than window bytes behind the block being written,
+//      they are written out to disk (sequentially) and dropped from RAM
+//  The backward sweep prefetches the previous block while it works on the current one
+//  The settings apply to blocks created after they are set
+
+struct outOfCoreSettings
+{
+    //  Bytes in RAM per blocklist, 0 = everything in RAM
+    size_t      window = 0;
+    //  Directory for the temporary files, system temporary directory if empty
+    string      dir;
+};
+
+inline outOfCoreSettings& outOfCore()
+{
+    static outOfCoreSettings settings;
+    return settings;
+}
+
 template <class T, size_t block_size>
 class blocklist
 {
+    //  Block of block_size elements, in RAM or mapped from the file
+    struct block
+    {
+        T*          first;
+        //  Bytes mapped from the file, 0 if in RAM
+        size_t      mapped;
+        //  Previous block in the list, for prefetching
+        block*      previous;
+
+        T* begin() const { return first; }
+        T* end() const { return first + block_size; }
+
+        //  Write out and drop from RAM, if mapped
+        void writeOut() const
+        {
+            if (mapped) mappedFile::releaseChunk(first, mapped);
+        }
+
+        void prefetchPrevious() const
+        {
+            if (previous && previous->mapped) mappedFile::prefetchChunk(previous->first, previous->mapped);
+        }
+    };
+
     //  Container = list of blocks
-    list<array<T, block_size>>  data;
+    list<block>         data;
+
+    using list_iter = typename list<block>::iterator;
+    using block_iter = T*;
 
-    using list_iter = decltype(data.begin());
-    using block_iter = decltype(data.back().begin());
+    //  Backing file, opened with the first mapped block
+    mappedFile          file;
+    //  Number of blocks in RAM, and last block written out
+    size_t              numInRam = 0;
+    list_iter           last_released;
+    //  Block reached by the backward sweep, if sweeping
+    list_iter           sweep_block;
+    bool                sweeping = false;
 
     //  Current block
     list_iter           cur_block;
@@ -53,15 +112,69 @@ class blocklist
     //  Create new array
     void newblock()
     {
-        data.emplace_back();
+        const outOfCoreSettings& settings = outOfCore();
+        block* previous = data.empty() ? nullptr : &data.back();
+
+        if (!settings.window || numInRam * sizeof(T) * block_size < settings.window)
+        {
+            //  In RAM
+            T* first = static_cast<T*>(::operator new(block_size * sizeof(T)));
+            data.push_back({ first, 0, previous });
+            ++numInRam;
+        }
+        else
+        {
+            //  Mapped from the file
+            if (!file.isOpen())
+            {
+                file.open(settings.dir);
+                last_released = data.end();
+            }
+            const size_t bytes = mappedFile::chunkSize(block_size * sizeof(T));
+            T* first = static_cast<T*>(file.mapChunk(bytes));
+            data.push_back({ first, bytes, previous });
+        }
+
         cur_block = last_block = prev(data.end());
         next_space = cur_block->begin();
         last_space = cur_block->end();
     }
 
+    //  Write out and drop from RAM the mapped blocks 
+    //      that are more than window bytes behind the current block
+    void release()
+    {
+        if (!file.isOpen()) return;
+
+        const size_t window = max<size_t>(1, outOfCore().window / (sizeof(T) * block_size));
+
+        //  Distance from current block
+        size_t behind = 0;
+        list_iter it = cur_block;
+        while (behind < window && it != data.begin() && it != last_released)
+        {
+            --it;
+            ++behind;
+        }
+        if (behind < window || it == last_released) return;
+
+        //  it is the most recent block to release, 
+        //      release from there back to the last one released
+        list_iter stop = it;
+        ++stop;
+        list_iter from = last_released == data.end() ? data.begin() : next(last_released);
+        for (list_iter b = from; b != stop; ++b)
+        {
+            b->writeOut();
+        }
+        last_released = it;
+    }
+
     //  Move on to next array
     void nextblock()
     {
+        sweeping = false;
+
         //  This is the last array: create new
         if (cur_block == last_block)
         {
@@ -73,6 +186,21 @@ class blocklist
             next_space = cur_block->begin();
             last_space = cur_block->end();
         }
+
+        release();
+    }
+
+    //  Free all blocks and the file, which unmaps the mapped ones
+    void freeblocks()
+    {
+        for (auto& b : data)
+        {
+            if (!b.mapped) ::operator delete(b.first);
+        }
+        data.clear();
+        file.close();
+        numInRam = 0;
+        sweeping = false;
     }
 
 public:
@@ -83,10 +211,18 @@ public:
         newblock();
     }
 
+    blocklist(const blocklist&) = delete;
+    blocklist& operator=(const blocklist&) = delete;
+
+    ~blocklist()
+    {
+        freeblocks();
+    }
+
     //  Factory reset
     void clear()
     {
-        data.clear();
+        freeblocks();
         newblock();
     }
 
@@ -96,6 +232,8 @@ public:
         cur_block = data.begin();
         next_space = cur_block->begin();
         last_space = cur_block->end();
+        if (file.isOpen()) last_released = data.end();
+        sweeping = false;
     }
 
 	//	Memset
@@ -103,7 +241,7 @@ public:
 	{
 		for (auto& arr : data)
 		{
-			std::memset(&arr[0], value, block_size * sizeof(T));
+			std::memset(arr.first, value, block_size * sizeof(T));
 		}
 	}
 
@@ -190,6 +328,12 @@ public:
 		return &*old_next;
 	}
 
+    //  Is p in the current block
+    bool inCurrentBlock(const T* p) const
+    {
+        return !less<const T*>()(p, cur_block->begin()) && less<const T*>()(p, cur_block->end());
+    }
+
 	//	Marks
 
     //  Set mark
@@ -205,6 +349,37 @@ public:
         cur_block = marked_block;
         next_space = marked_space;
 		last_space = cur_block->end();
+        //  Blocks after the mark are reused
+        if (file.isOpen() 
+            && last_released != data.end()
+            && distance(data.begin(), last_released) >= distance(data.begin(), cur_block))
+        {
+            last_released = cur_block == data.begin() ? data.end() : prev(cur_block);
+        }
+        sweeping = false;
+    }
+
+    //  Backward sweep, with p moving backwards:
+    //      write out and drop from RAM the mapped blocks after the one containing p, 
+    //      and read ahead the block before
+    //  Called by the tape during propagation, see AADTape.h
+    void releaseAfter(const T* p)
+    {
+        if (!file.isOpen()) return;
+
+        if (!sweeping)
+        {
+            sweep_block = cur_block;
+            sweeping = true;
+        }
+
+        while (sweep_block != data.begin() && (p < sweep_block->begin() || p >= sweep_block->end()))
+        {
+            sweep_block->writeOut();
+            --sweep_block;
+        }
+
+        sweep_block->prefetchPrevious();
     }
 
     //  Iterator
@@ -233,6 +408,12 @@ public:
         iterator(list_iter cb, block_iter cs, block_iter fs, block_iter ls) :
             cur_block(cb), cur_space(cs), first_space(fs), last_space(ls) {}
 
+        //  First element of a block?
+        bool firstInBlock() const
+        {
+            return cur_space == first_space;
+        }
+
         //	Pre-increment (we do not provide post)
         iterator& operator++()
         {
@@ -257,6 +438,10 @@ public:
                 first_space = cur_block->begin();
                 last_space = cur_block->end();
 				cur_space = last_space;
+                //  Backward sweep: drop the block we leave, 
+                //      and read ahead the block before
+                next(cur_block)->writeOut();
+                cur_block->prefetchPrevious();
             }
 
             --cur_space;
@@ -47,4 +47,70 @@ void choldc(const matrix<T>& in, matrix<T>& out)
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+//  Specialisation for doubles: blocked, right-looking
+//  Same results as above up to rounding, 
+//      with the same treatment of zero and negative pivots
+//  For every block of CHOLDC_BLOCK columns:
+//      factor the diagonal block,
+//      solve the panel below it, 
+//      and apply the rank-CHOLDC_BLOCK update to the trailing lower triangle
+//  Rows are contiguous, so all inner loops are dot products over rows (see matrix.h)
+
+#define CHOLDC_BLOCK 32
+
+inline void choldc(const matrix<double>& in, matrix<double>& out)
+{
+	const size_t n = in.rows();
+
+	//	Start from the lower triangle of the input
+	for (size_t i = 0; i < n; ++i)
+	{
+		const double* ai = in[i];
+		double* pi = out[i];
+		for (size_t j = 0; j <= i; ++j) pi[j] = ai[j];
+		for (size_t j = i + 1; j < n; ++j) pi[j] = 0.0;
+	}
+
+	for (size_t k0 = 0; k0 < n; k0 += CHOLDC_BLOCK)
+	{
+		const size_t k1 = min<size_t>(k0 + CHOLDC_BLOCK, n);
+
+		//	Diagonal block and panel below, column by column within the block
+		for (size_t j = k0; j < k1; ++j)
+		{
+			double* pj = out[j];
+			double sum = pj[j] - dot(pj + k0, pj + k0, j - k0);
+			if (sum < -1.0e-15)
+			{
+				throw runtime_error("choldc : matrix not positive definite");
+			}
+			if (sum < 1.0e-15) sum = 0.0;
+			pj[j] = sqrt(sum);
+
+			for (size_t i = j + 1; i < n; ++i)
+			{
+				double* pi = out[i];
+				if (fabs(pj[j]) < 1.0e-15)
+				{
+					pi[j] = 0.0;
+				}
+				else
+				{
+					pi[j] = (pi[j] - dot(pi + k0, pj + k0, j - k0)) / pj[j];
+				}
+			}
+		}
+
+		//	Trailing update, lower triangle only
+		for (size_t i = k1; i < n; ++i)
+		{
+			double* pi = out[i];
+			for (size_t j = k1; j <= i; ++j)
+			{
+				pi[j] -= dot(pi + k0, out[j] + k0, k1 - k0);
+			}
+		}
+	}
+}
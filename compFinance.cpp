@@ -0,0 +1,612 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+//  C export wrappers to functions in main.h, see compFinance.h
+
+#ifndef CF_BUILD
+#define CF_BUILD
+#endif
+#include "compFinance.h"
+
+#include "threadPool.h"
+#include "main.h"
+
+#include <shared_mutex>
+
+//  Helpers
+
+namespace
+{
+    //  Last error, by thread
+    thread_local string lastError;
+
+    //  Calculations share the store, modifications are exclusive
+    shared_mutex storeMutex;
+
+    //  Run f, catch exceptions and report them in lastError
+    template <class F>
+    int guard(F f)
+    {
+        try
+        {
+            lastError.clear();
+            f();
+            return 0;
+        }
+        catch (const exception& e)
+        {
+            lastError = e.what();
+            return -1;
+        }
+        catch (...)
+        {
+            lastError = "unknown error";
+            return -1;
+        }
+    }
+
+    void checkArg(const void* p, const char* name)
+    {
+        if (!p) throw runtime_error(string("null argument : ") + name);
+    }
+
+    //  Is the int field at offset within the struct of the caller,
+    //      which may be built against an older, shorter cfNumericalParam
+    bool hasField(const cfNumericalParam* num, const size_t offset)
+    {
+        return num->structSize >= offset + sizeof(int);
+    }
+
+    NumericalParam c2num(const cfNumericalParam* num)
+    {
+        checkArg(num, "num");
+        if (!hasField(num, offsetof(cfNumericalParam, seed2)))
+        {
+            throw runtime_error("num->structSize not set, see cfInitNumericalParam()");
+        }
+        if (num->numPath <= 0) throw runtime_error("numPath must be positive");
+
+        //  Fields beyond the struct of the caller keep the defaults of NumericalParam
+        NumericalParam res;
+        res.parallel = num->parallel != 0;
+        res.useSobol = num->useSobol != 0;
+        res.numPath = num->numPath;
+        res.seed1 = num->seed1;
+        res.seed2 = num->seed2;
+        if (hasField(num, offsetof(cfNumericalParam, numStrata))) 
+            res.numStrata = num->numStrata;
+        if (hasField(num, offsetof(cfNumericalParam, latinHypercube))) 
+            res.latinHypercube = num->latinHypercube != 0;
+        if (hasField(num, offsetof(cfNumericalParam, generatorThreads))) 
+            res.generatorThreads = max(0, num->generatorThreads);
+        if (hasField(num, offsetof(cfNumericalParam, maxThreads))) 
+            res.maxThreads = max(0, num->maxThreads);
+        if (hasField(num, offsetof(cfNumericalParam, tradeStreams))) 
+            res.tradeStreams = num->tradeStreams != 0;
+        if (hasField(num, offsetof(cfNumericalParam, ziggurat)))
+            res.gaussians = num->ziggurat ? GaussianTransform::Ziggurat : GaussianTransform::InverseCdf;
+
+        return res;
+    }
+
+    vector<string> c2strVector(const size_t n, const char* const* strs)
+    {
+        if (n) checkArg(strs, "strings");
+        vector<string> res(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            checkArg(strs[i], "string");
+            res[i] = strs[i];
+        }
+        return res;
+    }
+
+    vector<double> c2vector(const size_t n, const double* p)
+    {
+        if (n) checkArg(p, "array");
+        return vector<double>(p, p + n);
+    }
+
+    matrix<double> c2matrix(const size_t rows, const size_t cols, const double* p)
+    {
+        if (rows && cols) checkArg(p, "matrix");
+        matrix<double> res(rows, cols);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            copy(p + i * cols, p + (i + 1) * cols, res[i]);
+        }
+        return res;
+    }
+
+    //  Copy label, snprintf semantics
+    void copyLabel(const string& label, char* buffer, const size_t size, size_t* length)
+    {
+        if (length) *length = label.size();
+        if (!size) return;
+        checkArg(buffer, "buffer");
+        const size_t n = min(label.size(), size - 1);
+        copy(label.begin(), label.begin() + n, buffer);
+        buffer[n] = 0;
+    }
+
+    //  Models and products by id, throw if not found
+    //  Call under lock
+
+    pair<Model<double>*, Model<Number>*> findModel(const char* id)
+    {
+        checkArg(id, "modelId");
+        auto it = modelStore.find(id);
+        if (it == modelStore.end()) throw runtime_error(string("model not found : ") + id);
+        return make_pair(it->second.first.get(), it->second.second.get());
+    }
+
+    pair<Product<double>*, Product<Number>*> findProduct(const char* id)
+    {
+        checkArg(id, "productId");
+        auto it = productStore.find(id);
+        if (it == productStore.end()) throw runtime_error(string("product not found : ") + id);
+        return make_pair(it->second.first.get(), it->second.second.get());
+    }
+
+    //  AAD calculations record on the tape of the calling thread
+    //  The global tape is shared by all the threads that did not set their own
+    void useThreadTape()
+    {
+        static thread_local Tape tape;
+        Number::tape = &tape;
+    }
+}
+
+//  Exports
+
+const char* cfLastError(void)
+{
+    return lastError.c_str();
+}
+
+int cfInitNumericalParam(cfNumericalParam* num)
+{
+    return guard([&]()
+    {
+        checkArg(num, "num");
+
+        NumericalParam def;
+        *num = cfNumericalParam();
+        num->structSize = sizeof(cfNumericalParam);
+        num->seed1 = def.seed1;
+        num->seed2 = def.seed2;
+        num->numStrata = def.numStrata;
+        num->latinHypercube = def.latinHypercube;
+        num->generatorThreads = def.generatorThreads;
+        num->maxThreads = def.maxThreads;
+        num->tradeStreams = def.tradeStreams;
+        num->ziggurat = def.gaussians == GaussianTransform::Ziggurat;
+    });
+}
+
+int cfStartThreadPool(size_t numThreads)
+{
+    return guard([&]()
+    {
+        ThreadPool::getInstance()->start(numThreads);
+    });
+}
+
+int cfResizeThreadPool(size_t numThreads)
+{
+    return guard([&]()
+    {
+        ThreadPool::getInstance()->resize(numThreads);
+    });
+}
+
+int cfSetQmcCache(int enabled, const char* dir)
+{
+    return guard([&]()
+    {
+        setQmcCache(enabled != 0, dir ? dir : "");
+    });
+}
+
+//  Models
+
+int cfPutBlackScholes(
+    const char*     id,
+    double          spot,
+    double          vol,
+    int             qSpot,
+    double          rate,
+    double          div)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        unique_lock<shared_mutex> lk(storeMutex);
+        putBlackScholes(spot, vol, qSpot != 0, rate, div, id);
+    });
+}
+
+int cfPutDupire(
+    const char*     id,
+    double          spot,
+    size_t          numSpots,
+    const double*   spots,
+    size_t          numTimes,
+    const double*   times,
+    const double*   vols,
+    double          maxDt,
+    double          tolerance,
+    int             trapezoid)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        const auto spotVec = c2vector(numSpots, spots);
+        const auto timeVec = c2vector(numTimes, times);
+        const auto volMat = c2matrix(numSpots, numTimes, vols);
+
+        unique_lock<shared_mutex> lk(storeMutex);
+        putDupire(spot, spotVec, timeVec, volMat, maxDt, id, tolerance, trapezoid != 0);
+    });
+}
+
+int cfPutDisplaced(
+    const char*         id,
+    size_t              numAssets,
+    const char* const*  assets,
+    const double*       spots,
+    const double*       atms,
+    const double*       skews,
+    double              discRate,
+    const double*       repoSpreads,
+    size_t              numDivDates,
+    const double*       divDates,
+    const double*       divs,
+    const double*       correl,
+    double              lambda)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        const auto assetVec = c2strVector(numAssets, assets);
+        const auto spotVec = c2vector(numAssets, spots);
+        const auto atmVec = c2vector(numAssets, atms);
+        const auto skewVec = c2vector(numAssets, skews);
+        const auto repoVec = c2vector(numAssets, repoSpreads);
+        const auto divDateVec = c2vector(numDivDates, divDates);
+        const auto divMat = c2matrix(numDivDates, numAssets, divs);
+        const auto correlMat = c2matrix(numAssets, numAssets, correl);
+
+        unique_lock<shared_mutex> lk(storeMutex);
+        putDisplaced(assetVec, spotVec, atmVec, skewVec, discRate, repoVec,
+            divDateVec, divMat, correlMat, lambda, id);
+    });
+}
+
+int cfEraseModel(const char* id)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        unique_lock<shared_mutex> lk(storeMutex);
+        modelStore.erase(id);
+    });
+}
+
+int cfNumParameters(const char* modelId, size_t* numParams)
+{
+    return guard([&]()
+    {
+        checkArg(numParams, "numParams");
+        shared_lock<shared_mutex> lk(storeMutex);
+        *numParams = findModel(modelId).first->numParams();
+    });
+}
+
+int cfGetParameters(const char* modelId, double* values)
+{
+    return guard([&]()
+    {
+        checkArg(values, "values");
+        shared_lock<shared_mutex> lk(storeMutex);
+        const auto& params = findModel(modelId).first->parameters();
+        transform(params.begin(), params.end(), values, [](const double* p) { return *p; });
+    });
+}
+
+int cfSetParameters(const char* modelId, const double* values)
+{
+    return guard([&]()
+    {
+        checkArg(values, "values");
+        unique_lock<shared_mutex> lk(storeMutex);
+        const auto models = findModel(modelId);
+
+        //  Both the model for valuation and the model for risk
+        const auto& params = models.first->parameters();
+        const auto& riskParams = models.second->parameters();
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            *params[i] = values[i];
+            riskParams[i]->value() = values[i];
+        }
+    });
+}
+
+int cfParameterLabel(
+    const char*     modelId,
+    size_t          i,
+    char*           buffer,
+    size_t          size,
+    size_t*         length)
+{
+    return guard([&]()
+    {
+        shared_lock<shared_mutex> lk(storeMutex);
+        const auto& labels = findModel(modelId).first->parameterLabels();
+        if (i >= labels.size()) throw runtime_error("parameter index out of range");
+        copyLabel(labels[i], buffer, size, length);
+    });
+}
+
+//  Products
+
+int cfPutEuropean(
+    const char*     id,
+    double          strike,
+    double          exerciseDate,
+    double          settlementDate)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        unique_lock<shared_mutex> lk(storeMutex);
+        putEuropean(strike, exerciseDate, settlementDate, id);
+    });
+}
+
+int cfPutBarrier(
+    const char*     id,
+    double          strike,
+    double          barrier,
+    double          maturity,
+    double          monitorFreq,
+    double          smooth,
+    int             callPut)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        unique_lock<shared_mutex> lk(storeMutex);
+        putBarrier(strike, barrier, maturity, monitorFreq, smooth, callPut != 0, id);
+    });
+}
+
+int cfPutContingent(
+    const char*     id,
+    double          coupon,
+    double          maturity,
+    double          payFreq,
+    double          smooth)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        unique_lock<shared_mutex> lk(storeMutex);
+        putContingent(coupon, maturity, payFreq, smooth, id);
+    });
+}
+
+int cfPutEuropeans(
+    const char*     id,
+    size_t          numOptions,
+    const double*   maturities,
+    const double*   strikes)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        const auto matVec = c2vector(numOptions, maturities);
+        const auto strikeVec = c2vector(numOptions, strikes);
+
+        unique_lock<shared_mutex> lk(storeMutex);
+        putEuropeans(matVec, strikeVec, id);
+    });
+}
+
+int cfPutBaskets(
+    const char*         id,
+    size_t              numAssets,
+    const char* const*  assets,
+    const double*       weights,
+    double              maturity,
+    size_t              numStrikes,
+    const double*       strikes)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        const auto assetVec = c2strVector(numAssets, assets);
+        const auto weightVec = c2vector(numAssets, weights);
+        const auto strikeVec = c2vector(numStrikes, strikes);
+
+        unique_lock<shared_mutex> lk(storeMutex);
+        putBaskets(assetVec, weightVec, maturity, strikeVec, id);
+    });
+}
+
+int cfPutAutocall(
+    const char*         id,
+    size_t              numAssets,
+    const char* const*  assets,
+    const double*       refs,
+    double              maturity,
+    int                 periods,
+    double              ko,
+    double              strike,
+    double              cpn,
+    double              smooth)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        const auto assetVec = c2strVector(numAssets, assets);
+        const auto refVec = c2vector(numAssets, refs);
+
+        unique_lock<shared_mutex> lk(storeMutex);
+        putAutocall(assetVec, refVec, maturity, periods, ko, strike, cpn, smooth, id);
+    });
+}
+
+int cfEraseProduct(const char* id)
+{
+    return guard([&]()
+    {
+        checkArg(id, "id");
+        unique_lock<shared_mutex> lk(storeMutex);
+        productStore.erase(id);
+    });
+}
+
+int cfNumPayoffs(const char* productId, size_t* numPayoffs)
+{
+    return guard([&]()
+    {
+        checkArg(numPayoffs, "numPayoffs");
+        shared_lock<shared_mutex> lk(storeMutex);
+        *numPayoffs = findProduct(productId).first->payoffLabels().size();
+    });
+}
+
+int cfPayoffLabel(
+    const char*     productId,
+    size_t          i,
+    char*           buffer,
+    size_t          size,
+    size_t*         length)
+{
+    return guard([&]()
+    {
+        shared_lock<shared_mutex> lk(storeMutex);
+        const auto& labels = findProduct(productId).first->payoffLabels();
+        if (i >= labels.size()) throw runtime_error("payoff index out of range");
+        copyLabel(labels[i], buffer, size, length);
+    });
+}
+
+//  Calculations
+//  Models and products are not modified, so calculations share the lock
+
+int cfValue(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    double*                     values)
+{
+    return guard([&]()
+    {
+        const auto params = c2num(num);
+        checkArg(values, "values");
+
+        shared_lock<shared_mutex> lk(storeMutex);
+        value(*findModel(modelId).first, *findProduct(productId).first, params, values);
+    });
+}
+
+int cfAADRisk(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    double*                     values,
+    double*                     risks)
+{
+    return guard([&]()
+    {
+        const auto params = c2num(num);
+        checkArg(values, "values");
+        checkArg(risks, "risks");
+
+        useThreadTape();
+
+        shared_lock<shared_mutex> lk(storeMutex);
+        AADriskMulti(*findModel(modelId).second, *findProduct(productId).second, params, values, risks);
+    });
+}
+
+int cfBumpRisk(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    double*                     values,
+    double*                     risks)
+{
+    return guard([&]()
+    {
+        const auto params = c2num(num);
+        checkArg(values, "values");
+        checkArg(risks, "risks");
+
+        shared_lock<shared_mutex> lk(storeMutex);
+        bumpRisk(*findModel(modelId).first, *findProduct(productId).first, params, values, risks);
+    });
+}
+
+int cfEstimateCost(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    int                         calculation,
+    size_t                      pilotPaths,
+    cfCostEstimate*             estimate)
+{
+    return guard([&]()
+    {
+        const auto params = c2num(num);
+        checkArg(estimate, "estimate");
+        if (calculation != 0 && calculation != 1) throw runtime_error("unknown calculation");
+        if (!pilotPaths) pilotPaths = 16;
+
+        CostEstimate est;
+        if (calculation == 0)
+        {
+            shared_lock<shared_mutex> lk(storeMutex);
+            est = estimateCost(*findModel(modelId).first, *findProduct(productId).first, 
+                params, pilotPaths);
+        }
+        else
+        {
+            useThreadTape();
+
+            shared_lock<shared_mutex> lk(storeMutex);
+            est = estimateCost(*findModel(modelId).second, *findProduct(productId).second, 
+                params, true, pilotPaths);
+        }
+
+        estimate->simDim = est.simDim;
+        estimate->preMarkNodes = est.preMarkNodes;
+        estimate->nodesPerPath = est.nodesPerPath;
+        estimate->argsPerPath = est.argsPerPath;
+        estimate->adjointWidth = est.adjointWidth;
+        estimate->setupSeconds = est.setupSeconds;
+        estimate->secondsPerPath = est.secondsPerPath;
+        estimate->threads = est.threads;
+        estimate->concurrency = est.concurrency;
+        estimate->wallSeconds = est.wallSeconds;
+        estimate->tapeBytes = est.tapeBytes;
+        estimate->resultBytes = est.resultBytes;
+        estimate->peakBytes = est.peakBytes;
+    });
+}
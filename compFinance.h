@@ -0,0 +1,289 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  C interface to the library, for embedding in services and other languages
+//  The C++ equivalent of xlExport.cpp: wraps store.h and main.h
+
+//  Build as a shared library, for instance on Linux:
+//      g++ -std=c++17 -O3 -shared -fPIC -fvisibility=hidden
+//          compFinance.cpp AAD.cpp mcBase.cpp ThreadPool.cpp sobol.cpp
+//          -o libcompfinance.so -lpthread
+//  compFinance.cpp holds the store and must not be linked with xlExport.cpp
+
+//  Conventions:
+//  -   Functions return 0 on success, or -1 and cfLastError()
+//          returns the message of the error, on the calling thread
+//  -   Results are written into buffers allocated by the caller,
+//          sized from cfNumParameters() and cfNumPayoffs()
+//  -   Matrices are row major and contiguous
+//  -   Models and products are identified by name in the store,
+//          put functions create or replace them
+//  -   Calls may come from multiple threads:
+//          calculations run concurrently with one another,
+//          and wait for calls that modify the store
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#ifdef CF_BUILD
+#define CF_API __declspec(dllexport)
+#else
+#define CF_API __declspec(dllimport)
+#endif
+#else
+#define CF_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  Numerical parameters, see NumericalParam in main.h
+//  Booleans are ints, 0 = false
+//  Initialize with cfInitNumericalParam(), or set structSize to sizeof(cfNumericalParam):
+//      fields are only ever added at the end, 
+//      and those beyond the structSize of the caller take their defaults,
+//      so callers built against an older version of this header keep working
+typedef struct cfNumericalParam
+{
+    size_t  structSize;
+    int     parallel;
+    int     useSobol;
+    int     numPath;
+    int     seed1;
+    int     seed2;
+    //  Stratified sampling of the terminal dimension, see stratified.h
+    //  Number of strata, 0 or 1 = none
+    int     numStrata;
+    //  Latin hypercube over all dimensions, overrides numStrata
+    int     latinHypercube;
+    //  Threads dedicated to generating Gaussians in parallel valuations, 0 = none
+    int     generatorThreads;
+    //  Cap on the threads of the pool working on parallel simulations, 0 = all
+    int     maxThreads;
+    //  Every trade draws from its own substream, keyed by the seeds,
+    //      the product and the model, see rngStreams.h
+    int     tradeStreams;
+    //  Ziggurat instead of the inverse CDF for the Gaussians of mrg32k3a, 
+    //      ignored with Sobol and stratification
+    int     ziggurat;
+} cfNumericalParam;
+
+//  Last error on the calling thread, empty if none
+CF_API const char* cfLastError(void);
+
+//  Set structSize and all fields to their defaults,
+//      numPath = 0 must still be set
+CF_API int cfInitNumericalParam(cfNumericalParam* num);
+
+//  Start the thread pool with numThreads worker threads,
+//      for calculations with parallel = 1
+CF_API int cfStartThreadPool(size_t numThreads);
+
+//  Change the number of worker threads, 
+//      running calculations continue on the new workers
+CF_API int cfResizeThreadPool(size_t numThreads);
+
+//  Cache the Gaussians of Sobol's sequence, in memory,
+//      and in files in dir if not null or empty, see qmcCache.h
+//  enabled = 0 disables and clears the cache
+CF_API int cfSetQmcCache(int enabled, const char* dir);
+
+//  Models
+
+CF_API int cfPutBlackScholes(
+    const char*     id,
+    double          spot,
+    double          vol,
+    int             qSpot,
+    double          rate,
+    double          div);
+
+CF_API int cfPutDupire(
+    const char*     id,
+    double          spot,
+    size_t          numSpots,
+    const double*   spots,
+    size_t          numTimes,
+    const double*   times,
+    //  numSpots x numTimes, spot major
+    const double*   vols,
+    double          maxDt,
+    //  adaptive stepping tolerance, 0 = uniform steps
+    double          tolerance,
+    //  trapezoidal scheme in time, Euler otherwise
+    int             trapezoid);
+
+CF_API int cfPutDisplaced(
+    const char*         id,
+    size_t              numAssets,
+    const char* const*  assets,
+    const double*       spots,
+    const double*       atms,
+    const double*       skews,
+    double              discRate,
+    const double*       repoSpreads,
+    size_t              numDivDates,
+    const double*       divDates,
+    //  numDivDates x numAssets
+    const double*       divs,
+    //  numAssets x numAssets
+    const double*       correl,
+    double              lambda);
+
+CF_API int cfEraseModel(const char* id);
+
+//  Parameters and their labels
+//  Setting parameters updates the model for valuation and risk
+CF_API int cfNumParameters(const char* modelId, size_t* numParams);
+CF_API int cfGetParameters(const char* modelId, double* values);
+CF_API int cfSetParameters(const char* modelId, const double* values);
+
+//  Copies the label, truncated to size - 1 characters and null terminated,
+//      and sets length to the length of the full label if not null
+CF_API int cfParameterLabel(
+    const char*     modelId,
+    size_t          i,
+    char*           buffer,
+    size_t          size,
+    size_t*         length);
+
+//  Products
+
+CF_API int cfPutEuropean(
+    const char*     id,
+    double          strike,
+    double          exerciseDate,
+    double          settlementDate);
+
+CF_API int cfPutBarrier(
+    const char*     id,
+    double          strike,
+    double          barrier,
+    double          maturity,
+    double          monitorFreq,
+    double          smooth,
+    //  0: call, 1: put
+    int             callPut);
+
+CF_API int cfPutContingent(
+    const char*     id,
+    double          coupon,
+    double          maturity,
+    double          payFreq,
+    double          smooth);
+
+CF_API int cfPutEuropeans(
+    const char*     id,
+    size_t          numOptions,
+    //  in increasing order
+    const double*   maturities,
+    const double*   strikes);
+
+CF_API int cfPutBaskets(
+    const char*         id,
+    size_t              numAssets,
+    const char* const*  assets,
+    const double*       weights,
+    double              maturity,
+    size_t              numStrikes,
+    const double*       strikes);
+
+CF_API int cfPutAutocall(
+    const char*         id,
+    size_t              numAssets,
+    const char* const*  assets,
+    const double*       refs,
+    double              maturity,
+    int                 periods,
+    double              ko,
+    double              strike,
+    double              cpn,
+    double              smooth);
+
+CF_API int cfEraseProduct(const char* id);
+
+//  Payoffs and their labels
+CF_API int cfNumPayoffs(const char* productId, size_t* numPayoffs);
+CF_API int cfPayoffLabel(
+    const char*     productId,
+    size_t          i,
+    char*           buffer,
+    size_t          size,
+    size_t*         length);
+
+//  Calculations
+
+//  values: numPayoffs
+CF_API int cfValue(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    double*                     values);
+
+//  values: numPayoffs
+//  risks: numParams x numPayoffs
+CF_API int cfAADRisk(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    double*                     values,
+    double*                     risks);
+
+//  Same with bumps
+CF_API int cfBumpRisk(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    double*                     values,
+    double*                     risks);
+
+//  Pre-flight estimate of the wall time and peak memory of a calculation,
+//      from pilot paths simulated on the calling thread, see mcCost.h
+typedef struct cfCostEstimate
+{
+    //  Measured on the pilot
+    size_t  simDim;
+    size_t  preMarkNodes;
+    size_t  nodesPerPath;
+    size_t  argsPerPath;
+    size_t  adjointWidth;
+    double  setupSeconds;
+    double  secondsPerPath;
+    //  Extrapolated to num
+    size_t  threads;
+    size_t  concurrency;
+    double  wallSeconds;
+    size_t  tapeBytes;
+    size_t  resultBytes;
+    size_t  peakBytes;
+} cfCostEstimate;
+
+//  calculation: 0 = cfValue, 1 = cfAADRisk
+//  pilotPaths: 0 = default
+CF_API int cfEstimateCost(
+    const char*                 modelId,
+    const char*                 productId,
+    const cfNumericalParam*     num,
+    int                         calculation,
+    size_t                      pilotPaths,
+    cfCostEstimate*             estimate);
+
+#ifdef __cplusplus
+}
+#endif
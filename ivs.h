@@ -99,6 +99,16 @@ public:
     //  Raw implied vol
     virtual double impliedVol(const double strike, const Time mat) const = 0;
 
+    //  Raw implied vols for a vector of strikes on one maturity
+    //  Pointwise by default, surfaces with a batched pricer override
+    virtual vector<double> impliedVols(const vector<double>& strikes, const Time mat) const
+    {
+        vector<double> vols(strikes.size());
+        transform(strikes.begin(), strikes.end(), vols.begin(),
+            [&](const double strike) { return impliedVol(strike, mat); });
+        return vols;
+    }
+
     //  Call price
     template<class T = double>
     T call(
@@ -137,6 +147,62 @@ public:
         return sqrt(2.0 * ct / ckk) / strike;
     }
 
+    //  Local vols for a vector of strikes on one maturity
+    //  Same as localVol() with the implied vols computed in 3 batches:
+    //      the strikes and their bumps on the maturity, 
+    //      then the strikes on the maturity bumped down and up
+    template<class T = double>
+    vector<T> localVols(
+        const vector<double>& strikes,
+        const double mat,
+        const RiskView<T>* risk = nullptr) const
+    {
+        const size_t n = strikes.size();
+
+        vector<double> bumped(3 * n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            bumped[i] = strikes[i];
+            bumped[n + i] = strikes[i] - 1.0e-04;
+            bumped[2 * n + i] = strikes[i] + 1.0e-04;
+        }
+        const vector<double> vols = impliedVols(bumped, mat);
+        const vector<double> volsDown = impliedVols(strikes, mat - 1.0e-04);
+        const vector<double> volsUp = impliedVols(strikes, mat + 1.0e-04);
+
+        //  Call price from implied vol, same as call()
+        auto callPrice = [&](const double strike, const Time t, const double vol)
+        {
+            return blackScholes<T>(
+                mySpot,
+                strike,
+                vol + (risk ? risk->spread(strike, t) : T(0.0)),
+                t);
+        };
+
+        vector<T> results(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const double strike = strikes[i];
+
+            //  Derivative to time
+            const T c00 = callPrice(strike, mat, vols[i]);
+            const T c01 = callPrice(strike, mat - 1.0e-04, volsDown[i]);
+            const T c02 = callPrice(strike, mat + 1.0e-04, volsUp[i]);
+            const T ct = (c02 - c01) * 0.5e04;
+
+            //  Second derivative to strike = density
+            const T c10 = callPrice(strike - 1.0e-04, mat, vols[n + i]);
+            const T c20 = callPrice(strike + 1.0e-04, mat, vols[2 * n + i]);
+            const T ckk = (c10 + c20 - 2.0 * c00) * 1.0e08;
+
+            //  Dupire's formula
+            results[i] = sqrt(2.0 * ct / ckk) / strike;
+        }
+
+        return results;
+    }
+
     //  Virtual destructor needed for polymorphic class
     virtual ~IVS() {}
 };
@@ -176,4 +242,25 @@ public:
         //  Implied volatility from price, also in analytics.h
         return blackScholesIvol(spot(), strike, call, mat);
     }
+
+    //  Batched: all the strikes in one pass of the COS pricer, see analytics.h
+    vector<double> impliedVols(const vector<double>& strikes, const Time mat) const override
+    {
+        const vector<double> calls = mertonCos(
+            spot(),
+            strikes,
+            myVol,
+            mat,
+            myIntensity,
+            myAverageJmp,
+            myJmpStd);
+
+        vector<double> vols(strikes.size());
+        for (size_t i = 0; i < strikes.size(); ++i)
+        {
+            vols[i] = blackScholesIvol(spot(), strikes[i], calls[i], mat);
+        }
+
+        return vols;
+    }
 };
@@ -22,10 +22,21 @@ As long as this comment is preserved at the top of the file
 #include "mcMdl.h"
 #include "mcPrd.h"
 #include "mcPrdMulti.h"
+#include "mcStats.h"
+#include "mcSinks.h"
+#include "mcCost.h"
+#include "mcBook.h"
+#include "pde.h"
 #include "mrg32k3a.h"
 #include "sobol.h"
+#include "stratified.h"
+#include "rngStreams.h"
+#include "qmcCache.h"
 #include <numeric>
 #include <fstream>
+#include <future>
+#include <thread>
+#include <chrono>
 using namespace std;
 
 #include "store.h"
@@ -37,25 +48,162 @@ struct NumericalParam
     int               numPath;
     int               seed1 = 12345;
     int               seed2 = 1234;
+    //  Stratified sampling over mrg32k3a, see stratified.h
+    //  Number of strata, 0 or 1 = none, ignored with Sobol
+    int               numStrata = 0;
+    //  Stratified dimensions, negative from the end, default terminal
+    vector<int>       strataDims = { -1 };
+    //  Latin hypercube over all dimensions and paths, overrides strata
+    bool              latinHypercube = false;
+    //  Gaussian transform of mrg32k3a, see mrg32k3a.h,
+    //      ignored with Sobol, strata and Latin hypercubes
+    GaussianTransform gaussians = GaussianTransform::InverseCdf;
+    //  Threads dedicated to generating Gaussians in parallel valuations,
+    //      0 = generated by the workers, see GaussianPipeline in mcBase.h
+    int               generatorThreads = 0;
+    //  Cap on the threads of the pool working on parallel simulations,
+    //      0 = all, see ThreadPool::concurrency()
+    int               maxThreads = 0;
+    //  AAD risk estimator, see mcBase.h
+    GreekEstimator    estimator = GreekEstimator::Pathwise;
+    //  Groups of paths for the standard errors of AAD risks,
+    //      0 = none, typically 20 to 50, see AADRiskBatches in mcBase.h
+    int               riskErrorBatches = 0;
+    //  Every trade draws from its own substream of the generator, 
+    //      keyed by the seeds, the product and the model, see rngStreams.h,
+    //      so its results don't depend on what else is simulated
+    bool              tradeStreams = false;
+    //  Key of the substream, 0 = the generator's own sequence,
+    //      set from the trade by tradeParam() when tradeStreams
+    uint64_t          stream = 0;
+    //  Asynchronous job, set by submitJob(), see below
+    JobControl*       job = nullptr;
 };
 
+//  Random number generator for the numerical parameters
+//  Before substreams
+inline unique_ptr<RNG> makeBaseRng(const NumericalParam& num)
+{
+    if (num.useSobol)
+    {
+        if (QmcCache::instance().enabled()) return make_unique<CachedSobol>(num.numPath);
+        return make_unique<Sobol>();
+    }
+    if (num.latinHypercube)
+    {
+        return make_unique<LatinHypercube>(num.numPath, num.seed1, num.seed2);
+    }
+    if (num.numStrata > 1)
+    {
+        return make_unique<Stratified>(num.numStrata, num.strataDims, num.seed1, num.seed2);
+    }
+    return make_unique<mrg32k3a>(num.seed1, num.seed2, num.gaussians);
+}
+
+inline unique_ptr<RNG> makeRng(const NumericalParam& num)
+{
+    unique_ptr<RNG> rng = makeBaseRng(num);
+    return num.stream ? rng->substream(num.stream) : move(rng);
+}
+
+//  Streams of the trades for the numerical parameters
+inline RngStreams rngStreams(const NumericalParam& num)
+{
+    return RngStreams(unsigned(num.seed1), unsigned(num.seed2));
+}
+
+//  Numerical parameters of a trade: its own substream if tradeStreams
+inline NumericalParam tradeParam(
+    const NumericalParam&   num,
+    const string&           modelId,
+    const string&           productId)
+{
+    NumericalParam tradeNum = num;
+    if (num.tradeStreams) tradeNum.stream = rngStreams(num).key(productId, modelId);
+    return tradeNum;
+}
+
+//  Random number generator of a trade
+inline unique_ptr<RNG> makeRng(
+    const NumericalParam&   num,
+    const string&           modelId,
+    const string&           productId)
+{
+    return makeRng(tradeParam(num, modelId, productId));
+}
+
+//  Out-of-core tapes, see blocklist.h
+//  Every blocklist of every tape keeps windowMB megabytes in RAM,
+//      and spills further blocks to a temporary file in dir
+//  0 = tapes entirely in RAM (default)
+//  Clears the global tape so the setting applies from the next calculation
+inline void setTapeOutOfCore(
+    const double        windowMB,
+    const string&       dir = "")
+{
+    outOfCore().window = windowMB > 0.0 ? size_t(windowMB * 1024 * 1024) : 0;
+    outOfCore().dir = dir;
+    Number::tape->clear();
+}
+
+//  Cache of the Gaussians of Sobol's sequence, see qmcCache.h
+//  Simulations with Sobol read the points of their dimension and number of paths
+//      from the cache, where they are generated once
+//  With a directory, the points are persisted in files 
+//      shared by all the processes and runs that use the directory
+//  Results are unchanged
+inline void setQmcCache(
+    const bool          enabled,
+    const string&       dir = "")
+{
+    QmcCache::instance().set(enabled, dir);
+}
+
+//  Average payoffs across paths, in one pass over the paths,
+//      into a buffer of nPay values
+inline void averagePayoffs(
+    const vector<vector<double>>&   payoffs,
+    const size_t                    nPay,
+    double*                         values)
+{
+    fill(values, values + nPay, 0.0);
+    for (const auto& path : payoffs)
+    {
+        for (size_t j = 0; j < nPay; ++j) values[j] += path[j];
+    }
+    if (payoffs.empty()) return;
+    for (size_t j = 0; j < nPay; ++j) values[j] /= payoffs.size();
+}
+
 //  Price product in model
-inline auto value(
+//  Writes the values of the payoffs into a caller-owned buffer 
+//      of product.payoffLabels().size() doubles, see compFinance.h
+inline void value(
     const Model<double>&    model,
     const Product<double>&  product,
     //  numerical parameters
-    const NumericalParam&   num)
+    const NumericalParam&   num,
+    //  results
+    double*                 values)
 {
     //  Random Number Generator
-    unique_ptr<RNG> rng;
-    if (num.useSobol) rng = make_unique<Sobol>();
-    else rng = make_unique<mrg32k3a>(num.seed1, num.seed2);
+    unique_ptr<RNG> rng = makeRng(num);
 
     //  Simulate
     const auto resultMat = num.parallel
-        ? mcParallelSimul(product, model, *rng, num.numPath)
+        ? mcParallelSimul(product, model, *rng, num.numPath, num.job, num.generatorThreads, num.maxThreads)
         : mcSimul(product, model, *rng, num.numPath);
 
+    averagePayoffs(resultMat, product.payoffLabels().size(), values);
+}
+
+//  Same, returns payoff identifiers and values
+inline auto value(
+    const Model<double>&    model,
+    const Product<double>&  product,
+    //  numerical parameters
+    const NumericalParam&   num)
+{
     //  We return 2 vectors : the payoff identifiers and their values
     struct
     {
@@ -63,15 +211,9 @@ inline auto value(
         vector<double> values;
     } results;
 
-    const size_t nPayoffs = product.payoffLabels().size();
     results.identifiers = product.payoffLabels();
-    results.values.resize(nPayoffs);
-    for (size_t i = 0; i < nPayoffs; ++i)
-    {
-        results.values[i] = accumulate(resultMat.begin(), resultMat.end(), 0.0,
-            [i](const double acc, const vector<double>& v) { return acc + v[i]; }
-        ) / num.numPath;
-    }
+    results.values.resize(results.identifiers.size());
+    value(model, product, num, results.values.data());
 
     return results;
 }
@@ -92,35 +234,24 @@ inline auto value(
         throw runtime_error("value() : Could not retrieve model and product");
     }
 
-    return value(*model, *product, num);
+    return value(*model, *product, tradeParam(num, modelId, productId));
 }
 
 //  AAD risk, one payoff
 inline auto AADriskOne(
-    const string&           modelId,
-    const string&           productId,
+    const Model<Number>&    model,
+    const Product<Number>&  product,
     const NumericalParam&   num,
     const string&           riskPayoff = "")
 {
-    //  Get model and product
-    const Model<Number>* model = getModel<Number>(modelId);
-    const Product<Number>* product = getProduct<Number>(productId);
-
-    if (!model || !product)
-    {
-        throw runtime_error("AADrisk() : Could not retrieve model and product");
-    }
-
     //  Random Number Generator
-    unique_ptr<RNG> rng;
-    if (num.useSobol) rng = make_unique<Sobol>();
-    else rng = make_unique<mrg32k3a>(num.seed1, num.seed2);
+    unique_ptr<RNG> rng = makeRng(num);
 
     //  Find the payoff for risk
     size_t riskPayoffIdx = 0;
     if (!riskPayoff.empty())
     {
-        const vector<string>& allPayoffs = product->payoffLabels();
+        const vector<string>& allPayoffs = product.payoffLabels();
         auto it = find(allPayoffs.begin(), allPayoffs.end(), riskPayoff);
         if (it == allPayoffs.end())
         {
@@ -131,16 +262,19 @@ inline auto AADriskOne(
 
     //  Simulate
     const auto simulResults = num.parallel
-        ? mcParallelSimulAAD(*product, *model, *rng, num.numPath,
-            [riskPayoffIdx](const vector<Number>& v) {return v[riskPayoffIdx]; })
-        : mcSimulAAD(*product, *model, *rng, num.numPath,
-            [riskPayoffIdx](const vector<Number>& v) {return v[riskPayoffIdx]; });
+        ? mcParallelSimulAAD(product, model, *rng, num.numPath,
+            [riskPayoffIdx](const vector<Number>& v) {return v[riskPayoffIdx]; }, num.estimator, num.job, 
+            num.maxThreads, max(0, num.riskErrorBatches))
+        : mcSimulAAD(product, model, *rng, num.numPath,
+            [riskPayoffIdx](const vector<Number>& v) {return v[riskPayoffIdx]; }, num.estimator,
+            max(0, num.riskErrorBatches));
 
     //  We return: a number and 2 vectors : 
     //  -   The payoff identifiers and their values
     //  -   The value of the aggreagte payoff
     //  -   The parameter idenitifiers 
     //  -   The sensititivities of the aggregate to parameters
+    //  -   Their standard errors, if num.riskErrorBatches, empty otherwise
     struct
     {
         vector<string>  payoffIds;
@@ -148,30 +282,43 @@ inline auto AADriskOne(
         double          riskPayoffValue;
         vector<string>  paramIds;
         vector<double>  risks;
+        vector<double>  riskErrors;
     } results;
 
-    const size_t nPayoffs = product->payoffLabels().size();
-    results.payoffIds = product->payoffLabels();
+    const size_t nPayoffs = product.payoffLabels().size();
+    results.payoffIds = product.payoffLabels();
     results.payoffValues.resize(nPayoffs);
-    for (size_t i = 0; i < nPayoffs; ++i)
-    {
-        results.payoffValues[i] = accumulate(
-            simulResults.payoffs.begin(), 
-            simulResults.payoffs.end(), 
-            0.0,
-            [i](const double acc, const vector<double>& v) { return acc + v[i]; }
-        ) / num.numPath;
-    }
+    averagePayoffs(simulResults.payoffs, nPayoffs, results.payoffValues.data());
     results.riskPayoffValue = accumulate(
         simulResults.aggregated.begin(),
         simulResults.aggregated.end(),
         0.0) / num.numPath;
-    results.paramIds = model->parameterLabels();
+    results.paramIds = model.parameterLabels();
     results.risks = move (simulResults.risks);
+    results.riskErrors = move(simulResults.riskErrors);
 
     return results;
 }
 
+//  Overload that picks product and model by name in the store
+inline auto AADriskOne(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const string&           riskPayoff = "")
+{
+    //  Get model and product
+    const Model<Number>* model = getModel<Number>(modelId);
+    const Product<Number>* product = getProduct<Number>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("AADrisk() : Could not retrieve model and product");
+    }
+
+    return AADriskOne(*model, *product, tradeParam(num, modelId, productId), riskPayoff);
+}
+
 //  AAD risk, aggregate portfolio
 inline auto AADriskAggregate(
     const string&           modelId,
@@ -189,9 +336,7 @@ inline auto AADriskAggregate(
     }
 
     //  Random Number Generator
-    unique_ptr<RNG> rng;
-    if (num.useSobol) rng = make_unique<Sobol>();
-    else rng = make_unique<mrg32k3a>(num.seed1, num.seed2);
+    unique_ptr<RNG> rng = makeRng(num, modelId, productId);
 
     //  Vector of notionals
     const vector<string>& allPayoffs = product->payoffLabels();
@@ -209,19 +354,22 @@ inline auto AADriskAggregate(
     //  Aggregator
     auto aggregator = [&vnots](const vector<Number>& payoffs)
     {
-        return inner_product(payoffs.begin(), payoffs.end(), vnots.begin(), Number(0.0));
+        //  Fused: one node on tape, see AAD.h
+        return dot(payoffs.begin(), payoffs.end(), vnots.begin());
     };
 
     //  Simulate
     const auto simulResults = num.parallel
-        ? mcParallelSimulAAD(*product, *model, *rng, num.numPath, aggregator)
-        : mcSimulAAD(*product, *model, *rng, num.numPath, aggregator);
+        ? mcParallelSimulAAD(*product, *model, *rng, num.numPath, aggregator, num.estimator, num.job, num.maxThreads,
+            max(0, num.riskErrorBatches))
+        : mcSimulAAD(*product, *model, *rng, num.numPath, aggregator, num.estimator, max(0, num.riskErrorBatches));
 
     //  We return: a number and 2 vectors : 
     //  -   The payoff identifiers and their values
     //  -   The value of the aggreagte payoff
     //  -   The parameter idenitifiers 
     //  -   The sensititivities of the aggregate to parameters
+    //  -   Their standard errors, if num.riskErrorBatches, empty otherwise
     struct
     {
         vector<string>  payoffIds;
@@ -229,6 +377,7 @@ inline auto AADriskAggregate(
         double          riskPayoffValue;
         vector<string>  paramIds;
         vector<double>  risks;
+        vector<double>  riskErrors;
     } results;
 
     const size_t nPayoffs = product->payoffLabels().size();
@@ -249,6 +398,159 @@ inline auto AADriskAggregate(
         0.0) / num.numPath;
     results.paramIds = model->parameterLabels();
     results.risks = move(simulResults.risks);
+    results.riskErrors = move(simulResults.riskErrors);
+
+    return results;
+}
+
+//  Book of trades, see mcBook.h
+//  Trade i is the product productIds[i] in the model modelIds[i]
+//  All the trades are simulated together on the thread pool, 
+//      num.parallel is ignored
+
+template <class T>
+inline void getBook(
+    const vector<string>&           modelIds,
+    const vector<string>&           productIds,
+    vector<const Model<T>*>&        models,
+    vector<const Product<T>*>&      products)
+{
+    if (modelIds.size() != productIds.size())
+    {
+        throw runtime_error("Book : different numbers of models and products");
+    }
+
+    models.resize(modelIds.size());
+    products.resize(productIds.size());
+    for (size_t i = 0; i < modelIds.size(); ++i)
+    {
+        models[i] = getModel<T>(modelIds[i]);
+        products[i] = getProduct<T>(productIds[i]);
+        if (!models[i] || !products[i])
+        {
+            throw runtime_error("Book : Could not retrieve model and product for trade " + productIds[i]);
+        }
+    }
+}
+
+//  Keys of the substreams of the trades of a book if tradeStreams, otherwise empty
+//  With the same keys as tradeParam(), a trade gets the same numbers
+//      in any book as alone
+inline vector<uint64_t> bookStreams(
+    const vector<string>&   modelIds,
+    const vector<string>&   productIds,
+    const NumericalParam&   num)
+{
+    vector<uint64_t> streams;
+    if (!num.tradeStreams) return streams;
+    const RngStreams keys = rngStreams(num);
+    for (size_t i = 0; i < productIds.size(); ++i)
+    {
+        streams.push_back(keys.key(productIds[i], modelIds[i]));
+    }
+    return streams;
+}
+
+//  Values of the payoffs of every trade
+inline auto valueBook(
+    const vector<string>&   modelIds,
+    const vector<string>&   productIds,
+    const NumericalParam&   num,
+    //  Pilot paths per trade for the order of execution, 0 = book order
+    const size_t            nPilot = 4)
+{
+    vector<const Model<double>*> models;
+    vector<const Product<double>*> products;
+    getBook(modelIds, productIds, models, products);
+
+    unique_ptr<RNG> rng = makeRng(num);
+    auto simulResults = mcParallelBook(products, models, *rng, num.numPath, nPilot, num.maxThreads,
+        bookStreams(modelIds, productIds, num));
+
+    //  Per trade: payoff identifiers and values
+    struct
+    {
+        vector<vector<string>>  identifiers;
+        vector<vector<double>>  values;
+    } results;
+
+    for (const auto* product : products) results.identifiers.push_back(product->payoffLabels());
+    results.values = move(simulResults.values);
+
+    return results;
+}
+
+//  AAD risk of the book
+//  The aggregate of a trade is its first payoff, 
+//      or the sum of its payoffs weighted by notionals[trade], if given
+//  Risks are summed over the trades of every model
+inline auto AADriskBook(
+    const vector<string>&               modelIds,
+    const vector<string>&               productIds,
+    const NumericalParam&               num,
+    const vector<map<string, double>>&  notionals = {},
+    const size_t                        nPilot = 4)
+{
+    vector<const Model<Number>*> models;
+    vector<const Product<Number>*> products;
+    getBook(modelIds, productIds, models, products);
+
+    if (!notionals.empty() && notionals.size() != products.size())
+    {
+        throw runtime_error("AADriskBook() : different numbers of notionals and trades");
+    }
+
+    //  Vectors of notionals
+    vector<vector<double>> weights(notionals.size());
+    for (size_t i = 0; i < notionals.size(); ++i)
+    {
+        if (notionals[i].empty()) continue;
+        const vector<string>& allPayoffs = products[i]->payoffLabels();
+        weights[i].assign(allPayoffs.size(), 0.0);
+        for (const auto& notional : notionals[i])
+        {
+            auto it = find(allPayoffs.begin(), allPayoffs.end(), notional.first);
+            if (it == allPayoffs.end())
+            {
+                throw runtime_error("AADriskBook() : payoff not found");
+            }
+            weights[i][distance(allPayoffs.begin(), it)] = notional.second;
+        }
+    }
+
+    unique_ptr<RNG> rng = makeRng(num);
+    auto simulResults = mcParallelBookAAD(products, models, weights, *rng, num.numPath, 
+        num.estimator, nPilot, num.maxThreads, bookStreams(modelIds, productIds, num));
+
+    //  We return: 
+    //  -   The aggregate of every trade and of the book
+    //  -   The models of the book, in order of first appearance, 
+    //          with their parameter identifiers 
+    //          and the sensitivities of the book to their parameters
+    struct
+    {
+        vector<double>          tradeValues;
+        double                  bookValue;
+        vector<string>          modelIds;
+        vector<vector<string>>  paramIds;
+        vector<vector<double>>  risks;
+    } results;
+
+    results.tradeValues = move(simulResults.aggregated);
+    results.bookValue = accumulate(results.tradeValues.begin(), results.tradeValues.end(), 0.0);
+
+    for (size_t i = 0; i < modelIds.size(); ++i)
+    {
+        auto it = find(results.modelIds.begin(), results.modelIds.end(), modelIds[i]);
+        const size_t m = distance(results.modelIds.begin(), it);
+        if (it == results.modelIds.end())
+        {
+            results.modelIds.push_back(modelIds[i]);
+            results.paramIds.push_back(models[i]->parameterLabels());
+            results.risks.emplace_back(simulResults.risks[i].size(), 0.0);
+        }
+        for (size_t j = 0; j < simulResults.risks[i].size(); ++j) results.risks[m][j] += simulResults.risks[i][j];
+    }
 
     return results;
 }
@@ -266,6 +568,64 @@ struct RiskReports
 };
 
 //  Itemized AAD risk, one per payoff
+inline RiskReports AADriskMulti(
+    const Model<Number>&    model,
+    const Product<Number>&  product,
+    const NumericalParam&   num)
+{
+    RiskReports results;
+
+    //  Random Number Generator
+    unique_ptr<RNG> rng = makeRng(num);
+
+    //  Simulate
+    const auto simulResults = num.parallel
+		? mcParallelSimulAADMulti(product, model, *rng, num.numPath, false, num.job, num.maxThreads)
+        : mcSimulAADMulti(product, model, *rng, num.numPath);
+
+    results.params = model.parameterLabels();
+    results.payoffs = product.payoffLabels();
+	results.risks = move(simulResults.risks);
+
+	//	Average values across paths
+	const size_t nPayoffs = product.payoffLabels().size();
+	results.values.resize(nPayoffs);
+	averagePayoffs(simulResults.payoffs, nPayoffs, results.values.data());
+
+    return results;
+}
+
+//  Same, writes into caller-owned buffers, see compFinance.h: 
+//      values of the nPay payoffs, 
+//      and risks of the nPay payoffs to the nParam parameters, 
+//      row major with parameters in rows, as RiskReports
+inline void AADriskMulti(
+    const Model<Number>&    model,
+    const Product<Number>&  product,
+    const NumericalParam&   num,
+    //  results
+    double*                 values,
+    double*                 risks)
+{
+    //  Random Number Generator
+    unique_ptr<RNG> rng = makeRng(num);
+
+    //  Simulate
+    const auto simulResults = num.parallel
+        ? mcParallelSimulAADMulti(product, model, *rng, num.numPath, false, num.job, num.maxThreads)
+        : mcSimulAADMulti(product, model, *rng, num.numPath);
+
+    const size_t nPayoffs = product.payoffLabels().size();
+    averagePayoffs(simulResults.payoffs, nPayoffs, values);
+
+    //  Rows of the risk matrix are padded, see matrix.h
+    for (size_t i = 0; i < simulResults.risks.rows(); ++i)
+    {
+        copy(simulResults.risks[i], simulResults.risks[i] + nPayoffs, risks + i * nPayoffs);
+    }
+}
+
+//  Overload that picks product and model by name in the store
 inline RiskReports AADriskMulti(
     const string&           modelId,
     const string&           productId,
@@ -279,92 +639,540 @@ inline RiskReports AADriskMulti(
         throw runtime_error("AADrisk() : Could not retrieve model and product");
     }
 
-    RiskReports results;
+    return AADriskMulti(*model, *product, tradeParam(num, modelId, productId));
+}
+
+//  Itemized AAD risk in sparse form:
+//      same as AADriskMulti() with the matrix of risks in CSR form, 
+//      only the non-zero sensitivities are stored
+//  For books where most payoffs depend on few parameters,
+//      like European options of many maturities in Dupire
+
+struct SparseRiskReports
+{
+    vector<string>      payoffs;
+    vector<string>      params;
+    vector<double>      values;
+    csrMatrix<double>   risks;
+};
+
+inline SparseRiskReports AADriskMultiSparse(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num)
+{
+    const Model<Number>* model = getModel<Number>(modelId);
+    const Product<Number>* product = getProduct<Number>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("AADriskMultiSparse() : Could not retrieve model and product");
+    }
+
+    SparseRiskReports results;
 
     //  Random Number Generator
-    unique_ptr<RNG> rng;
-    if (num.useSobol) rng = make_unique<Sobol>();
-    else rng = make_unique<mrg32k3a>(num.seed1, num.seed2);
+    unique_ptr<RNG> rng = makeRng(num, modelId, productId);
 
     //  Simulate
-    const auto simulResults = num.parallel
-		? mcParallelSimulAADMulti(*product, *model, *rng, num.numPath)
-        : mcSimulAADMulti(*product, *model, *rng, num.numPath);
+    auto simulResults = num.parallel
+        ? mcParallelSimulAADMulti(*product, *model, *rng, num.numPath, true, num.job, num.maxThreads)
+        : mcSimulAADMulti(*product, *model, *rng, num.numPath, true);
 
     results.params = model->parameterLabels();
     results.payoffs = product->payoffLabels();
-	results.risks = move(simulResults.risks);
+    results.risks = move(simulResults.sparseRisks);
 
-	//	Average values across paths
-	const size_t nPayoffs = product->payoffLabels().size();
-	results.values.resize(nPayoffs);
-	for (size_t i = 0; i < nPayoffs; ++i)
-	{
-		results.values[i] = accumulate(
-			simulResults.payoffs.begin(),
-			simulResults.payoffs.end(),
-			0.0,
-			[i](const double acc, const vector<double>& v) { return acc + v[i]; }
-		) / num.numPath;
-	}
+    //	Average values across paths
+    const size_t nPayoffs = product->payoffLabels().size();
+    results.values.resize(nPayoffs);
+    averagePayoffs(simulResults.payoffs, nPayoffs, results.values.data());
 
     return results;
 }
 
-//  Bump risk, itemized
-//  Same result format as AADriskMulti()
-inline RiskReports bumpRisk(
+//  Error of float local derivatives on tape, see AAD.h
+//  Itemized AAD risks with double and float derivatives, on the same paths:
+//      float storage is emulated in the backward sweep, see Tape::emulateFloatDers,
+//      so the report runs in a double build
+//  For every payoff: largest risk in absolute value, 
+//      largest absolute difference between the two, and their ratio
+
+struct PrecisionReport
+{
+    vector<string>  payoffs;
+    vector<double>  maxRisks;
+    vector<double>  maxErrors;
+    vector<double>  relErrors;
+};
+
+inline PrecisionReport precisionReport(
     const string&           modelId,
     const string&           productId,
     const NumericalParam&   num)
 {
-    auto* orig = getModel<double>(modelId);
-    const Product<double>* product = getProduct<double>(productId);
+#if AADFLOATDERS
+    throw runtime_error("precisionReport() : requires a build with double derivatives, see AAD.h");
+#endif
+
+    const RiskReports doubles = AADriskMulti(modelId, productId, num);
 
-    if (!orig || !product)
+    //  Emulation on this thread and in the tasks of this calculation only,
+    //      other calculations running meanwhile are unaffected
+    RiskReports floats;
     {
-        throw runtime_error("bumpRisk() : Could not retrieve model and product");
+        floatDersEmulation emulation(true);
+        floats = AADriskMulti(modelId, productId, num);
     }
 
-    RiskReports results;
+    PrecisionReport results;
+    results.payoffs = doubles.payoffs;
+    const size_t nParam = doubles.risks.rows(), nPay = doubles.risks.cols();
+    results.maxRisks.assign(nPay, 0.0);
+    results.maxErrors.assign(nPay, 0.0);
+    results.relErrors.assign(nPay, 0.0);
 
-    //  base values
-    auto baseRes = value(*orig, *product, num);
-    results.payoffs = baseRes.identifiers;
-	results.values = baseRes.values;
+    for (size_t i = 0; i < nParam; ++i)
+    {
+        for (size_t j = 0; j < nPay; ++j)
+        {
+            results.maxRisks[j] = max(results.maxRisks[j], fabs(doubles.risks[i][j]));
+            results.maxErrors[j] = max(results.maxErrors[j], fabs(floats.risks[i][j] - doubles.risks[i][j]));
+        }
+    }
+    for (size_t j = 0; j < nPay; ++j)
+    {
+        if (results.maxRisks[j] > 0.0) results.relErrors[j] = results.maxErrors[j] / results.maxRisks[j];
+    }
+
+    return results;
+}
 
+//  Bump risk, itemized
+//  Writes into caller-owned buffers, same format as AADriskMulti()
+inline void bumpRisk(
+    const Model<double>&    orig,
+    const Product<double>&  product,
+    const NumericalParam&   num,
+    //  results
+    double*                 values,
+    double*                 risks)
+{
     //  make copy so we don't modify the model in memory
-    auto model = orig->clone();
-    
-    results.params = model->parameterLabels();
+    auto model = orig.clone();
     const vector<double*> parameters = model->parameters();
-    const size_t n = parameters.size(), m = results.payoffs.size();
-    results.risks.resize(n, m);
+    const size_t n = parameters.size();
+    const size_t m = product.payoffLabels().size();
+
+    //  Asynchronous job: one simulation per parameter, plus the base
+    if (num.job) num.job->expectBatches((n + 1) * JobControl::numBatches(num.numPath));
+
+    //  base values
+    value(orig, product, num, values);
 
     //  bumps
+    vector<double> bumped(m);
     for (size_t i = 0; i < n; ++i)
     {
         *parameters[i] += 1.e-08;
-        auto bumpRes = value(*model, *product, num);
+        value(*model, product, num, bumped.data());
         *parameters[i] -= 1.e-08;
 
         for (size_t j = 0; j < m; ++j)
         {
-            results.risks[i][j] = 1.0e+08 *
-                (bumpRes.values[j] - baseRes.values[j]);
+            risks[i * m + j] = 1.0e+08 * (bumped[j] - values[j]);
         }
     }
+}
+
+//  Same, returns RiskReports
+inline RiskReports bumpRisk(
+    const Model<double>&    orig,
+    const Product<double>&  product,
+    const NumericalParam&   num)
+{
+    RiskReports results;
+
+    results.payoffs = product.payoffLabels();
+    results.params = orig.parameterLabels();
+    const size_t n = results.params.size(), m = results.payoffs.size();
+
+    results.values.resize(m);
+    vector<double> risks(n * m);
+    bumpRisk(orig, product, num, results.values.data(), risks.data());
+
+    results.risks.resize(n, m);
+    for (size_t i = 0; i < n; ++i)
+    {
+        copy(risks.begin() + i * m, risks.begin() + (i + 1) * m, results.risks[i]);
+    }
 
     return results;
 }
 
-//  Dupire specific
-
-//  Returns a struct with price, delta and vega matrix
-inline auto dupireAADRisk(
-    //  model id
+//  Overload that picks product and model by name in the store
+inline RiskReports bumpRisk(
     const string&           modelId,
-    //  product id
+    const string&           productId,
+    const NumericalParam&   num)
+{
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("bumpRisk() : Could not retrieve model and product");
+    }
+
+    return bumpRisk(*model, *product, tradeParam(num, modelId, productId));
+}
+
+//  Asynchronous jobs
+
+//  Handle on a calculation running in the background
+//  The calculation runs on a thread of its own, its batches on the thread pool
+//      with the priority of the job: interactive batches are served 
+//      before batch ones, so short requests are not stuck behind long runs
+//  The thread of the job also runs batches while it waits, see ThreadPool::activeWait()
+template <class R>
+class AsyncJob
+{
+    shared_ptr<JobControl>  myControl;
+    shared_future<R>        myResult;
+
+public:
+
+    AsyncJob() {}
+    AsyncJob(const shared_ptr<JobControl>& control, const shared_future<R>& result) :
+        myControl(control), myResult(result) {}
+
+    //  Progress: batches completed and total, and their ratio
+    size_t batchesDone() const { return myControl->batchesDone(); }
+    size_t batchesTotal() const { return myControl->batchesTotal(); }
+    double progress() const { return myControl->progress(); }
+
+    //  Partial estimates of the payoffs with standard errors
+    JobControl::Estimates estimates() const { return myControl->estimates(); }
+
+    //  Cooperative cancellation, effective at the end of the running batches
+    void cancel() { myControl->cancel(); }
+    bool cancelled() const { return myControl->cancelled(); }
+
+    //  Completed, cancelled or failed?
+    bool ready() const
+    {
+        return myResult.wait_for(0s) == future_status::ready;
+    }
+
+    //  Result, blocks until ready
+    //  Throws if the calculation failed or was cancelled
+    const R& get() const
+    {
+        return myResult.get();
+    }
+};
+
+//  Run calc(num) asynchronously, with num.job set and parallel simulations
+//  The calculation must own (or share ownership of) its model and product:
+//      the store may change while the job runs
+//  The pool need not have workers: the controller thread of the job
+//      runs the batches of its lane, see ThreadPool::activeWait()
+template <class F>
+inline auto submitJob(
+    F                       calc,
+    const NumericalParam&   num,
+    const TaskPriority      priority = TaskPriority::interactive)
+{
+    using R = decltype(calc(num));
+
+    auto control = make_shared<JobControl>(priority);
+    auto task = make_shared<packaged_task<R()>>([calc, num, control]()
+    {
+        //  This thread's own tape, thread local, see AAD.cpp
+        Tape tape;
+        Number::tape = &tape;
+
+        NumericalParam jobNum = num;
+        jobNum.parallel = true;
+        jobNum.job = control.get();
+        return calc(jobNum);
+    });
+    shared_future<R> result = task->get_future().share();
+
+    thread([task]() { (*task)(); }).detach();
+
+    return AsyncJob<R>(control, result);
+}
+
+//  Asynchronous versions of value(), AADriskOne(), AADriskMulti() and bumpRisk()
+//  Model and product are copied from the store on submission
+
+inline auto submitValue(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const TaskPriority      priority = TaskPriority::interactive)
+{
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("submitValue() : Could not retrieve model and product");
+    }
+
+    shared_ptr<Model<double>> mdl = model->clone();
+    shared_ptr<Product<double>> prd = product->clone();
+
+    return submitJob([mdl, prd](const NumericalParam& n) { return value(*mdl, *prd, n); }, 
+        tradeParam(num, modelId, productId), priority);
+}
+
+inline auto submitAADriskOne(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const string&           riskPayoff = "",
+    const TaskPriority      priority = TaskPriority::interactive)
+{
+    const Model<Number>* model = getModel<Number>(modelId);
+    const Product<Number>* product = getProduct<Number>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("submitAADriskOne() : Could not retrieve model and product");
+    }
+
+    shared_ptr<Model<Number>> mdl = model->clone();
+    shared_ptr<Product<Number>> prd = product->clone();
+
+    return submitJob([mdl, prd, riskPayoff](const NumericalParam& n) 
+    { 
+        return AADriskOne(*mdl, *prd, n, riskPayoff); 
+    }, 
+        tradeParam(num, modelId, productId), priority);
+}
+
+inline auto submitAADriskMulti(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const TaskPriority      priority = TaskPriority::interactive)
+{
+    const Model<Number>* model = getModel<Number>(modelId);
+    const Product<Number>* product = getProduct<Number>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("submitAADriskMulti() : Could not retrieve model and product");
+    }
+
+    shared_ptr<Model<Number>> mdl = model->clone();
+    shared_ptr<Product<Number>> prd = product->clone();
+
+    return submitJob([mdl, prd](const NumericalParam& n) { return AADriskMulti(*mdl, *prd, n); }, 
+        tradeParam(num, modelId, productId), priority);
+}
+
+inline auto submitBumpRisk(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const TaskPriority      priority = TaskPriority::interactive)
+{
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("submitBumpRisk() : Could not retrieve model and product");
+    }
+
+    shared_ptr<Model<double>> mdl = model->clone();
+    shared_ptr<Product<double>> prd = product->clone();
+
+    return submitJob([mdl, prd](const NumericalParam& n) { return bumpRisk(*mdl, *prd, n); }, 
+        tradeParam(num, modelId, productId), priority);
+}
+
+//  Means and covariances of forwards and increments on the event dates of the product,
+//      typically MultiStats, computed with the statistics engine of mcStats.h
+inline StatsSimulResults forwardStats(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num)
+{
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("forwardStats() : Could not retrieve model and product");
+    }
+
+    unique_ptr<RNG> rng = makeRng(num, modelId, productId);
+
+    return num.parallel
+        ? mcParallelSimulStats(*product, *model, *rng, num.numPath, num.maxThreads)
+        : mcSimulStats(*product, *model, *rng, num.numPath);
+}
+
+//  Pre-flight estimate of the wall time and peak memory
+//      of value(), AADriskOne() or AADriskMulti(),
+//      from nPilot paths simulated on the calling thread, see mcCost.h
+
+//  Valuation
+inline CostEstimate estimateCost(
+    const Model<double>&    model,
+    const Product<double>&  product,
+    const NumericalParam&   num,
+    const size_t            nPilot = 16)
+{
+    if (!nPilot) throw runtime_error("estimateCost() : at least one pilot path required");
+
+    unique_ptr<RNG> rng = makeRng(num);
+    CostEstimate est = mcPilot(product, model, *rng, nPilot);
+    extrapolateCost(est, num.numPath, product.payoffLabels().size(), num.parallel, num.maxThreads);
+
+    return est;
+}
+
+//  AAD risk, of one aggregate or all payoffs (multi)
+inline CostEstimate estimateCost(
+    const Model<Number>&    model,
+    const Product<Number>&  product,
+    const NumericalParam&   num,
+    const bool              multi,
+    const size_t            nPilot = 16)
+{
+    if (!nPilot) throw runtime_error("estimateCost() : at least one pilot path required");
+
+    unique_ptr<RNG> rng = makeRng(num);
+    CostEstimate est = mcPilotAAD(product, model, *rng, nPilot, multi, 
+        defaultAggregator, multi ? GreekEstimator::Pathwise : num.estimator);
+    extrapolateCost(est, num.numPath, product.payoffLabels().size(), num.parallel, num.maxThreads);
+
+    return est;
+}
+
+//  From the store
+inline CostEstimate estimateCost(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const CostedCalculation calculation,
+    const size_t            nPilot = 16)
+{
+    if (calculation == CostedCalculation::Value)
+    {
+        const Model<double>* model = getModel<double>(modelId);
+        const Product<double>* product = getProduct<double>(productId);
+
+        if (!model || !product)
+        {
+            throw runtime_error("estimateCost() : Could not retrieve model and product");
+        }
+
+        return estimateCost(*model, *product, tradeParam(num, modelId, productId), nPilot);
+    }
+    else
+    {
+        const Model<Number>* model = getModel<Number>(modelId);
+        const Product<Number>* product = getProduct<Number>(productId);
+
+        if (!model || !product)
+        {
+            throw runtime_error("estimateCost() : Could not retrieve model and product");
+        }
+
+        return estimateCost(*model, *product, tradeParam(num, modelId, productId), 
+            calculation == CostedCalculation::AADRiskMulti, nPilot);
+    }
+}
+
+//  Quantiles of the distributions of the payoffs, 
+//      like potential future exposures or values at risk,
+//      streamed into sketches of accuracy k, see mcSinks.h
+struct QuantileResults
+{
+    vector<string>  identifiers;
+    vector<double>  values;
+    //  Payoffs in rows, probabilities in columns
+    matrix<double>  quantiles;
+    //  Rank errors of the quantiles
+    vector<double>  rankErrors;
+};
+
+inline QuantileResults quantiles(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num,
+    const vector<double>&   probs,
+    const size_t            k = 1000)
+{
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("quantiles() : Could not retrieve model and product");
+    }
+
+    unique_ptr<RNG> rng = makeRng(num, modelId, productId);
+
+    QuantileSink sink(k);
+    if (num.parallel) mcParallelSimul(*product, *model, *rng, num.numPath, 
+        num.job, num.generatorThreads, num.maxThreads, &sink);
+    else mcSimul(*product, *model, *rng, num.numPath, &sink);
+
+    QuantileResults results;
+    results.identifiers = product->payoffLabels();
+    const size_t nPay = results.identifiers.size();
+    results.values.resize(nPay);
+    results.rankErrors.resize(nPay);
+    results.quantiles.resize(nPay, probs.size());
+    for (size_t j = 0; j < nPay; ++j)
+    {
+        const QuantileSketch& sketch = sink.sketch(j);
+        results.values[j] = sketch.mean();
+        results.rankErrors[j] = sketch.rankError();
+        for (size_t i = 0; i < probs.size(); ++i)
+        {
+            results.quantiles[j][i] = sketch.quantile(probs[i]);
+        }
+    }
+
+    return results;
+}
+
+//  Same with AAD sensitivities of means and covariances to all model parameters
+inline StatsSimulResults AADforwardStats(
+    const string&           modelId,
+    const string&           productId,
+    const NumericalParam&   num)
+{
+    const Model<Number>* model = getModel<Number>(modelId);
+    const Product<Number>* product = getProduct<Number>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("AADforwardStats() : Could not retrieve model and product");
+    }
+
+    unique_ptr<RNG> rng = makeRng(num, modelId, productId);
+
+    return num.parallel
+        ? mcParallelSimulStatsAAD(*product, *model, *rng, num.numPath, num.maxThreads)
+        : mcSimulStatsAAD(*product, *model, *rng, num.numPath);
+}
+
+//  Dupire specific
+
+//  Returns a struct with price, delta and vega matrix
+inline auto dupireAADRisk(
+    //  model id
+    const string&           modelId,
+    //  product id
     const string&           productId,
     const map<string, double>&   notionals,
     //  numerical parameters
@@ -410,6 +1218,173 @@ inline auto dupireAADRisk(
     return results;
 }
 
+//  PDE risk, itemized, for single asset products in BlackScholes or Dupire
+//  See pde.h
+//  Same result format as AADriskMulti()
+inline RiskReports pdeRisk(
+    const string&           modelId,
+    const string&           productId,
+    const PdeParam&         pde)
+{
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+
+    if (!model || !product)
+    {
+        throw runtime_error("pdeRisk() : Could not retrieve model and product");
+    }
+
+    Pde1D solver(*model, *product, pde);
+    PdeResults pdeResults = solver.solve();
+
+    RiskReports results;
+    results.payoffs = move(pdeResults.payoffs);
+    results.params = move(pdeResults.params);
+    results.values = move(pdeResults.values);
+    results.risks = move(pdeResults.risks);
+
+    return results;
+}
+
+//  Same as dupireAADRisk() with the PDE
+inline auto dupirePdeRisk(
+    //  model id
+    const string&           modelId,
+    //  product id
+    const string&           productId,
+    const map<string, double>&   notionals,
+    //  numerical parameters
+    const PdeParam&         pde)
+{
+    //  Check that the model is a Dupire
+    const Dupire<double>* dupire = dynamic_cast<const Dupire<double>*>(getModel<double>(modelId));
+    if (!dupire)
+    {
+        throw runtime_error("dupirePdeRisk() : Model not found or not a Dupire");
+    }
+
+    //  Results
+    struct
+    {
+        double value;
+        double delta;
+        matrix<double> vega;
+    } results;
+
+    //  Go
+    const RiskReports itemized = pdeRisk(modelId, productId, pde);
+
+    //  Aggregate
+    vector<double> vnots(itemized.payoffs.size(), 0.0);
+    for (const auto& notional : notionals)
+    {
+        auto it = find(itemized.payoffs.begin(), itemized.payoffs.end(), notional.first);
+        if (it == itemized.payoffs.end())
+        {
+            throw runtime_error("dupirePdeRisk() : payoff not found");
+        }
+        vnots[distance(itemized.payoffs.begin(), it)] = notional.second;
+    }
+
+    //  Value
+    results.value = inner_product(vnots.begin(), vnots.end(), itemized.values.begin(), 0.0);
+
+    //  Delta
+    results.delta = inner_product(vnots.begin(), vnots.end(), itemized.risks[0], 0.0);
+
+    //  Vegas
+    results.vega.resize(dupire->spots().size(), dupire->times().size());
+    auto vegaIt = results.vega.begin();
+    for (size_t k = 1; k < itemized.risks.rows(); ++k, ++vegaIt)
+    {
+        *vegaIt = inner_product(vnots.begin(), vnots.end(), itemized.risks[k], 0.0);
+    }
+
+    return results;
+}
+
+//  Convergence report: value of one payoff against number of time steps
+//  One line for uniform Euler steps for every maxDt in maxDts,
+//      then one line for adaptive steps with the trapezoidal scheme
+//      for every tolerance in tolerances, with the model's maxDt as a cap
+inline auto dupireConvergence(
+    //  model id
+    const string&           modelId,
+    //  product id
+    const string&           productId,
+    const vector<double>&   maxDts,
+    const vector<double>&   tolerances,
+    //  numerical parameters
+    const NumericalParam&   num,
+    //  payoff, first one if omitted
+    const string&           payoffId = "")
+{
+    //  Check that the model is a Dupire
+    const Model<double>* model = getModel<double>(modelId);
+    const Product<double>* product = getProduct<double>(productId);
+    if (!model || !product)
+    {
+        throw runtime_error("dupireConvergence() : Could not retrieve model and product");
+    }
+    if (!dynamic_cast<const Dupire<double>*>(model))
+    {
+        throw runtime_error("dupireConvergence() : Model not a Dupire");
+    }
+
+    //  Find the payoff
+    size_t payoffIdx = 0;
+    if (!payoffId.empty())
+    {
+        const vector<string>& allPayoffs = product->payoffLabels();
+        auto it = find(allPayoffs.begin(), allPayoffs.end(), payoffId);
+        if (it == allPayoffs.end())
+        {
+            throw runtime_error("dupireConvergence() : payoff not found");
+        }
+        payoffIdx = distance(allPayoffs.begin(), it);
+    }
+
+    //  Results
+    struct
+    {
+        vector<string> labels;
+        vector<double> steps;
+        vector<double> values;
+    } results;
+
+    //  Value on a copy of the model with given numerics
+    auto run = [&](const Time maxDt, const double tolerance, const bool trapezoid, const string& label)
+    {
+        auto cMdl = model->clone();
+        auto* dupire = dynamic_cast<Dupire<double>*>(cMdl.get());
+        dupire->setNumerics(maxDt, tolerance, trapezoid);
+
+        //  Number of steps
+        dupire->allocate(product->timeline(), product->defline());
+
+        results.labels.push_back(label);
+        results.steps.push_back(double(dupire->simDim()));
+        results.values.push_back(value(*dupire, *product, num).values[payoffIdx]);
+    };
+
+    for (const double maxDt : maxDts)
+    {
+        ostringstream ost;
+        ost << "uniform euler " << maxDt;
+        run(maxDt, 0.0, false, ost.str());
+    }
+
+    const Time capDt = dynamic_cast<const Dupire<double>*>(model)->maxDt();
+    for (const double tolerance : tolerances)
+    {
+        ostringstream ost;
+        ost << "adaptive trapezoid " << tolerance;
+        run(capDt, tolerance, true, ost.str());
+    }
+
+    return results;
+}
+
 //  Returns spots, times and lVols in a struct
 inline auto
 dupireCalib(
@@ -437,6 +1412,45 @@ dupireCalib(
     return dupireCalib(ivs, inclSpots, maxDs, inclTimes, maxDt);
 }
 
+//  Merton calls on a vector of strikes, speed and accuracy:
+//      Poisson series of analytics.h strike by strike
+//      against the COS pricer in one pass
+//  Returns both prices and both timings in milliseconds
+inline auto mertonComparison(
+    const double            spot,
+    const double            vol,
+    const Time              mat,
+    const double            jmpIntens,
+    const double            jmpAverage,
+    const double            jmpStd,
+    const vector<double>&   strikes,
+    const size_t            numTerms = 256)
+{
+    struct
+    {
+        vector<double>  series;
+        vector<double>  cos;
+        double          seriesTime;
+        double          cosTime;
+    } results;
+
+    clock_t t0 = clock();
+    results.series.resize(strikes.size());
+    transform(strikes.begin(), strikes.end(), results.series.begin(),
+        [&](const double strike) 
+    { 
+        return merton(spot, strike, vol, mat, jmpIntens, jmpAverage, jmpStd); 
+    });
+    clock_t t1 = clock();
+    results.cos = mertonCos(spot, strikes, vol, mat, jmpIntens, jmpAverage, jmpStd, numTerms);
+    clock_t t2 = clock();
+
+    results.seriesTime = 1000.0 * (t1 - t0) / CLOCKS_PER_SEC;
+    results.cosTime = 1000.0 * (t2 - t1) / CLOCKS_PER_SEC;
+
+    return results;
+}
+
 //  Superbucket
 
 struct SuperbucketResults
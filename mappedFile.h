@@ -0,0 +1,356 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Temporary file mapped in memory by chunks
+//  Used by the blocklist to back blocks of the tape with disk storage,
+//      see blocklist.h
+
+//  The file is deleted when closed
+//  The file grows, and is mapped, by extents of many chunks,
+//      so the number of mappings stays small (see vm.max_map_count on Linux)
+//  Extents are never remapped: the address of a chunk remains valid
+//      for as long as the file is open, as the tape requires
+//  Released chunks are written back and dropped from RAM,
+//      their contents is read back from disk on the next access
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#else
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+
+#endif
+
+class mappedFile
+{
+#ifdef _WIN32
+    HANDLE              myFile = INVALID_HANDLE_VALUE;
+#else
+    int                 myFile = -1;
+#endif
+
+    //  Current size of the file
+    size_t              mySize = 0;
+
+    //  Mapped extents, and the bytes of the last one given out in chunks
+    struct extent
+    {
+        void*           addr;
+        size_t          size;
+    };
+    vector<extent>      myExtents;
+    size_t              myUsed = 0;
+
+    //  Extents double with the file, within these bounds
+    static constexpr size_t minExtent = size_t(16) << 20;
+    static constexpr size_t maxExtent = size_t(1) << 30;
+
+    //  Map offsets must be multiples of this
+    static size_t granularity()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+#else
+        return sysconf(_SC_PAGESIZE);
+#endif
+    }
+
+    //  Extend the file by n bytes (n from chunkSize) and map them
+    void* mapExtent(const size_t n)
+    {
+        const size_t offset = mySize;
+        mySize += n;
+
+#ifdef _WIN32
+        const unsigned long long end = mySize;
+        HANDLE map = CreateFileMappingA(myFile, nullptr, PAGE_READWRITE,
+            DWORD(end >> 32), DWORD(end & 0xffffffff), nullptr);
+        if (!map)
+        {
+            throw runtime_error("mappedFile : could not map temporary file");
+        }
+        const unsigned long long off = offset;
+        void* addr = MapViewOfFile(map, FILE_MAP_ALL_ACCESS,
+            DWORD(off >> 32), DWORD(off & 0xffffffff), n);
+        //  The view keeps the mapping alive
+        CloseHandle(map);
+        if (!addr)
+        {
+            throw runtime_error("mappedFile : could not map temporary file");
+        }
+#else
+        if (ftruncate(myFile, mySize) != 0)
+        {
+            throw runtime_error("mappedFile : could not extend temporary file");
+        }
+        void* addr = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED, myFile, offset);
+        if (addr == MAP_FAILED)
+        {
+            throw runtime_error("mappedFile : could not map temporary file");
+        }
+#endif
+
+        return addr;
+    }
+
+public:
+
+    mappedFile() {}
+    mappedFile(const mappedFile&) = delete;
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    ~mappedFile()
+    {
+        close();
+    }
+
+    bool isOpen() const
+    {
+#ifdef _WIN32
+        return myFile != INVALID_HANDLE_VALUE;
+#else
+        return myFile >= 0;
+#endif
+    }
+
+    //  Size of a chunk that fits n bytes
+    static size_t chunkSize(const size_t n)
+    {
+        const size_t g = granularity();
+        return (n + g - 1) / g * g;
+    }
+
+    //  Open a new temporary file in the given directory,
+    //      or the system's temporary directory if empty
+    void open(const string& dir = "")
+    {
+        close();
+
+#ifdef _WIN32
+        char path[MAX_PATH + 1], name[MAX_PATH + 1];
+        if (dir.empty()) GetTempPathA(MAX_PATH, path);
+        else strncpy_s(path, dir.c_str(), MAX_PATH);
+        if (!GetTempFileNameA(path, "tap", 0, name))
+        {
+            throw runtime_error("mappedFile : could not create temporary file");
+        }
+        myFile = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if (myFile == INVALID_HANDLE_VALUE)
+        {
+            throw runtime_error("mappedFile : could not open temporary file");
+        }
+#else
+        string folder = dir;
+        if (folder.empty())
+        {
+            const char* tmp = getenv("TMPDIR");
+            folder = tmp ? tmp : "/tmp";
+        }
+        string name = folder + "/tapeXXXXXX";
+        vector<char> buf(name.begin(), name.end());
+        buf.push_back(0);
+        myFile = mkstemp(buf.data());
+        if (myFile < 0)
+        {
+            throw runtime_error("mappedFile : could not create temporary file");
+        }
+        //  Deleted on close
+        unlink(buf.data());
+#endif
+
+        mySize = 0;
+    }
+
+    //  Unmap all the chunks and delete the file
+    void close()
+    {
+        for (const extent& e : myExtents)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(e.addr);
+#else
+            munmap(e.addr, e.size);
+#endif
+        }
+        myExtents.clear();
+        myUsed = 0;
+
+#ifdef _WIN32
+        if (myFile != INVALID_HANDLE_VALUE) CloseHandle(myFile);
+        myFile = INVALID_HANDLE_VALUE;
+#else
+        if (myFile >= 0) ::close(myFile);
+        myFile = -1;
+#endif
+        mySize = 0;
+    }
+
+    //  Chunk of n bytes (n from chunkSize), in the last extent,
+    //      or in a new one if it doesn't fit
+    //  Chunks stay mapped until the file is closed
+    void* mapChunk(const size_t n)
+    {
+        if (myExtents.empty() || myUsed + n > myExtents.back().size)
+        {
+            const size_t size = chunkSize(max(n, min(max(mySize, minExtent), maxExtent)));
+            myExtents.push_back({ mapExtent(size), size });
+            myUsed = 0;
+        }
+
+        void* addr = static_cast<char*>(myExtents.back().addr) + myUsed;
+        myUsed += n;
+        return addr;
+    }
+
+    //  Start writing a chunk to disk and drop it from RAM
+    //  Chunks are released in the order they are recorded,
+    //      so the writes are sequential
+    static void releaseChunk(void* addr, const size_t n)
+    {
+#ifdef _WIN32
+        FlushViewOfFile(addr, n);
+        //  Unlocking pages that are not locked removes them from the working set
+        VirtualUnlock(addr, n);
+#else
+        msync(addr, n, MS_ASYNC);
+        //  Shared file mapping: pages are read back from the file on next access
+        madvise(addr, n, MADV_DONTNEED);
+#endif
+    }
+
+    //  Hint that a chunk will be accessed soon, starts reading it from disk
+    static void prefetchChunk(void* addr, const size_t n)
+    {
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = addr;
+        range.NumberOfBytes = n;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        madvise(addr, n, MADV_WILLNEED);
+#endif
+    }
+};
+
+//  Existing file mapped read only, whole
+//  Used by caches of data persisted across runs and shared across processes,
+//      see qmcCache.h
+//  Pages are shared by all the processes mapping the same file
+class mappedView
+{
+    const void*         myAddr = nullptr;
+    size_t              mySize = 0;
+
+public:
+
+    mappedView() {}
+    mappedView(const mappedView&) = delete;
+    mappedView& operator=(const mappedView&) = delete;
+
+    ~mappedView()
+    {
+        close();
+    }
+
+    //  False if the file does not exist or is empty
+    bool open(const string& path)
+    {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, 
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || !size.QuadPart)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        //  The view keeps the file and the mapping alive
+        CloseHandle(file);
+        if (!map) return false;
+        const void* addr = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(map);
+        if (!addr) return false;
+        mySize = size_t(size.QuadPart);
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        struct stat info;
+        if (fstat(file, &info) != 0 || !info.st_size)
+        {
+            ::close(file);
+            return false;
+        }
+        void* addr = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+        //  The mapping keeps the file alive
+        ::close(file);
+        if (addr == MAP_FAILED) return false;
+        mySize = size_t(info.st_size);
+#endif
+
+        myAddr = addr;
+        return true;
+    }
+
+    void close()
+    {
+        if (!myAddr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(myAddr);
+#else
+        munmap(const_cast<void*>(myAddr), mySize);
+#endif
+        myAddr = nullptr;
+        mySize = 0;
+    }
+
+    const void* data() const
+    {
+        return myAddr;
+    }
+
+    size_t size() const
+    {
+        return mySize;
+    }
+};
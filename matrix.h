@@ -1,26 +1,182 @@
 #pragma once
 
 #include <vector>
+#include <new>
+#include <iterator>
+#include <type_traits>
+#include <algorithm>
 using namespace std;
 
+#if defined(__AVX__) || defined(_M_X64) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 //  Simple matrix class that wraps a vector,
 //  See chapters 1 and 2
 
+//  Matrices of doubles are stored with rows aligned on cache lines
+//      and padded so the leading dimension is a multiple of the SIMD width,
+//      other types (Number) are stored contiguously as before
+//  The API is unchanged: [] gives a pointer on a row,
+//      iterators run over the rows * cols elements, skipping the padding
+
+//  Allocator for aligned storage
+template <class T, size_t Align>
+struct alignedAllocator
+{
+    using value_type = T;
+    template <class U> struct rebind { using other = alignedAllocator<U, Align>; };
+
+    alignedAllocator() noexcept {}
+    template <class U> alignedAllocator(const alignedAllocator<U, Align>&) noexcept {}
+
+    T* allocate(const size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(Align)));
+    }
+    void deallocate(T* p, const size_t) noexcept
+    {
+        ::operator delete(p, align_val_t(Align));
+    }
+
+    template <class U> bool operator==(const alignedAllocator<U, Align>&) const noexcept { return true; }
+    template <class U> bool operator!=(const alignedAllocator<U, Align>&) const noexcept { return false; }
+};
+
+//  Storage layout by type
+template <class T>
+struct matrixLayout
+{
+    static constexpr size_t pad = 1;
+    using storage = vector<T>;
+};
+
+template <>
+struct matrixLayout<double>
+{
+    //  64 bytes: one cache line, one AVX-512 register, two AVX registers
+    static constexpr size_t align = 64;
+    static constexpr size_t pad = align / sizeof(double);
+    using storage = vector<double, alignedAllocator<double, align>>;
+};
+
+//  Iterator over the elements of a padded matrix, row major
+//  Steps along the row and jumps the padding at the end of each row,
+//      random access positions from the index
+template <class V>
+class matrixIterator
+{
+    V*          myBase;
+    size_t      myCols;
+    size_t      myLd;
+    ptrdiff_t   myIdx;
+    //  Current element and its column
+    V*          myPtr;
+    size_t      myCol;
+
+    void position()
+    {
+        if (myCols)
+        {
+            myCol = size_t(myIdx) % myCols;
+            myPtr = myBase + (size_t(myIdx) / myCols) * myLd + myCol;
+        }
+        else
+        {
+            myCol = 0;
+            myPtr = myBase;
+        }
+    }
+
+public:
+
+    using iterator_category = random_access_iterator_tag;
+    using value_type = remove_const_t<V>;
+    using difference_type = ptrdiff_t;
+    using pointer = V*;
+    using reference = V&;
+
+    matrixIterator() : myBase(nullptr), myCols(1), myLd(1), myIdx(0), myPtr(nullptr), myCol(0) {}
+    matrixIterator(V* base, const size_t cols, const size_t ld, const ptrdiff_t idx) :
+        myBase(base), myCols(cols), myLd(ld), myIdx(idx)
+    {
+        position();
+    }
+
+    //  Conversion to const
+    operator matrixIterator<const V>() const
+    {
+        return matrixIterator<const V>(myBase, myCols, myLd, myIdx);
+    }
+
+    reference operator*() const { return *myPtr; }
+    pointer operator->() const { return myPtr; }
+    reference operator[](const difference_type n) const { return *(*this + n); }
+
+    matrixIterator& operator++()
+    {
+        ++myIdx;
+        ++myPtr;
+        if (++myCol == myCols)
+        {
+            myCol = 0;
+            myPtr += myLd - myCols;
+        }
+        return *this;
+    }
+    matrixIterator operator++(int) { auto it = *this; ++*this; return it; }
+    matrixIterator& operator--()
+    {
+        --myIdx;
+        if (myCol == 0)
+        {
+            myCol = myCols;
+            myPtr -= myLd - myCols;
+        }
+        --myCol;
+        --myPtr;
+        return *this;
+    }
+    matrixIterator operator--(int) { auto it = *this; --*this; return it; }
+    matrixIterator& operator+=(const difference_type n) { myIdx += n; position(); return *this; }
+    matrixIterator& operator-=(const difference_type n) { myIdx -= n; position(); return *this; }
+    matrixIterator operator+(const difference_type n) const { auto it = *this; return it += n; }
+    matrixIterator operator-(const difference_type n) const { auto it = *this; return it -= n; }
+    friend matrixIterator operator+(const difference_type n, const matrixIterator& it) { return it + n; }
+    difference_type operator-(const matrixIterator& rhs) const { return myIdx - rhs.myIdx; }
+
+    bool operator==(const matrixIterator& rhs) const { return myIdx == rhs.myIdx; }
+    bool operator!=(const matrixIterator& rhs) const { return myIdx != rhs.myIdx; }
+    bool operator<(const matrixIterator& rhs) const { return myIdx < rhs.myIdx; }
+    bool operator>(const matrixIterator& rhs) const { return myIdx > rhs.myIdx; }
+    bool operator<=(const matrixIterator& rhs) const { return myIdx <= rhs.myIdx; }
+    bool operator>=(const matrixIterator& rhs) const { return myIdx >= rhs.myIdx; }
+};
+
 template <class T>
 class matrix
 {
     size_t      myRows;
     size_t      myCols;
-    vector<T>   myVector;
+    //  Leading dimension, cols rounded up to a multiple of the padding
+    size_t      myLd;
+    typename matrixLayout<T>::storage   myVector;
+
+    static size_t leadingDim(const size_t cols)
+    {
+        constexpr size_t pad = matrixLayout<T>::pad;
+        return (cols + pad - 1) / pad * pad;
+    }
 
 public:
 
     //  Constructors
-    matrix() : myRows(0), myCols(0) {}
-    matrix(const size_t rows, const size_t cols) : myRows(rows), myCols(cols), myVector(rows*cols) {}
+    matrix() : myRows(0), myCols(0), myLd(0) {}
+    matrix(const size_t rows, const size_t cols) :
+        myRows(rows), myCols(cols), myLd(leadingDim(cols)), myVector(rows*myLd) {}
 
     //  Copy, assign
-    matrix(const matrix& rhs) : myRows(rhs.myRows), myCols(rhs.myCols), myVector(rhs.myVector) {}
+    matrix(const matrix& rhs) : myRows(rhs.myRows), myCols(rhs.myCols), myLd(rhs.myLd), myVector(rhs.myVector) {}
     matrix& operator=(const matrix& rhs)
     {
         if (this == &rhs) return *this;
@@ -32,10 +188,10 @@ public:
     //  Copy, assign from different (convertible) type
     template <class U>
     matrix(const matrix<U>& rhs)
-        : myRows(rhs.rows()), myCols(rhs.cols())
+        : myRows(rhs.rows()), myCols(rhs.cols()), myLd(leadingDim(rhs.cols()))
     {
-        myVector.resize(rhs.rows() * rhs.cols());
-        copy(rhs.begin(), rhs.end(), myVector.begin());
+        myVector.resize(myRows * myLd);
+        copy(rhs.begin(), rhs.end(), begin());
     }
     template <class U>
     matrix& operator=(const matrix<U>& rhs)
@@ -47,7 +203,7 @@ public:
     }
 
     //  Move, move assign
-    matrix(matrix&& rhs) : myRows(rhs.myRows), myCols(rhs.myCols), myVector(move(rhs.myVector)) {}
+    matrix(matrix&& rhs) : myRows(rhs.myRows), myCols(rhs.myCols), myLd(rhs.myLd), myVector(move(rhs.myVector)) {}
     matrix& operator=(matrix&& rhs)
     {
         if (this == &rhs) return *this;
@@ -62,6 +218,7 @@ public:
         myVector.swap(rhs.myVector);
         ::swap(myRows, rhs.myRows);
         ::swap(myCols, rhs.myCols);
+        ::swap(myLd, rhs.myLd);
     }
 
     //  Resizer
@@ -69,37 +226,185 @@ public:
     {
         myRows = rows;
         myCols = cols;
-        if (myVector.size() < rows*cols) myVector = vector<T>(rows*cols);
+        myLd = leadingDim(cols);
+        if (myVector.size() < rows*myLd) myVector = typename matrixLayout<T>::storage(rows*myLd);
     }
 
     //  Access
     size_t rows() const { return myRows; }
     size_t cols() const { return myCols; }
+    //  Distance between rows in memory
+    size_t ld() const { return myLd; }
     //  So we can call matrix [i][j]
-    T* operator[] (const size_t row) { return &myVector[row*myCols]; }
-    const T* operator[] (const size_t row) const { return &myVector[row*myCols]; }
+    T* operator[] (const size_t row) { return &myVector[row*myLd]; }
+    const T* operator[] (const size_t row) const { return &myVector[row*myLd]; }
     bool empty() const { return myVector.empty(); }
 
     //  Iterators
-    typedef typename vector<T>::iterator iterator;
-    typedef typename vector<T>::const_iterator const_iterator;
-    iterator begin() { return myVector.begin(); }
-    iterator end() { return myVector.end(); }
-    const_iterator begin() const { return myVector.begin(); }
-    const_iterator end() const { return myVector.end(); }
+    typedef matrixIterator<T> iterator;
+    typedef matrixIterator<const T> const_iterator;
+    iterator begin() { return iterator(myVector.data(), myCols, myLd, 0); }
+    iterator end() { return iterator(myVector.data(), myCols, myLd, myRows * myCols); }
+    const_iterator begin() const { return const_iterator(myVector.data(), myCols, myLd, 0); }
+    const_iterator end() const { return const_iterator(myVector.data(), myCols, myLd, myRows * myCols); }
 };
 
+//  Kernels
+
+//  Transpose, by blocks of TRANSPOSE_BLOCK x TRANSPOSE_BLOCK
+//      so reads and writes both stay in cache
+
+#define TRANSPOSE_BLOCK 32
+
 template <class T>
 inline matrix<T> transpose(const matrix<T>& mat)
 {
     matrix<T> res(mat.cols(), mat.rows());
-    for (size_t i = 0; i < res.rows(); ++i)
+    const size_t n = res.rows(), m = res.cols();
+
+    for (size_t i0 = 0; i0 < n; i0 += TRANSPOSE_BLOCK)
     {
-        for (size_t j = 0; j < res.cols(); ++j)
+        const size_t i1 = min<size_t>(i0 + TRANSPOSE_BLOCK, n);
+        for (size_t j0 = 0; j0 < m; j0 += TRANSPOSE_BLOCK)
         {
-            res[i][j] = mat[j][i];
+            const size_t j1 = min<size_t>(j0 + TRANSPOSE_BLOCK, m);
+            for (size_t i = i0; i < i1; ++i)
+            {
+                T* row = res[i];
+                for (size_t j = j0; j < j1; ++j)
+                {
+                    row[j] = mat[j][i];
+                }
+            }
         }
     }
 
     return res;
 }
+
+//  Dot product of n elements
+template <class T, class U>
+inline auto dot(const T* x, const U* y, const size_t n)
+{
+    using R = conditional_t<is_same_v<T, double>, U, T>;
+    R s(0.0);
+    for (size_t i = 0; i < n; ++i) s += x[i] * y[i];
+    return s;
+}
+
+//  Double specialisation, 4 independent accumulators
+inline double dot(const double* x, const double* y, const size_t n)
+{
+    size_t i = 0;
+
+#if defined(__AVX__)
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8)
+    {
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    alignas(32) double r[4];
+    _mm256_store_pd(r, _mm256_add_pd(s0, s1));
+    double s = (r[0] + r[1]) + (r[2] + r[3]);
+#elif defined(_M_X64) || defined(__SSE2__)
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4)
+    {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    alignas(16) double r[2];
+    _mm_store_pd(r, _mm_add_pd(s0, s1));
+    double s = r[0] + r[1];
+#else
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    for (; i + 4 <= n; i += 4)
+    {
+        s0 += x[i] * y[i];
+        s1 += x[i + 1] * y[i + 1];
+        s2 += x[i + 2] * y[i + 2];
+        s3 += x[i + 3] * y[i + 3];
+    }
+    double s = (s0 + s1) + (s2 + s3);
+#endif
+
+    for (; i < n; ++i) s += x[i] * y[i];
+    return s;
+}
+
+//  Matrix-vector product y = A x
+template <class T, class U, class V>
+inline void matVec(const matrix<T>& A, const U* x, V* y)
+{
+    const size_t n = A.rows(), m = A.cols();
+    for (size_t i = 0; i < n; ++i) y[i] = dot(A[i], x, m);
+}
+
+//  Lower triangular matrix-vector product y = L x,
+//      only the lower triangle of L is read
+template <class T, class U, class V>
+inline void lowerMatVec(const matrix<T>& L, const U* x, V* y)
+{
+    const size_t n = L.rows();
+    for (size_t i = 0; i < n; ++i) y[i] = dot(L[i], x, i + 1);
+}
+
+//  Sparse matrix in compressed sparse row (CSR) form:
+//      the non-zero values row by row, with their column indices,
+//      and for every row the index of its first value, 
+//      so row i is stored in [rowStart[i], rowStart[i + 1])
+//  Built row by row with addRow()
+
+template <class T>
+struct csrMatrix
+{
+    size_t          rows = 0;
+    size_t          cols = 0;
+    vector<size_t>  rowStart = { 0 };
+    vector<size_t>  colIdx;
+    vector<T>       values;
+
+    csrMatrix(const size_t numCols = 0) : cols(numCols) {}
+
+    size_t nonZeros() const { return values.size(); }
+
+    //  Append a row from its dense values, only the non-zeros are stored
+    template <class It>
+    void addRow(It first)
+    {
+        for (size_t j = 0; j < cols; ++j, ++first)
+        {
+            if (*first != T(0.0))
+            {
+                colIdx.push_back(j);
+                values.push_back(*first);
+            }
+        }
+        rowStart.push_back(values.size());
+        ++rows;
+    }
+
+    //  Element access, zero if not stored
+    T operator()(const size_t i, const size_t j) const
+    {
+        const auto b = colIdx.begin() + rowStart[i], e = colIdx.begin() + rowStart[i + 1];
+        const auto it = lower_bound(b, e, j);
+        return it != e && *it == j ? values[it - colIdx.begin()] : T(0.0);
+    }
+
+    //  Dense copy
+    matrix<T> dense() const
+    {
+        matrix<T> res(rows, cols);
+        fill(res.begin(), res.end(), T(0.0));
+        for (size_t i = 0; i < rows; ++i)
+        {
+            for (size_t k = rowStart[i]; k < rowStart[i + 1]; ++k)
+            {
+                res[i][colIdx[k]] = values[k];
+            }
+        }
+        return res;
+    }
+};
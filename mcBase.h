@@ -28,11 +28,16 @@ As long as this comment is preserved at the top of the file
 #include <numeric>
 #include <sstream>
 #include <iomanip>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <exception>
 
 using namespace std;
 
 #include "matrix.h"
-#include "ThreadPool.h"
+#include "threadPool.h"
 
 using Time = double;
 extern Time systemTime;
@@ -64,37 +69,83 @@ struct SampleDef
     vector<vector<Time>>        forwardMats;
 };
 
+//  Read-only view on a contiguous array
+//  Used for path-invariant sample data, shared by all paths
+template <class T>
+class constView
+{
+    const T*    myBegin = nullptr;
+    size_t      mySize = 0;
+
+public:
+
+    constView() {}
+    constView(const vector<T>& v) : myBegin(v.data()), mySize(v.size()) {}
+
+    size_t size() const { return mySize; }
+    bool empty() const { return !mySize; }
+
+    const T& operator[](const size_t i) const { return myBegin[i]; }
+    const T& front() const { return *myBegin; }
+    const T& back() const { return myBegin[mySize - 1]; }
+
+    const T* begin() const { return myBegin; }
+    const T* end() const { return myBegin + mySize; }
+};
+
 //  Sample = simulated value
 //      of data on a given event date
+//  Stochastic data is filled by the model on every path
+//  Path-invariant data, like discounts and libors under deterministic rates,
+//      is read from a table held by the model: 
+//      the model points the sample to its table instead of copying it on every path
 template <class T>
 struct Sample
 {
+    //  Stochastic
     T           numeraire;
-    vector<T>   discounts;
-    vector<T>   libors;
 
     //  multi-asset: forwardMats[a][t] = forward for asset a, maturity t
     vector<vector<T>>   forwards;
 
+    //  Path-invariant
+    constView<T>    discounts;
+    constView<T>    libors;
+
+    Sample() {}
+    //  Views may refer to own defaults, see initialize()
+    Sample(const Sample&) = delete;
+    Sample& operator=(const Sample&) = delete;
+    Sample(Sample&&) = default;
+    Sample& operator=(Sample&&) = default;
+
     //  Allocate given SampleDef
     void allocate(const SampleDef& data)
     {
-        discounts.resize(data.discountMats.size());
-        libors.resize(data.liborDefs.size());
+        myDefaultDiscounts.resize(data.discountMats.size());
+        myDefaultLibors.resize(data.liborDefs.size());
 
         forwards.resize(data.forwardMats.size());
         for (size_t a = 0; a < forwards.size(); ++a) forwards[a].resize(data.forwardMats[a].size());
     }
 
     //  Initialize defaults
+    //  Models that don't set discounts and libors leave them at the defaults
     void initialize()
     {
         numeraire = T(1.0);
-        fill(discounts.begin(), discounts.end(), T(1.0));
-        fill(libors.begin(), libors.end(), T(0.0));
+        fill(myDefaultDiscounts.begin(), myDefaultDiscounts.end(), T(1.0));
+        fill(myDefaultLibors.begin(), myDefaultLibors.end(), T(0.0));
+        discounts = myDefaultDiscounts;
+        libors = myDefaultLibors;
 
 		for (auto& forward: forwards) fill(forward.begin(), forward.end(), T(100.0));
     }
+
+private:
+
+    vector<T>   myDefaultDiscounts;
+    vector<T>   myDefaultLibors;
 };
 
 template <class T>
@@ -146,6 +197,22 @@ public:
         vector<T>&                  payoffs)       
             const = 0;
 
+    //  Mixed pathwise / likelihood ratio Greeks, see mcSimulAAD()
+    //  Split payoffs into a continuous part, differentiated pathwise,
+    //      and a discontinuous part, differentiated by likelihood ratio
+    //  Products with digital or barrier features override 
+    //      and compute the discontinuous part without smoothing
+    //  Default: everything is continuous
+    virtual void splitPayoffs(
+        const Scenario<T>&          path,
+        vector<T>&                  continuous,
+        vector<T>&                  discontinuous)
+            const
+    {
+        payoffs(path, continuous);
+        fill(discontinuous.begin(), discontinuous.end(), T(0.0));
+    }
+
     virtual unique_ptr<Product<T>> clone() const = 0;
 
     virtual ~Product() {}
@@ -185,6 +252,55 @@ public:
         Scenario<T>&                path) 
             const = 0;
 
+    //  Likelihood ratio Greeks, implemented by Gaussian-driven models
+
+    //  Does the model expose the score of its transition density?
+    virtual bool supportsLR() const { return false; }
+
+    //  Generate a path consuming a vector[simDim()] of independent Gaussians
+    //      where the simulated state is detached from the parameters:
+    //      only deterministic factors (numeraires, discounts, forward factors...)
+    //      depend on parameters
+    //  Returns the log-likelihood of the simulated state, as a function of the parameters,
+    //      whose derivatives to parameters is the score of the transition density
+    virtual T generatePathLR(
+        const vector<double>&       gaussVec,
+        Scenario<T>&                path)
+            const
+    {
+        throw runtime_error("Model does not support likelihood ratio Greeks");
+    }
+
+    //  Hand-coded adjoints of the path generation, implemented by simple models
+
+    //  Does the model differentiate its paths by hand?
+    virtual bool supportsPathAdjoint() const { return false; }
+
+    //  Same path as generatePath(), except the simulated data is not recorded:
+    //      stochastic samples are new leaves on tape, with the values of generatePath(),
+    //      path-invariant samples refer to the pre-calculations of init(), as usual
+    //  Only the payoffs are recorded on tape
+    virtual void generatePathLeaves(
+        const vector<double>&       gaussVec,
+        Scenario<T>&                path)
+            const
+    {
+        throw runtime_error("Model does not support hand-coded path adjoints");
+    }
+
+    //  Once the payoffs are propagated to the leaves of a path from generatePathLeaves(),
+    //      back-propagate their adjoints onto the pre-calculations of init(), before the mark,
+    //      so that the propagation from the mark to the start produces the same risks
+    //      as generatePath()
+    //  All numAdjoints() adjoints, see AAD.h
+    virtual void generatePathAdjoint(
+        const vector<double>&       gaussVec,
+        const Scenario<T>&          path)
+            const
+    {
+        throw runtime_error("Model does not support hand-coded path adjoints");
+    }
+
     virtual unique_ptr<Model<T>> clone() const = 0;
 
     virtual ~Model() {}
@@ -207,18 +323,14 @@ public:
 
 private:
 
-    //  If T not Number : do nothing
+    //  If T = Number : put on tape, otherwise do nothing
     template<class U> 
     void putParametersOnTapeT()
     {
-
-    }
-
-    //  If T = Number : put on tape
-    template <>
-    void putParametersOnTapeT<Number>()
-    {
-        for (Number* param : parameters()) param->putOnTape();
+        if constexpr (is_same_v<U, Number>)
+        {
+            for (Number* param : parameters()) param->putOnTape();
+        }
     }
 };
 
@@ -243,6 +355,15 @@ public:
 
     //  Skip ahead
     virtual void skipTo(const unsigned b) = 0;
+
+    //  Independent substream identified by a key, see rngStreams.h
+    //  Returns a generator of the same type and seed, 
+    //      whose sequence starts at the beginning of the substream,
+    //      skipTo() positions within the substream
+    virtual unique_ptr<RNG> substream(const uint64_t key) const
+    {
+        throw runtime_error("Random number generator does not support substreams");
+    }
 };
 
 //  Template algorithms
@@ -259,6 +380,31 @@ inline bool checkCompatiblity(
     return prd.assetNames() == mdl.assetNames();
 }
 
+//  Consumer of the payoffs of the paths, optional in mcSimul() and mcParallelSimul()
+//  Payoffs are streamed into the sink instead of being returned
+//      as the nPath x nPay matrix, so memory is bounded by the sink,
+//      see QuantileSink and quantiles() in mcSinks.h and main.h
+
+class ResultSink
+{
+public:
+
+    //  Prepare for payoff vectors of dimension nPay
+    virtual void init(const size_t nPay) = 0;
+
+    //  Consume the payoffs of a path
+    virtual void consume(const size_t path, const vector<double>& payoffs) = 0;
+
+    //  Sink of the same type and settings, initialized and empty,
+    //      for the paths of another thread
+    virtual unique_ptr<ResultSink> cloneEmpty() const = 0;
+
+    //  Absorb a sink obtained from cloneEmpty()
+    virtual void merge(const ResultSink& rhs) = 0;
+
+    virtual ~ResultSink() {}
+};
+
 //  Serial valuation, chapter 6
 
 //	MC simulator: free function that conducts simulations 
@@ -268,7 +414,10 @@ inline vector<vector<double>> mcSimul(
     const Product<double>&      prd,
     const Model<double>&        mdl,
     const RNG&                  rng,			            
-    const size_t                nPath)                      
+    const size_t                nPath,
+    //  Sink of the payoffs, if any, 
+    //      then the returned matrix is empty
+    ResultSink*                 sink = nullptr)                      
 {
     if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
 
@@ -279,8 +428,11 @@ inline vector<vector<double>> mcSimul(
     auto cRng = rng.clone();
 
     //	Allocate results
+    //  Or a single vector of payoffs for the sink
     const size_t nPay = prd.payoffLabels().size();
-    vector<vector<double>> results(nPath, vector<double>(nPay));
+    vector<vector<double>> results(sink ? 0 : nPath, vector<double>(nPay));
+    vector<double> payoffs(sink ? nPay : 0);
+    if (sink) sink->init(nPay);
     //  Init the simulation timeline
     cMdl->allocate(prd.timeline(), prd.defline());
     cMdl->init(prd.timeline(), prd.defline());              
@@ -301,7 +453,12 @@ inline vector<vector<double>> mcSimul(
         //  Generate path, consume Gaussian vector
         cMdl->generatePath(gaussVec, path);     
         //	Compute result
-        prd.payoffs(path, results[i]);
+        if (!sink) prd.payoffs(path, results[i]);
+        else
+        {
+            prd.payoffs(path, payoffs);
+            sink->consume(i, payoffs);
+        }
     }
 
     return results;	//	C++11: move
@@ -310,29 +467,394 @@ inline vector<vector<double>> mcSimul(
 //  Parallel valuation, chapter 7
 
 #define BATCHSIZE 64
+
+//  Control of asynchronous jobs, see submitJob() in main.h
+//  The parallel simulations optionally take a JobControl, and then:
+//      spawn their batches with the priority of the job,
+//      skip the remaining batches once the job is cancelled,
+//          (cooperative cancellation, checked between batches)
+//      and report progress and payoff statistics after every batch,
+//          so the job can display partial estimates with error bars
+//  A job may run several simulations (bumpRisk() runs one per parameter),
+//      the statistics are those of the first one
+
+class JobControl
+{
+    const TaskPriority      myPriority;
+
+    atomic<bool>            myCancelled;
+    atomic<size_t>          myBatchesDone;
+    atomic<size_t>          myBatchesStarted;
+    atomic<size_t>          myBatchesExpected;
+    atomic<size_t>          mySimulations;
+
+    //  Sums and sums of squares of the payoffs of the first simulation
+    mutable mutex           myMutex;
+    size_t                  myPaths;
+    vector<double>          mySums;
+    vector<double>          mySumSqs;
+
+public:
+
+    JobControl(const TaskPriority priority = TaskPriority::interactive) :
+        myPriority(priority),
+        myCancelled(false),
+        myBatchesDone(0),
+        myBatchesStarted(0),
+        myBatchesExpected(0),
+        mySimulations(0),
+        myPaths(0)
+    {}
+
+    TaskPriority priority() const
+    {
+        return myPriority;
+    }
+
+    //  Cancellation
+
+    void cancel()
+    {
+        myCancelled = true;
+    }
+
+    bool cancelled() const
+    {
+        return myCancelled;
+    }
+
+    //  Called by simulations after the last batch
+    void throwIfCancelled() const
+    {
+        if (myCancelled) throw runtime_error("Job cancelled");
+    }
+
+    //  Progress
+
+    //  Number of batches of nPath paths
+    static size_t numBatches(const size_t nPath)
+    {
+        return (nPath + BATCHSIZE - 1) / BATCHSIZE;
+    }
+
+    //  Total number of batches, 
+    //      set upfront by calculations that run several simulations
+    void expectBatches(const size_t n)
+    {
+        myBatchesExpected = n;
+    }
+
+    //  Called by simulations when they start, 
+    //      returns the index of the simulation in the job
+    size_t startSimulation(const size_t nPath, const size_t nPay)
+    {
+        const size_t sim = mySimulations++;
+        if (!sim)
+        {
+            lock_guard<mutex> lk(myMutex);
+            mySums.assign(nPay, 0.0);
+            mySumSqs.assign(nPay, 0.0);
+        }
+        myBatchesStarted += numBatches(nPath);
+        return sim;
+    }
+
+    //  Called by simulations after every batch, 
+    //      with the payoffs of the paths in the batch
+    void batchDone(
+        const size_t                    sim,
+        const vector<vector<double>>&   payoffs,
+        const size_t                    firstPath,
+        const size_t                    numPaths)
+    {
+        if (!sim)
+        {
+            const size_t nPay = payoffs.empty() ? 0 : payoffs.front().size();
+            vector<double> sums(nPay, 0.0), sumSqs(nPay, 0.0);
+            for (size_t i = firstPath; i < firstPath + numPaths; ++i)
+            {
+                for (size_t j = 0; j < nPay; ++j)
+                {
+                    sums[j] += payoffs[i][j];
+                    sumSqs[j] += payoffs[i][j] * payoffs[i][j];
+                }
+            }
+
+            lock_guard<mutex> lk(myMutex);
+            myPaths += numPaths;
+            for (size_t j = 0; j < nPay; ++j)
+            {
+                mySums[j] += sums[j];
+                mySumSqs[j] += sumSqs[j];
+            }
+        }
+        ++myBatchesDone;
+    }
+
+    size_t batchesDone() const
+    {
+        return myBatchesDone;
+    }
+
+    size_t batchesTotal() const
+    {
+        return max<size_t>(myBatchesExpected, myBatchesStarted);
+    }
+
+    double progress() const
+    {
+        const size_t total = batchesTotal();
+        return total ? double(batchesDone()) / total : 0.0;
+    }
+
+    //  Partial estimates: 
+    //      means and standard errors of the payoffs over the paths completed so far
+    struct Estimates
+    {
+        size_t          numPaths;
+        vector<double>  values;
+        vector<double>  stdErrs;
+    };
+
+    Estimates estimates() const
+    {
+        lock_guard<mutex> lk(myMutex);
+
+        Estimates results;
+        results.numPaths = myPaths;
+        const size_t nPay = mySums.size();
+        results.values.resize(nPay, 0.0);
+        results.stdErrs.resize(nPay, 0.0);
+        if (!myPaths) return results;
+
+        for (size_t j = 0; j < nPay; ++j)
+        {
+            const double mean = mySums[j] / myPaths;
+            const double var = max(0.0, mySumSqs[j] / myPaths - mean * mean);
+            results.values[j] = mean;
+            results.stdErrs[j] = sqrt(var / myPaths);
+        }
+
+        return results;
+    }
+};
+
+//  Pipelined generation of Gaussian vectors for parallel simulations
+//  Dedicated generator threads fill ring buffers with the Gaussian vectors
+//      of batches of BATCHSIZE paths, ahead of the path workers,
+//      which consume them instead of skipping and generating themselves
+//  Batch b always holds the Gaussian vectors of paths b * BATCHSIZE and following,
+//      exactly those of skipTo(b * BATCHSIZE), so results are identical
+//      with or without the pipeline, whatever the timing of the threads
+//  With one generator, the sequence is generated in order without any skip,
+//      with n generators, generator g produces batches g, g + n, g + 2n...
+//      and skips between its batches
+
+//  Slots are handed over with a sequence number per slot, no locks:
+//      slot s of a ring holds the batches of rounds 0, 1, 2... of that slot,
+//      its turn is 2 * round when free for the batch of the round,
+//      and 2 * round + 1 when the batch is ready
+//  Workers wait (yielding) for their batch, which cannot deadlock
+//      because the pool executes batches in order:
+//      the generator only waits for batches already taken by a worker
+
+class GaussianPipeline
+{
+    const size_t        myDim;
+    const size_t        myNumPath;
+    const size_t        myNumBatches;
+    const size_t        myNumGenerators;
+    //  Slots per generator
+    const size_t        myRingSize;
+
+    struct Slot
+    {
+        //  Gaussian vectors of the paths in the batch
+        vector<vector<double>>  gaussVecs;
+        atomic<size_t>          turn;
+
+        Slot(const size_t dim) :
+            gaussVecs(BATCHSIZE, vector<double>(dim)),
+            turn(0)
+        {}
+    };
+
+    //  Rings of all generators, ring g in [g * ringSize, (g + 1) * ringSize)
+    vector<unique_ptr<Slot>>    mySlots;
+
+    atomic<bool>                myStop;
+    vector<thread>              myGenerators;
+
+    //  Slot and round of a batch
+    Slot& slot(const size_t batch) const
+    {
+        const size_t g = batch % myNumGenerators, l = batch / myNumGenerators;
+        return *mySlots[g * myRingSize + l % myRingSize];
+    }
+
+    size_t round(const size_t batch) const
+    {
+        return batch / myNumGenerators / myRingSize;
+    }
+
+    void generate(const size_t g, unique_ptr<RNG> rng)
+    {
+        rng->init(myDim);
+
+        for (size_t batch = g; batch < myNumBatches; batch += myNumGenerators)
+        {
+            Slot& s = slot(batch);
+            const size_t free = 2 * round(batch);
+            while (s.turn.load(memory_order_acquire) != free)
+            {
+                if (myStop) return;
+                this_thread::yield();
+            }
+
+            const size_t firstPath = batch * BATCHSIZE;
+            const size_t paths = min<size_t>(BATCHSIZE, myNumPath - firstPath);
+            if (myNumGenerators > 1) rng->skipTo(unsigned(firstPath));
+            for (size_t i = 0; i < paths; ++i) rng->nextG(s.gaussVecs[i]);
+
+            s.turn.store(free + 1, memory_order_release);
+        }
+    }
+
+public:
+
+    //  ringSize: batches generated ahead by each generator
+    GaussianPipeline(
+        const RNG&          rng,
+        const size_t        simDim,
+        const size_t        nPath,
+        const size_t        numGenerators,
+        const size_t        ringSize) :
+        myDim(simDim),
+        myNumPath(nPath),
+        myNumBatches((nPath + BATCHSIZE - 1) / BATCHSIZE),
+        myNumGenerators(max<size_t>(1, numGenerators)),
+        myRingSize(max<size_t>(1, ringSize)),
+        myStop(false)
+    {
+        mySlots.reserve(myNumGenerators * myRingSize);
+        for (size_t i = 0; i < myNumGenerators * myRingSize; ++i)
+        {
+            mySlots.push_back(make_unique<Slot>(simDim));
+        }
+
+        for (size_t g = 0; g < myNumGenerators; ++g)
+        {
+            myGenerators.emplace_back(&GaussianPipeline::generate, this, g, rng.clone());
+        }
+    }
+
+    //  Stops the generators, after all batches are released
+    //      or when workers quit early, like on cancellation
+    ~GaussianPipeline()
+    {
+        myStop = true;
+        for (auto& t : myGenerators) t.join();
+    }
+
+    //  Gaussian vectors of the paths of a batch, waits until generated
+    //  nullptr if the pipeline was aborted meanwhile
+    const vector<vector<double>>* acquire(const size_t batch) const
+    {
+        const Slot& s = slot(batch);
+        const size_t ready = 2 * round(batch) + 1;
+        while (s.turn.load(memory_order_acquire) != ready)
+        {
+            if (myStop) return nullptr;
+            this_thread::yield();
+        }
+        return &s.gaussVecs;
+    }
+
+    //  Hand the slot of a batch back to its generator
+    void release(const size_t batch)
+    {
+        slot(batch).turn.store(2 * round(batch) + 2, memory_order_release);
+    }
+
+    //  Stop the generators and the workers waiting for batches,
+    //      when a worker fails
+    void abort()
+    {
+        myStop = true;
+    }
+
+    //  RAII: the batch of a worker, 
+    //      released on destruction, whether the worker completes or quits early,
+    //      or the pipeline is aborted if the worker throws
+    class Batch
+    {
+        GaussianPipeline*               myPipeline;
+        const size_t                    myBatch;
+        const int                       myExceptions;
+        const vector<vector<double>>*   myGaussVecs;
+
+    public:
+
+        Batch(GaussianPipeline& pipeline, const size_t batch) :
+            myPipeline(&pipeline),
+            myBatch(batch),
+            myExceptions(uncaught_exceptions()),
+            myGaussVecs(pipeline.acquire(batch))
+        {}
+
+        ~Batch()
+        {
+            if (uncaught_exceptions() > myExceptions) myPipeline->abort();
+            else if (myGaussVecs) myPipeline->release(myBatch);
+        }
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        //  nullptr if aborted
+        const vector<vector<double>>* gaussVecs() const
+        {
+            return myGaussVecs;
+        }
+    };
+};
+
 //	Parallel equivalent of mcSimul()
 inline vector<vector<double>> mcParallelSimul(
     const Product<double>&      prd,
     const Model<double>&        mdl,
     const RNG&                  rng,
-    const size_t                nPath)
+    const size_t                nPath,
+    //  Asynchronous job, if any
+    JobControl*                 job = nullptr,
+    //  Threads dedicated to the generation of Gaussians, 
+    //      0: workers generate their own, see GaussianPipeline above
+    const size_t                generators = 0,
+    //  Cap on the threads working on the simulation, 0: the whole pool
+    const size_t                maxThreads = 0,
+    //  Sink of the payoffs, if any, see mcSimul()
+    ResultSink*                 sink = nullptr)
 {
     if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
 
     auto cMdl = mdl.clone();
 
     const size_t nPay = prd.payoffLabels().size();
-    vector<vector<double>> results(nPath, vector<double>(nPay));
+    vector<vector<double>> results(sink ? 0 : nPath, vector<double>(nPay));
 
     cMdl->allocate(prd.timeline(), prd.defline());
     cMdl->init(prd.timeline(), prd.defline());
 
     //  Allocate space for Gaussian vectors and paths, 
-    //      one for each thread
+    //      one for each task that may run at the same time
+    //  The tasks lease a slot of workspace, 
+    //      the pool may be resized during the simulation
     ThreadPool *pool = ThreadPool::getInstance();
-    const size_t nThread = pool->numThreads();
-    vector<vector<double>> gaussVecs(nThread+1);    //  +1 for main
-    vector<Scenario<double>> paths(nThread+1);
+    const size_t nSlots = pool->concurrency(maxThreads);
+    WorkspaceSlots slots(nSlots);
+    auto group = make_shared<TaskGroup>(nSlots);
+    vector<vector<double>> gaussVecs(nSlots);
+    vector<Scenario<double>> paths(nSlots);
     for (auto& vec : gaussVecs) vec.resize(cMdl->simDim());
     for (auto& path : paths)
     {
@@ -340,18 +862,46 @@ inline vector<vector<double>> mcParallelSimul(
         initializePath(path);
     }
     
-    //  One RNG per thread
-    vector<unique_ptr<RNG>> rngs(nThread + 1);
+    //  One RNG per slot
+    vector<unique_ptr<RNG>> rngs(nSlots);
     for (auto& random : rngs)
     {
         random = rng.clone();
         random->init(cMdl->simDim());
     }
 
+    //  With a sink, one empty sink per slot, merged into sink at the end,
+    //      and the payoffs of the batch of each slot
+    //  Which paths a slot consumes depends on scheduling,
+    //      so approximate sinks like sketches may differ from the serial version
+    //      within their accuracy
+    vector<unique_ptr<ResultSink>> sinks;
+    vector<vector<vector<double>>> batchPayoffs;
+    if (sink)
+    {
+        sink->init(nPay);
+        sinks.resize(nSlots);
+        for (auto& s : sinks) s = sink->cloneEmpty();
+        batchPayoffs.assign(nSlots, vector<vector<double>>(BATCHSIZE, vector<double>(nPay)));
+    }
+
+    //  Or Gaussians from generator threads, 
+    //      two batches ahead per slot
+    unique_ptr<GaussianPipeline> pipeline;
+    if (generators)
+    {
+        pipeline = make_unique<GaussianPipeline>(rng, cMdl->simDim(), nPath, 
+            generators, 2 * nSlots);
+    }
+
     //  Reserve memory for futures
     vector<TaskHandle> futures;
     futures.reserve(nPath / BATCHSIZE + 1); 
 
+    //  Register with the job
+    const size_t sim = job ? job->startSimulation(nPath, nPay) : 0;
+    const TaskPriority priority = job ? job->priority() : TaskPriority::foreground;
+
     //  Start
     //  Same as mcSimul() except we send tasks to the pool 
     //  instead of executing them
@@ -364,37 +914,76 @@ inline vector<vector<double>> mcParallelSimul(
 
         futures.push_back( pool->spawnTask ( [&, firstPath, pathsInTask]()
         {
+            const size_t batch = firstPath / BATCHSIZE;
+
+            //  Cancelled job: skip
+            //  Still hand the batch back so the generators can proceed
+            if (job && job->cancelled())
+            {
+                if (pipeline)
+                {
+                    GaussianPipeline::Batch skipped(*pipeline, batch);
+                }
+                return false;
+            }
+
             //  Inside the parallel task, 
             //      pick the right pre-allocated vectors
-            const size_t threadNum = pool->threadNum();
-            vector<double>& gaussVec = gaussVecs[threadNum];
-            Scenario<double>& path = paths[threadNum];
+            const auto slot = slots.lease();
+            vector<double>& gaussVec = gaussVecs[slot];
+            Scenario<double>& path = paths[slot];
+
+            //  Get a RNG and position it correctly,
+            //      or the pre-generated Gaussians of the batch
+            //  The batch is handed back on exit, even on exceptions
+            auto& random = rngs[slot];
+            unique_ptr<GaussianPipeline::Batch> pipelineBatch;
+            const vector<vector<double>>* pipelined = nullptr;
+            if (pipeline)
+            {
+                pipelineBatch = make_unique<GaussianPipeline::Batch>(*pipeline, batch);
+                pipelined = pipelineBatch->gaussVecs();
+                //  Aborted by another worker
+                if (!pipelined) return false;
+            }
+            else random->skipTo(firstPath);
 
-            //  Get a RNG and position it correctly
-            auto& random = rngs[threadNum];
-            random->skipTo(firstPath);
+            //  Payoffs of the batch, in results or in the workspace of the slot
+            vector<vector<double>>& payoffs = sink ? batchPayoffs[slot] : results;
+            const size_t firstPayoff = sink ? 0 : firstPath;
 
             //  And conduct the simulations, exactly same as sequential
             for (size_t i = 0; i < pathsInTask; i++)
             {
                 //  Next Gaussian vector, dimension D
-                random->nextG(gaussVec);
+                if (!pipelined) random->nextG(gaussVec);
                 //  Path
-                cMdl->generatePath(gaussVec, path);       
+                cMdl->generatePath(pipelined ? (*pipelined)[i] : gaussVec, path);       
                 //  Payoff
-                prd.payoffs(path, results[firstPath + i]);
+                prd.payoffs(path, payoffs[firstPayoff + i]);
+                if (sink) sinks[slot]->consume(firstPath + i, payoffs[firstPayoff + i]);
             }
 
+            pipelineBatch.reset();
+
+            //  Report to the job
+            if (job) job->batchDone(sim, payoffs, firstPayoff, pathsInTask);
+
             //  Remember tasks must return bool
             return true;
-        }));
+        }, priority, group));
 
         pathsLeft -= pathsInTask;
         firstPath += pathsInTask;
     }
 
     //  Wait and help
-    for (auto& future : futures) pool->activeWait(future);
+    for (auto& future : futures) pool->activeWait(future, priority);
+    //  Rethrow the exception of a failed task, if any
+    for (auto& future : futures) future.get();
+    if (job) job->throwIfCancelled();
+
+    if (sink) for (const auto& s : sinks) sink->merge(*s);
 
     return results;	//	C++11: move
 }
@@ -419,11 +1008,205 @@ struct AADSimulResults
     //  vector(0..nParam - 1) of risk sensitivities
     //  of aggregated payoff, averaged over paths
     vector<double>          risks;
+
+    //  vector(0..nParam - 1) of standard errors of the risks, 
+    //      by batch means, see AADRiskBatches below
+    //  Empty unless requested
+    vector<double>          riskErrors;
+};
+
+//  Batch means of AAD risks, for their standard errors
+//  The paths are split into consecutive groups, and the adjoints
+//      that the paths of each group accumulate on the nodes before the mark
+//      are taken separately, instead of summed
+//  At the end, each group is propagated from the mark to the parameters,
+//      one sweep of the initialization per group, and no extra sweep per path
+//  The risks are the same as without groups, up to the order of the sums
+class AADRiskBatches
+{
+    const SharedRegion&         myRegion;
+
+    //  Per group, adjoints indexed like the region, and number of paths
+    vector<vector<double>>      myAdjoints;
+    vector<size_t>              myPaths;
+    vector<mutex>               myLocks;
+
+public:
+
+    //  region: nodes before the mark, on the tape where they are recorded
+    AADRiskBatches(const SharedRegion& region, const size_t groups) :
+        myRegion(region),
+        myAdjoints(groups, vector<double>(region.size(), 0.0)),
+        myPaths(groups, 0),
+        myLocks(groups)
+    {}
+
+    //  Group of batch i out of n
+    size_t group(const size_t i, const size_t n) const
+    {
+        return i * myAdjoints.size() / n;
+    }
+
+    //  Take the adjoints accumulated by paths of group g:
+    //      from the nodes of the region, or from the private adjoints 
+    //      of a tape that shares the region, see Tape::share()
+    //  Thread safe
+    void take(const size_t g, const size_t paths, Tape* sharingTape = nullptr)
+    {
+        lock_guard<mutex> lk(myLocks[g]);
+        if (sharingTape) sharingTape->takeShared(myAdjoints[g]);
+        else myRegion.takeAdjoints(myAdjoints[g]);
+        myPaths[g] += paths;
+    }
+
+    //  Once all the adjoints are taken, on the tape of the region:
+    //      risks to params averaged over nPath paths, and their standard errors
+    void risks(
+        const vector<Number*>&  params,
+        const size_t            nPath,
+        vector<double>&         risks,
+        vector<double>&         errors) const
+    {
+        const size_t nGroup = myAdjoints.size(), nParam = params.size();
+
+        //  Sums of the risks over the paths of every group
+        vector<vector<double>> sums(nGroup, vector<double>(nParam));
+        for (size_t g = 0; g < nGroup; ++g)
+        {
+            myRegion.setAdjoints(myAdjoints[g]);
+            Number::propagateMarkToStart();
+            for (size_t j = 0; j < nParam; ++j) sums[g][j] = params[j]->adjoint();
+        }
+
+        //  Mean and variance of the mean from the group means, 
+        //      weighted by their numbers of paths
+        risks.assign(nParam, 0.0);
+        errors.assign(nParam, 0.0);
+        for (size_t j = 0; j < nParam; ++j)
+        {
+            for (size_t g = 0; g < nGroup; ++g) risks[j] += sums[g][j];
+            risks[j] /= nPath;
+
+            double var = 0.0;
+            for (size_t g = 0; g < nGroup; ++g)
+            {
+                const double dev = sums[g][j] - myPaths[g] * risks[j];
+                var += dev * dev;
+            }
+            errors[j] = nGroup > 1 ? sqrt(var * nGroup / (nGroup - 1)) / nPath : 0.0;
+        }
+    }
 };
 
 //  Default aggregator = 1st payoff = payoff[0]
 const auto defaultAggregator = [](const vector<Number>& v) {return v[0]; };
 
+//  Estimators for risk sensitivities
+enum class GreekEstimator
+{
+    //  Standard pathwise AAD, chapter 12
+    Pathwise,
+    //  Likelihood ratio: 
+    //      d/dparam E[payoff] = E[d payoff / d param | state] + E[payoff * score]
+    //      unbiased for discontinuous payoffs, no smoothing required,
+    //      applied to the payoffs without smoothing, see Product::splitPayoffs()
+    LikelihoodRatio,
+    //  Pathwise on the continuous part of the payoffs,
+    //      likelihood ratio on the discontinuous part, see Product::splitPayoffs()
+    //  Note: the aggregator must be linear in the payoffs
+    Mixed,
+    //  Pathwise, with the path generation differentiated by the model's hand-coded adjoints,
+    //      see Model::generatePathAdjoint(): same risks, only the payoffs are on tape
+    PathwiseAdjoint
+};
+
+//  Throw if the model doesn't implement the estimator
+inline void checkEstimator(
+    const Model<Number>&    mdl,
+    const GreekEstimator    estimator)
+{
+    if ((estimator == GreekEstimator::LikelihoodRatio || estimator == GreekEstimator::Mixed)
+        && !mdl.supportsLR())
+        throw runtime_error("Model does not support likelihood ratio Greeks");
+    if (estimator == GreekEstimator::PathwiseAdjoint && !mdl.supportsPathAdjoint())
+        throw runtime_error("Model does not support hand-coded path adjoints");
+}
+
+//  Generate one path and compute the aggregated payoff on tape 
+//      so that its propagation produces the requested estimator
+//  Payoffs are returned in payoffs, other arguments are workspace
+template<class F>
+inline Number simulPathAAD(
+    const Product<Number>&  prd,
+    const Model<Number>&    mdl,
+    const vector<double>&   gaussVec,
+    const F&                aggFun,
+    const GreekEstimator    estimator,
+    Scenario<Number>&       path,
+    vector<Number>&         payoffs,
+    Scenario<Number>&       lrPath,
+    vector<Number>&         lrPayoffs,
+    vector<Number>&         partPayoffs)
+{
+    switch (estimator)
+    {
+    case GreekEstimator::LikelihoodRatio:
+    {
+        //  Path with state detached, and log-likelihood on tape
+        Number logLik = mdl.generatePathLR(gaussVec, path);
+        //  Payoffs without smoothing, as in the mixed estimator
+        prd.splitPayoffs(path, payoffs, partPayoffs);
+        for (size_t j = 0; j < payoffs.size(); ++j) payoffs[j] += partPayoffs[j];
+        Number result = aggFun(payoffs);
+
+        //  Value unchanged, derivatives += payoff * score
+        return result + double(result) * (logLik - double(logLik));
+    }
+
+    case GreekEstimator::Mixed:
+    {
+        //  Continuous part, pathwise
+        mdl.generatePath(gaussVec, path);
+        prd.splitPayoffs(path, payoffs, partPayoffs);
+        Number result = aggFun(payoffs);
+
+        //  Discontinuous part, likelihood ratio
+        Number logLik = mdl.generatePathLR(gaussVec, lrPath);
+        prd.splitPayoffs(lrPath, partPayoffs, lrPayoffs);
+        Number lrResult = aggFun(lrPayoffs);
+
+        //  Full payoffs for the results
+        for (size_t j = 0; j < payoffs.size(); ++j) payoffs[j] += lrPayoffs[j];
+
+        return result + lrResult + double(lrResult) * (logLik - double(logLik));
+    }
+
+    case GreekEstimator::PathwiseAdjoint:
+        //  Path off tape, see adjointPathAAD()
+        mdl.generatePathLeaves(gaussVec, path);
+        prd.payoffs(path, payoffs);
+        return aggFun(payoffs);
+
+    case GreekEstimator::Pathwise:
+    default:
+        mdl.generatePath(gaussVec, path);
+        prd.payoffs(path, payoffs);
+        return aggFun(payoffs);
+    }
+}
+
+//  Complete the propagation of a path from simulPathAAD(), 
+//      after its result is propagated to the mark
+inline void adjointPathAAD(
+    const Model<Number>&    mdl,
+    const vector<double>&   gaussVec,
+    const GreekEstimator    estimator,
+    const Scenario<Number>& path)
+{
+    //  Hand-coded adjoints of the path generation
+    if (estimator == GreekEstimator::PathwiseAdjoint) mdl.generatePathAdjoint(gaussVec, path);
+}
+
 template<class F = decltype(defaultAggregator)>
 inline AADSimulResults
 mcSimulAAD(
@@ -431,9 +1214,14 @@ mcSimulAAD(
     const Model<Number>&    mdl,
     const RNG& rng,
     const size_t            nPath,
-    const F&                aggFun = defaultAggregator)
+    const F&                aggFun = defaultAggregator,
+    const GreekEstimator    estimator = GreekEstimator::Pathwise,
+    //  Groups of paths for the standard errors of the risks, see AADRiskBatches,
+    //      0 or 1: no errors
+    const size_t            errorBatches = 0)
 {
     if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
+    checkEstimator(mdl, estimator);
 
     //  Work with copies of the model and RNG
     //      which are modified when we set up the simulation
@@ -445,6 +1233,9 @@ mcSimulAAD(
 	Scenario<Number> path;
     allocatePath(prd.defline(), path);
 	cMdl->allocate(prd.timeline(), prd.defline());
+    //  Second path for the discontinuous part in the mixed estimator
+    Scenario<Number> lrPath;
+    allocatePath(prd.defline(), lrPath);
 
     //  Dimensions
     const size_t nPay = prd.payoffLabels().size();
@@ -466,6 +1257,7 @@ mcSimulAAD(
     cMdl->init(prd.timeline(), prd.defline());
     //  Initialize path
     initializePath(path);
+    initializePath(lrPath);
     //  Mark the tape straight after initialization
     tape.mark();
     //
@@ -474,13 +1266,26 @@ mcSimulAAD(
     cRng->init(cMdl->simDim());                         
                                                             
     //  Allocate workspace
-    vector<Number> nPayoffs(nPay);
+    vector<Number> nPayoffs(nPay), lrPayoffs(nPay), partPayoffs(nPay);
     //  Gaussian vector
     vector<double> gaussVec(cMdl->simDim());            
 
     //  Results
     AADSimulResults results(nPath, nPay, nParam);
 
+    //  Batch means, groups of consecutive batches of paths, 
+    //      like mcParallelSimulAAD(), so antithetic pairs stay together
+    const size_t nBatch = (nPath + BATCHSIZE - 1) / BATCHSIZE;
+    unique_ptr<SharedRegion> region;
+    unique_ptr<AADRiskBatches> batches;
+    const size_t nGroup = min(errorBatches, nBatch);
+    if (nGroup > 1)
+    {
+        region = make_unique<SharedRegion>(tape.begin(), tape.markIt());
+        batches = make_unique<AADRiskBatches>(*region, nGroup);
+    }
+    size_t groupStart = 0;
+
     //	Iterate through paths	
     for (size_t i = 0; i<nPath; i++)
     {
@@ -492,16 +1297,15 @@ mcSimulAAD(
 
         //  Next Gaussian vector, dimension D
         cRng->nextG(gaussVec);
-        //  Generate path, consume Gaussian vector
-        cMdl->generatePath(gaussVec, path);     
-        //	Compute result
-        prd.payoffs(path, nPayoffs);
-        //  Aggregate
-        Number result = aggFun(nPayoffs);
+        //  Generate path, compute payoffs and aggregate 
+        //      according to the estimator
+        Number result = simulPathAAD(prd, *cMdl, gaussVec, aggFun, estimator, 
+            path, nPayoffs, lrPath, lrPayoffs, partPayoffs);
 
         //  AAD - 3
         //  Propagate adjoints
         result.propagateToMark();
+        adjointPathAAD(*cMdl, gaussVec, estimator, path);
         //  Store results for the path
         results.aggregated[i] = double(result);
         convertCollection(
@@ -509,21 +1313,40 @@ mcSimulAAD(
             nPayoffs.end(), 
             results.payoffs[i].begin());
 		//
+
+        //  End of a group
+        if (batches)
+        {
+            const size_t g = batches->group(i / BATCHSIZE, nBatch);
+            if (i + 1 == nPath || batches->group((i + 1) / BATCHSIZE, nBatch) != g)
+            {
+                batches->take(g, i + 1 - groupStart);
+                groupStart = i + 1;
+            }
+        }
     }
 
     //  AAD - 4
     //  Mark = limit between pre-calculations and path-wise operations
     //  Operations above mark have been propagated and accumulated
-    //  We conduct one propagation mark to start
-    Number::propagateMarkToStart();
-    //
+    if (batches)
+    {
+        //  One propagation mark to start per group
+        batches->risks(params, nPath, results.risks, results.riskErrors);
+    }
+    else
+    {
+        //  We conduct one propagation mark to start
+        Number::propagateMarkToStart();
+        //
 
-    //  Pick sensitivities, summed over paths, and normalize
-    transform(
-        params.begin(),
-        params.end(),
-        results.risks.begin(),
-        [nPath](const Number* p) {return p->adjoint() / nPath; });
+        //  Pick sensitivities, summed over paths, and normalize
+        transform(
+            params.begin(),
+            params.end(),
+            results.risks.begin(),
+            [nPath](const Number* p) {return p->adjoint() / nPath; });
+    }
 
     //  Clear the tape
     tape.clear();
@@ -540,7 +1363,9 @@ inline void initModel4ParallelAAD(
     //  Cloned model, must have been allocated prior
     Model<Number>&              clonedMdl,
     //  Path, also allocated prior
-    Scenario<Number>&           path)
+    Scenario<Number>&           path,
+    //  Second path for mixed Greeks, optional
+    Scenario<Number>*           lrPath = nullptr)
 {
     //  Access to tape
     Tape& tape = *Number::tape;
@@ -555,11 +1380,73 @@ inline void initModel4ParallelAAD(
     clonedMdl.init(prd.timeline(), prd.defline());
     //  Path
     initializePath(path);
+    if (lrPath) initializePath(*lrPath);
     //  Mark the tape straight after parameters
     tape.mark();
     //
 }
 
+//  Initialization shared by all the slots
+//  The model and the paths of all the slots are initialized once,
+//      on the caller's tape, before the mark
+//  The tapes of the other slots read that region instead of recording it again,
+//      and accumulate its adjoints privately, see Tape::share()
+//  After the simulation, call mergeShared() on the other tapes,
+//      then propagate the caller's tape from the mark to the start, once
+//  The region must outlive the simulation
+inline unique_ptr<SharedRegion> initSharedModel4ParallelAAD(
+    //  Inputs
+    const Product<Number>&      prd,
+    //  Cloned model, must have been allocated prior
+    Model<Number>&              clonedMdl,
+    //  Paths of all the slots, also allocated prior
+    vector<Scenario<Number>>&   paths,
+    //  Second paths for mixed Greeks, optional
+    vector<Scenario<Number>>*   lrPaths,
+    //  Tapes of the slots other than the caller's
+    vector<Tape>&               tapes)
+{
+    initModel4ParallelAAD(prd, clonedMdl, paths[0], lrPaths ? &(*lrPaths)[0] : nullptr);
+
+    //  Paths of the other slots, moving the mark after them
+    Tape& tape = *Number::tape;
+    for (size_t i = 1; i < paths.size(); ++i)
+    {
+        initializePath(paths[i]);
+        if (lrPaths) initializePath((*lrPaths)[i]);
+    }
+    tape.mark();
+
+    auto region = make_unique<SharedRegion>(tape.begin(), tape.markIt());
+    for (auto& slotTape : tapes) slotTape.share(*region);
+
+    return region;
+}
+
+//  Point the tape of the executing thread to the tape of a workspace slot 
+//      for the duration of a task, restored on destruction
+//  Tasks run on whichever thread is free, including the caller, 
+//      so the tape follows the slot, not the thread
+class TapeSwitch
+{
+    Tape* const myPrevious;
+
+public:
+
+    TapeSwitch(Tape* tape) : myPrevious(Number::tape)
+    {
+        Number::tape = tape;
+    }
+
+    ~TapeSwitch()
+    {
+        Number::tape = myPrevious;
+    }
+
+    TapeSwitch(const TapeSwitch&) = delete;
+    TapeSwitch& operator=(const TapeSwitch&) = delete;
+};
+
 //  Parallel version of mcSimulAAD()
 template<class F = decltype(defaultAggregator)>
 inline AADSimulResults
@@ -568,9 +1455,18 @@ mcParallelSimulAAD(
     const Model<Number>&    mdl,
     const RNG& rng,
     const size_t            nPath,
-    const F&                aggFun = defaultAggregator)
+    const F&                aggFun = defaultAggregator,
+    const GreekEstimator    estimator = GreekEstimator::Pathwise,
+    //  Asynchronous job, if any
+    JobControl*             job = nullptr,
+    //  Cap on the threads working on the simulation, 0: the whole pool
+    const size_t            maxThreads = 0,
+    //  Groups of batches for the standard errors of the risks, see AADRiskBatches,
+    //      0 or 1: no errors
+    const size_t            errorBatches = 0)
 {
     if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
+    checkEstimator(mdl, estimator);
 
     const size_t nPay = prd.payoffLabels().size();
     const size_t nParam = mdl.numParams();
@@ -581,67 +1477,79 @@ mcParallelSimulAAD(
     //  Clear and initialise tape
 	Number::tape->clear();
 	auto resetter = setNumResultsForAAD();
+
+    //  Float emulation of this calculation, carried into the tasks, see AAD.h
+    const bool emulateFloatDers = Tape::emulateFloatDers;
 	
-    //  We need one of all these for each thread
-    //  0: main thread
-    //  1 to n : worker threads
+    //  We need one of all these for each task that may run at the same time
+    //  Tasks lease a slot, whichever thread executes them
+    //  0: the caller's tape
+    //  1 to n : tapes of the calculation
 
     ThreadPool *pool = ThreadPool::getInstance();
-    const size_t nThread = pool->numThreads();
+    const size_t nSlots = pool->concurrency(maxThreads);
+    WorkspaceSlots slots(nSlots);
+    auto group = make_shared<TaskGroup>(nSlots);
 
     //  Allocate workspace
 
-    //  One model clone per thread
-    vector<unique_ptr<Model<Number>>> models(nThread + 1);
-    for (auto& model : models)
-    {
-        model = mdl.clone();
-        model->allocate(prd.timeline(), prd.defline());
-    }
+    //  One model clone, initialized once and shared by all slots
+    auto cMdl = mdl.clone();
+    cMdl->allocate(prd.timeline(), prd.defline());
 
-    //  One scenario per thread
-    vector<Scenario<Number>> paths(nThread + 1);
+    //  One scenario per slot
+    //  And another one for the discontinuous part in the mixed estimator
+    vector<Scenario<Number>> paths(nSlots), lrPaths(nSlots);
     for (auto& path : paths)
     {
         allocatePath(prd.defline(), path);
     }
+    for (auto& path : lrPaths)
+    {
+        allocatePath(prd.defline(), path);
+    }
 
-    //  One vector of payoffs per thread
-    vector<vector<Number>> payoffs(nThread + 1, vector<Number>(nPay));
+    //  One vector of payoffs per slot
+    vector<vector<Number>> payoffs(nSlots, vector<Number>(nPay));
+    vector<vector<Number>> lrPayoffs(nSlots, vector<Number>(nPay));
+    vector<vector<Number>> partPayoffs(nSlots, vector<Number>(nPay));
 
     //  ~workspace
 
-    //  Tapes for the worker threads
-    //  The main thread has one of its own
-    vector<Tape> tapes(nThread);
-
-    //  Model initialized?
-    //  Note we don't use vector<bool>
-    //      because vector<bool> is not thread safe
-    vector<int> mdlInit(nThread + 1, false);
-
-    //  Initialize main thread
-    initModel4ParallelAAD(prd, *models[0], paths[0]);
+    //  Tapes for the slots 1 to n
+    //  Slot 0 records on the caller's tape
+    Tape* mainTape = Number::tape;
+    vector<Tape> tapes(nSlots - 1);
 
-    //  Mark main thread as initialized
-    mdlInit[0] = true;
+    //  Initialize the model and the paths on the caller's tape, 
+    //      the other tapes read the initialization
+    const auto region = initSharedModel4ParallelAAD(prd, *cMdl, paths, &lrPaths, tapes);
 
-    //  Init the RNGs, one pet thread
-    //  One RNG per thread
-    vector<unique_ptr<RNG>> rngs(nThread + 1);
+    //  Init the RNGs, one per slot
+    vector<unique_ptr<RNG>> rngs(nSlots);
     for (auto& random : rngs)
     {
         random = rng.clone();
-        random->init(models[0]->simDim());
+        random->init(cMdl->simDim());
     }
 
-    //  One Gaussian vector per thread
+    //  One Gaussian vector per slot
     vector<vector<double>> gaussVecs
-        (nThread + 1, vector<double>(models[0]->simDim()));
+        (nSlots, vector<double>(cMdl->simDim()));
 
     //  Reserve memory for futures
+    const size_t nBatch = (nPath + BATCHSIZE - 1) / BATCHSIZE;
     vector<TaskHandle> futures;
-    futures.reserve(nPath / BATCHSIZE + 1);
+    futures.reserve(nBatch);
+
+    //  Batch means, groups of consecutive batches
+    unique_ptr<AADRiskBatches> batches;
+    const size_t nGroup = min(errorBatches, nBatch);
+    if (nGroup > 1) batches = make_unique<AADRiskBatches>(*region, nGroup);
+
+    //  Register with the job
+    const size_t sim = job ? job->startSimulation(nPath, nPay) : 0;
+    const TaskPriority priority = job ? job->priority() : TaskPriority::foreground;
 
     //  Start
     //  Same as mcSimul() except we send tasks to the pool 
@@ -655,94 +1563,99 @@ mcParallelSimulAAD(
 
         futures.push_back(pool->spawnTask([&, firstPath, pathsInTask]()
         {
-            const size_t threadNum = pool->threadNum();
+            //  Cancelled job: skip
+            if (job && job->cancelled()) return false;
 
-            //  Use this thread's tape
-            //  Thread local magic: each thread its own pointer
-            //  Note main thread = 0 is not reset
-            if (threadNum > 0) Number::tape = &tapes[threadNum - 1];
+            const auto lease = slots.lease();
+            const size_t slot = lease;
 
-            //  Initialize once on each thread
-            if (!mdlInit[threadNum])
-            {
-                //  Initialize
-                initModel4ParallelAAD(prd, *models[threadNum], paths[threadNum]);
-
-                //  Mark as initialized
-                mdlInit[threadNum] = true;
-            }
+            //  Use this slot's tape
+            //  Thread local magic: each thread its own pointer
+            TapeSwitch tapeSwitch(slot ? &tapes[slot - 1] : mainTape);
+            //  One-dimensional context on this thread, see AAD.h
+            auto taskResetter = setNumResultsForAAD();
+            floatDersEmulation emulation(emulateFloatDers);
 
             //  Get a RNG and position it correctly
-            auto& random = rngs[threadNum];
+            auto& random = rngs[slot];
             random->skipTo(firstPath);
 
             //  And conduct the simulations, exactly same as sequential
             for (size_t i = 0; i < pathsInTask; i++)
             {
                 //  Rewind tape to mark
-                //  Notice : this is the tape for the executing thread
+                //  Notice : this is the tape of the slot
 
                 Number::tape->rewindToMark();
                 //  Next Gaussian vector, dimension D
-                random->nextG(gaussVecs[threadNum]);
-                //  Path
-                models[threadNum]->generatePath(
-                    gaussVecs[threadNum], 
-                    paths[threadNum]);
-                //  Payoff
-                prd.payoffs(paths[threadNum], payoffs[threadNum]);
+                random->nextG(gaussVecs[slot]);
+                //  Path, payoffs and aggregate
+                Number result = simulPathAAD(
+                    prd, 
+                    *cMdl, 
+                    gaussVecs[slot], 
+                    aggFun, 
+                    estimator,
+                    paths[slot], 
+                    payoffs[slot],
+                    lrPaths[slot],
+                    lrPayoffs[slot],
+                    partPayoffs[slot]);
 
                 //  Propagate adjoints
-                Number result = aggFun(payoffs[threadNum]);
                 result.propagateToMark();
+                adjointPathAAD(*cMdl, gaussVecs[slot], estimator, paths[slot]);
                 //  Store results for the path
                 results.aggregated[firstPath + i] = double(result);
                 convertCollection(
-                    payoffs[threadNum].begin(), 
-                    payoffs[threadNum].end(),
+                    payoffs[slot].begin(), 
+                    payoffs[slot].end(),
                     results.payoffs[firstPath + i].begin());
             }
 
+            //  Take the adjoints of the batch for the batch means
+            if (batches)
+            {
+                batches->take(batches->group(firstPath / BATCHSIZE, nBatch), pathsInTask,
+                    slot ? &tapes[slot - 1] : nullptr);
+            }
+
+            //  Report to the job
+            if (job) job->batchDone(sim, results.payoffs, firstPath, pathsInTask);
+
             //  Remember tasks must return bool
             return true;
-        }));
+        }, priority, group));
 
         pathsLeft -= pathsInTask;
         firstPath += pathsInTask;
     }
 
     //  Wait and help
-    for (auto& future : futures) pool->activeWait(future);
+    for (auto& future : futures) pool->activeWait(future, priority);
+    if (job) job->throwIfCancelled();
     
     //  Mark = limit between pre-calculations and path-wise operations
     //  Operations above mark have been propagated and accumulated
-    //  We conduct one propagation mark to start
-    //  On the main thread's tape
-    Number::propagateMarkToStart();
-    //  And on the worker thread's tapes
-    Tape* mainThreadPtr = Number::tape;
-    for (size_t i = 0; i < nThread; ++i)
-    {
-        if (mdlInit[i + 1])
-        {
-            //  Set tape pointer
-            Number::tape = &tapes[i];
-            //  On that tape, propagate
-            Number::propagateMarkToStart();
-        }
+    if (batches)
+    {
+        //  All the adjoints were taken by the groups, 
+        //      one propagation mark to start per group
+        batches->risks(cMdl->parameters(), nPath, results.risks, results.riskErrors);
     }
-    //  Reset tape to main thread's
-    Number::tape = mainThreadPtr;
-
-    //  Sum sensitivities over threads
-    for (size_t j = 0; j < nParam; ++j)
+    else
     {
-        results.risks[j] = 0.0;
-        for (size_t i = 0; i < models.size(); ++i)
+        //  The other slots accumulated into their private adjoints, 
+        //      which we add to the caller's tape
+        for (const auto& tape : tapes) tape.mergeShared();
+        //  And we conduct one propagation mark to start
+        Number::propagateMarkToStart();
+
+        //  Sensitivities
+        for (size_t j = 0; j < nParam; ++j)
         {
-            if (mdlInit[i]) results.risks[j] += models[i]->parameters()[j]->adjoint();
+            results.risks[j] = cMdl->parameters()[j]->adjoint() / nPath;
         }
-        results.risks[j] /= nPath;
     }
 
 	//  Clear the main thread's tape
@@ -757,9 +1670,10 @@ mcParallelSimulAAD(
 
 struct AADMultiSimulResults
 {
-	AADMultiSimulResults(const size_t nPath, const size_t nPay, const size_t nParam) :
+	AADMultiSimulResults(const size_t nPath, const size_t nPay, const size_t nParam, const bool sparse = false) :
 		payoffs(nPath, vector<double>(nPay)),
-		risks(nParam, nPay)
+		risks(sparse ? 0 : nParam, sparse ? 0 : nPay),
+		sparseRisks(nPay)
 	{}
 
 	//  matrix(0..nPath - 1, 0..nPay - 1) of payoffs, same as mcSimul()
@@ -768,6 +1682,10 @@ struct AADMultiSimulResults
 	//  matrix(0..nParam - 1, 0..nPay - 1) of risk sensitivities
 	//		of all payoffs, averaged over paths
 	matrix<double>          risks;
+
+	//	Same in CSR form, only the non-zero sensitivities, 
+	//		filled instead of risks when sparse output is requested
+	csrMatrix<double>		sparseRisks;
 };
 
 //  Serial
@@ -777,7 +1695,9 @@ mcSimulAADMulti(
 	const Product<Number>&  prd,
 	const Model<Number>&    mdl,
 	const RNG&              rng,
-	const size_t            nPath)
+	const size_t            nPath,
+	//	Risks in CSR form?
+	const bool				sparse = false)
 {
     if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
 
@@ -811,7 +1731,7 @@ mcSimulAADMulti(
 
     //  Allocate multi-dimensional results
     //      including a matrix(0..nParam - 1, 0..nPay - 1) of risk sensitivities
-	AADMultiSimulResults results(nPath, nPay, nParam);
+	AADMultiSimulResults results(nPath, nPay, nParam, sparse);
 
 	for (size_t i = 0; i<nPath; i++)
 	{
@@ -840,12 +1760,15 @@ mcSimulAADMulti(
 	Number::propagateAdjointsMulti(tape.markIt(), tape.begin());
 
     //  Pack results 
+	vector<double> row(nPay);
 	for (size_t i = 0; i < nParam; ++i)
 	{
 		for (size_t j = 0; j < nPay; ++j)
 		{
-			results.risks[i][j] = params[i]->adjoint(j) / nPath;
+			row[j] = params[i]->adjoint(j) / nPath;
 		}
+		if (sparse) results.sparseRisks.addRow(row.begin());
+		else copy(row.begin(), row.end(), results.risks[i]);
 	}
 
 	tape.clear();
@@ -860,7 +1783,12 @@ mcParallelSimulAADMulti(
 	const Product<Number>&  prd,
 	const Model<Number>&    mdl,
 	const RNG& rng,
-	const size_t            nPath)
+	const size_t            nPath,
+	const bool				sparse = false,
+	//  Asynchronous job, if any
+	JobControl*				job = nullptr,
+	//  Cap on the threads working on the simulation, 0: the whole pool
+	const size_t			maxThreads = 0)
 {
     if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
 
@@ -870,47 +1798,49 @@ mcParallelSimulAADMulti(
 	Number::tape->clear();
 	auto resetter = setNumResultsForAAD(true, nPay);
 
+    //  Float emulation of this calculation, carried into the tasks, see AAD.h
+    const bool emulateFloatDers = Tape::emulateFloatDers;
+
 	ThreadPool *pool = ThreadPool::getInstance();
-	const size_t nThread = pool->numThreads();
+	const size_t nSlots = pool->concurrency(maxThreads);
+	WorkspaceSlots slots(nSlots);
+	auto group = make_shared<TaskGroup>(nSlots);
 
-	vector<unique_ptr<Model<Number>>> models(nThread + 1);
-	for (auto& model : models)
-	{
-		model = mdl.clone();
-		model->allocate(prd.timeline(), prd.defline());
-	}
+	auto cMdl = mdl.clone();
+	cMdl->allocate(prd.timeline(), prd.defline());
 
-	vector<Scenario<Number>> paths(nThread + 1);
+	vector<Scenario<Number>> paths(nSlots);
 	for (auto& path : paths)
 	{
 		allocatePath(prd.defline(), path);
 	}
 
-	vector<vector<Number>> payoffs(nThread + 1, vector<Number>(nPay));
-
-	vector<Tape> tapes(nThread);
+	vector<vector<Number>> payoffs(nSlots, vector<Number>(nPay));
 
-	vector<int> mdlInit(nThread + 1, false);
+	Tape* mainTape = Number::tape;
+	vector<Tape> tapes(nSlots - 1);
 
-	initModel4ParallelAAD(prd, *models[0], paths[0]);
+	//  Once, shared by the other tapes, after the number of adjoints is set
+	const auto region = initSharedModel4ParallelAAD(prd, *cMdl, paths, nullptr, tapes);
 
-	mdlInit[0] = true;
-
-	vector<unique_ptr<RNG>> rngs(nThread + 1);
+	vector<unique_ptr<RNG>> rngs(nSlots);
 	for (auto& random : rngs)
 	{
 		random = rng.clone();
-		random->init(models[0]->simDim());
+		random->init(cMdl->simDim());
 	}
 
 	vector<vector<double>> gaussVecs
-	(nThread + 1, vector<double>(models[0]->simDim()));
+	(nSlots, vector<double>(cMdl->simDim()));
 
-	AADMultiSimulResults results(nPath, nPay, nParam);
+	AADMultiSimulResults results(nPath, nPay, nParam, sparse);
 
 	vector<TaskHandle> futures;
 	futures.reserve(nPath / BATCHSIZE + 1);
 
+	const size_t sim = job ? job->startSimulation(nPath, nPay) : 0;
+	const TaskPriority priority = job ? job->priority() : TaskPriority::foreground;
+
 	size_t firstPath = 0;
 	size_t pathsLeft = nPath;
 	while (pathsLeft > 0)
@@ -919,68 +1849,67 @@ mcParallelSimulAADMulti(
 
 		futures.push_back(pool->spawnTask([&, firstPath, pathsInTask]()
 		{
-			const size_t threadNum = pool->threadNum();
+			if (job && job->cancelled()) return false;
 
-			if (threadNum > 0) Number::tape = &tapes[threadNum - 1];
+			const auto lease = slots.lease();
+			const size_t slot = lease;
 
-			if (!mdlInit[threadNum])
-			{
-				initModel4ParallelAAD(prd, *models[threadNum], paths[threadNum]);
-				mdlInit[threadNum] = true;
-			}
+			TapeSwitch tapeSwitch(slot ? &tapes[slot - 1] : mainTape);
+
+			//  Multi-dimensional context on this thread, see AAD.h
+			auto taskResetter = setNumResultsForAAD(true, nPay);
+			floatDersEmulation emulation(emulateFloatDers);
 
-			auto& random = rngs[threadNum];
+			auto& random = rngs[slot];
 			random->skipTo(firstPath);
 
 			for (size_t i = 0; i < pathsInTask; i++)
 			{
 
 				Number::tape->rewindToMark();
-				random->nextG(gaussVecs[threadNum]);
-				models[threadNum]->generatePath(
-					gaussVecs[threadNum],
-					paths[threadNum]);
-				prd.payoffs(paths[threadNum], payoffs[threadNum]);
+				random->nextG(gaussVecs[slot]);
+				cMdl->generatePath(
+					gaussVecs[slot],
+					paths[slot]);
+				prd.payoffs(paths[slot], payoffs[slot]);
 
-				const size_t n = payoffs[threadNum].size();
+				const size_t n = payoffs[slot].size();
 				for (size_t j = 0; j < n; ++j)
 				{
-					payoffs[threadNum][j].adjoint(j) = 1.0;
+					payoffs[slot][j].adjoint(j) = 1.0;
 				}
 				Number::propagateAdjointsMulti(prev(Number::tape->end()), Number::tape->markIt());
 
 				convertCollection(
-					payoffs[threadNum].begin(),
-					payoffs[threadNum].end(),
+					payoffs[slot].begin(),
+					payoffs[slot].end(),
 					results.payoffs[firstPath + i].begin());
 			}
 
+			if (job) job->batchDone(sim, results.payoffs, firstPath, pathsInTask);
+
 			return true;
-		}));
+		}, priority, group));
 
 		pathsLeft -= pathsInTask;
 		firstPath += pathsInTask;
 	}
 
-	for (auto& future : futures) pool->activeWait(future);
+	for (auto& future : futures) pool->activeWait(future, priority);
+	if (job) job->throwIfCancelled();
 
+	for (const auto& tape : tapes) tape.mergeShared();
 	Number::propagateAdjointsMulti(Number::tape->markIt(), Number::tape->begin());
-	for (size_t i = 0; i < nThread; ++i)
-	{
-		if (mdlInit[i + 1])
-		{
-			Number::propagateAdjointsMulti(tapes[i].markIt(), tapes[i].begin());
-		}
-	}
 
-	for (size_t j = 0; j < nParam; ++j) for (size_t k = 0; k < nPay; ++k)
+	vector<double> row(nPay);
+	for (size_t j = 0; j < nParam; ++j)
 	{
-		results.risks[j][k] = 0.0;
-		for (size_t i = 0; i < models.size(); ++i)
+		for (size_t k = 0; k < nPay; ++k)
 		{
-			if (mdlInit[i]) results.risks[j][k] += models[i]->parameters()[j]->adjoint(k);
+			row[k] = cMdl->parameters()[j]->adjoint(k) / nPath;
 		}
-		results.risks[j][k] /= nPath;
+		if (sparse) results.sparseRisks.addRow(row.begin());
+		else copy(row.begin(), row.end(), results.risks[j]);
 	}
 
 	Number::tape->clear();
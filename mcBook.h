@@ -0,0 +1,436 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Parallel simulation of a book of trades, each with its own model and product
+//  The batches of paths of all the trades are sent to the thread pool together,
+//      so small trades don't leave threads idle and large ones don't serialize the tail
+//  Trades are submitted longest first, by the cost of a few pilot paths, see mcCost.h,
+//      the batches of a trade consecutively, so the threads mostly
+//      stay on the same trade and reuse its workspace
+//  The sums over the batches of a trade are reduced in batch order
+//      by the last batch to complete, so results don't depend on the scheduling
+//      or the number of threads
+//  Every trade consumes the same random numbers, as in separate simulations,
+//      or, given the keys of the trades, its own substream of the generator, see rngStreams.h,
+//      so its results don't depend on the rest of the book
+
+#include "mcBase.h"
+#include "mcCost.h"
+#include <limits>
+
+struct BookSimulResults
+{
+    //  Per trade, the values of its payoffs
+    vector<vector<double>>  values;
+
+    //  AAD only
+    //  Per trade, the value of its aggregate
+    vector<double>          aggregated;
+    //  Per trade, the risk of its aggregate to the parameters of its model
+    vector<vector<double>>  risks;
+};
+
+//  Order of submission: longest expected first, ties in book order
+inline vector<size_t> bookOrder(const vector<double>& costs)
+{
+    vector<size_t> order(costs.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(),
+        [&costs](const size_t a, const size_t b) { return costs[a] > costs[b]; });
+    return order;
+}
+
+//  Sums over the batches of a trade
+struct BookTradeSums
+{
+    //  Per batch
+    vector<vector<double>>  batches;
+    //  Batches left to complete
+    atomic<size_t>          left{ 0 };
+
+    void init(const size_t nBatch)
+    {
+        batches.resize(nBatch);
+        left = nBatch;
+    }
+
+    //  Called by every batch when its sums are written
+    //  The last one reduces in batch order, divides by nPath and frees the sums
+    bool reduce(const size_t nPath, vector<double>& result)
+    {
+        if (--left) return false;
+
+        result.assign(batches.front().size(), 0.0);
+        for (const auto& batch : batches)
+        {
+            for (size_t j = 0; j < result.size(); ++j) result[j] += batch[j];
+        }
+        for (auto& x : result) x /= nPath;
+
+        vector<vector<double>>().swap(batches);
+        return true;
+    }
+};
+
+//  Batches of the book: trade, first path and number of paths
+struct BookBatch
+{
+    size_t  trade;
+    size_t  batch;
+    size_t  firstPath;
+    size_t  paths;
+};
+
+inline vector<BookBatch> bookBatches(const vector<size_t>& order, const size_t nPath)
+{
+    vector<BookBatch> batches;
+    batches.reserve(order.size() * (nPath / BATCHSIZE + 1));
+    for (const size_t trade : order)
+    {
+        for (size_t firstPath = 0; firstPath < nPath; firstPath += BATCHSIZE)
+        {
+            batches.push_back({ trade, firstPath / BATCHSIZE, firstPath,
+                min<size_t>(nPath - firstPath, BATCHSIZE) });
+        }
+    }
+    return batches;
+}
+
+template <class T>
+inline void checkBook(
+    const vector<const Product<T>*>&    prds,
+    const vector<const Model<T>*>&      mdls,
+    const size_t                        nPath)
+{
+    if (prds.size() != mdls.size()) throw runtime_error("Book : different numbers of models and products");
+    if (!nPath) throw runtime_error("Book : no paths");
+    for (size_t i = 0; i < prds.size(); ++i)
+    {
+        if (!prds[i] || !mdls[i]) throw runtime_error("Book : missing model or product");
+        if (!checkCompatiblity(*prds[i], *mdls[i])) throw runtime_error("Model and product are not compatible");
+    }
+}
+
+//  Generators of the trades, their substreams given keys, otherwise all the same
+inline vector<unique_ptr<RNG>> bookRngs(
+    const RNG&                          rng,
+    const size_t                        nTrade,
+    const vector<uint64_t>&             streams)
+{
+    if (!streams.empty() && streams.size() != nTrade)
+    {
+        throw runtime_error("Book : different numbers of streams and trades");
+    }
+    vector<unique_ptr<RNG>> rngs(nTrade);
+    for (size_t i = 0; i < nTrade; ++i)
+    {
+        rngs[i] = streams.empty() ? rng.clone() : rng.substream(streams[i]);
+    }
+    return rngs;
+}
+
+//  Values
+
+inline BookSimulResults mcParallelBook(
+    const vector<const Product<double>*>&   prds,
+    const vector<const Model<double>*>&     mdls,
+    const RNG&                              rng,
+    const size_t                            nPath,
+    //  Pilot paths per trade to order the trades, 0: book order
+    const size_t                            nPilot = 4,
+    //  Cap on the threads working on the book, 0: the whole pool
+    const size_t                            maxThreads = 0,
+    //  Keys of the substreams of the trades, see rngStreams.h, empty: same numbers for all
+    const vector<uint64_t>&                 streams = {})
+{
+    checkBook(prds, mdls, nPath);
+    const size_t nTrade = prds.size();
+    const vector<unique_ptr<RNG>> rngs = bookRngs(rng, nTrade, streams);
+
+    //  Longest first
+    vector<double> costs(nTrade, 0.0);
+    if (nPilot)
+    {
+        for (size_t i = 0; i < nTrade; ++i)
+        {
+            const CostEstimate est = mcPilot(*prds[i], *mdls[i], *rngs[i], nPilot);
+            costs[i] = est.setupSeconds + nPath * est.secondsPerPath;
+        }
+    }
+    const vector<BookBatch> batches = bookBatches(bookOrder(costs), nPath);
+
+    //  Model clones, keyed by trade,
+    //      initialized by the first batch of the trade and released by the last
+    //  Paths are generated concurrently with the same model, like mcParallelSimul()
+    vector<unique_ptr<Model<double>>> models(nTrade);
+    vector<once_flag> modelInit(nTrade);
+
+    vector<BookTradeSums> sums(nTrade);
+    for (auto& s : sums) s.init((nPath + BATCHSIZE - 1) / BATCHSIZE);
+
+    //  Workspace of the slots, keyed by the trade of their last batch
+    struct Workspace
+    {
+        size_t                  trade = numeric_limits<size_t>::max();
+        unique_ptr<RNG>         random;
+        vector<double>          gaussVec;
+        Scenario<double>        path;
+        vector<double>          payoffs;
+    };
+
+    ThreadPool *pool = ThreadPool::getInstance();
+    const size_t nSlots = pool->concurrency(maxThreads);
+    WorkspaceSlots slots(nSlots);
+    auto group = make_shared<TaskGroup>(nSlots);
+    vector<Workspace> workspaces(nSlots);
+
+    BookSimulResults results;
+    results.values.resize(nTrade);
+
+    vector<TaskHandle> futures;
+    futures.reserve(batches.size());
+
+    for (const BookBatch& b : batches)
+    {
+        futures.push_back(pool->spawnTask([&, b]()
+        {
+            const Product<double>& prd = *prds[b.trade];
+
+            call_once(modelInit[b.trade], [&]()
+            {
+                auto mdl = mdls[b.trade]->clone();
+                mdl->allocate(prd.timeline(), prd.defline());
+                mdl->init(prd.timeline(), prd.defline());
+                models[b.trade] = move(mdl);
+            });
+            const Model<double>& mdl = *models[b.trade];
+
+            const auto slot = slots.lease();
+            Workspace& ws = workspaces[slot];
+
+            //  New trade for this slot
+            if (ws.trade != b.trade)
+            {
+                ws.random = rngs[b.trade]->clone();
+                ws.random->init(mdl.simDim());
+                ws.gaussVec.resize(mdl.simDim());
+                allocatePath(prd.defline(), ws.path);
+                initializePath(ws.path);
+                ws.payoffs.resize(prd.payoffLabels().size());
+                ws.trade = b.trade;
+            }
+
+            ws.random->skipTo(b.firstPath);
+
+            vector<double>& batchSums = sums[b.trade].batches[b.batch];
+            batchSums.assign(ws.payoffs.size(), 0.0);
+
+            for (size_t i = 0; i < b.paths; i++)
+            {
+                ws.random->nextG(ws.gaussVec);
+                mdl.generatePath(ws.gaussVec, ws.path);
+                prd.payoffs(ws.path, ws.payoffs);
+                for (size_t j = 0; j < ws.payoffs.size(); ++j) batchSums[j] += ws.payoffs[j];
+            }
+
+            //  Last batch of the trade
+            if (sums[b.trade].reduce(nPath, results.values[b.trade])) models[b.trade].reset();
+
+            return true;
+        }, TaskPriority::foreground, group));
+    }
+
+    for (auto& future : futures) pool->activeWait(future);
+
+    return results;
+}
+
+//  AAD risk of an aggregate of the payoffs of every trade
+//  weights[trade]: weights of the payoffs in the aggregate, empty = first payoff
+
+inline BookSimulResults mcParallelBookAAD(
+    const vector<const Product<Number>*>&   prds,
+    const vector<const Model<Number>*>&     mdls,
+    const vector<vector<double>>&           weights,
+    const RNG&                              rng,
+    const size_t                            nPath,
+    const GreekEstimator                    estimator = GreekEstimator::Pathwise,
+    //  Pilot paths per trade to order the trades, 0: book order
+    const size_t                            nPilot = 4,
+    //  Cap on the threads working on the book, 0: the whole pool
+    const size_t                            maxThreads = 0,
+    //  Keys of the substreams of the trades, see rngStreams.h, empty: same numbers for all
+    const vector<uint64_t>&                 streams = {})
+{
+    checkBook(prds, mdls, nPath);
+    const size_t nTrade = prds.size();
+    const vector<unique_ptr<RNG>> rngs = bookRngs(rng, nTrade, streams);
+    if (!weights.empty() && weights.size() != nTrade)
+    {
+        throw runtime_error("Book : different numbers of weights and trades");
+    }
+    for (size_t i = 0; i < nTrade; ++i)
+    {
+        checkEstimator(*mdls[i], estimator);
+        if (!weights.empty() && !weights[i].empty() && weights[i].size() != prds[i]->payoffLabels().size())
+            throw runtime_error("Book : weights and payoffs of different sizes");
+    }
+
+    //  Longest first, the pilots use the tape of this thread
+    vector<double> costs(nTrade, 0.0);
+    if (nPilot)
+    {
+        for (size_t i = 0; i < nTrade; ++i)
+        {
+            const CostEstimate est = mcPilotAAD(*prds[i], *mdls[i], *rngs[i], nPilot, false,
+                defaultAggregator, estimator);
+            costs[i] = est.setupSeconds + nPath * est.secondsPerPath;
+        }
+    }
+    const vector<BookBatch> batches = bookBatches(bookOrder(costs), nPath);
+
+    Number::tape->clear();
+    auto resetter = setNumResultsForAAD();
+
+    //  Float emulation of this calculation, carried into the tasks, see AAD.h
+    const bool emulateFloatDers = Tape::emulateFloatDers;
+
+    //  Per batch: the sums of the payoffs, of the aggregate and of its risks
+    vector<BookTradeSums> sums(nTrade);
+    for (auto& s : sums) s.init((nPath + BATCHSIZE - 1) / BATCHSIZE);
+
+    //  Workspace of the slots, keyed by the trade of their last batch
+    //  The model clone is on the tape of the slot, initialized for that trade
+    struct Workspace
+    {
+        size_t                  trade = numeric_limits<size_t>::max();
+        unique_ptr<Model<Number>>   model;
+        unique_ptr<RNG>         random;
+        vector<double>          gaussVec;
+        Scenario<Number>        path, lrPath;
+        vector<Number>          payoffs, lrPayoffs, partPayoffs;
+    };
+
+    ThreadPool *pool = ThreadPool::getInstance();
+    const size_t nSlots = pool->concurrency(maxThreads);
+    WorkspaceSlots slots(nSlots);
+    auto group = make_shared<TaskGroup>(nSlots);
+    vector<Workspace> workspaces(nSlots);
+
+    //  Slot 0 records on the caller's tape
+    Tape* mainTape = Number::tape;
+    vector<Tape> tapes(nSlots - 1);
+
+    BookSimulResults results;
+    results.values.resize(nTrade);
+    results.aggregated.resize(nTrade);
+    results.risks.resize(nTrade);
+    vector<vector<double>> reduced(nTrade);
+
+    vector<TaskHandle> futures;
+    futures.reserve(batches.size());
+
+    for (const BookBatch& b : batches)
+    {
+        futures.push_back(pool->spawnTask([&, b]()
+        {
+            const Product<Number>& prd = *prds[b.trade];
+            const size_t nPay = prd.payoffLabels().size();
+
+            const auto lease = slots.lease();
+            const size_t slot = lease;
+            Workspace& ws = workspaces[slot];
+
+            TapeSwitch tapeSwitch(slot ? &tapes[slot - 1] : mainTape);
+            //  One-dimensional context on this thread, see AAD.h
+            auto taskResetter = setNumResultsForAAD();
+            floatDersEmulation emulation(emulateFloatDers);
+
+            //  New trade for this slot: clone and initialize on its tape
+            if (ws.trade != b.trade)
+            {
+                ws.model = mdls[b.trade]->clone();
+                ws.model->allocate(prd.timeline(), prd.defline());
+                allocatePath(prd.defline(), ws.path);
+                allocatePath(prd.defline(), ws.lrPath);
+                initModel4ParallelAAD(prd, *ws.model, ws.path, &ws.lrPath);
+                ws.random = rngs[b.trade]->clone();
+                ws.random->init(ws.model->simDim());
+                ws.gaussVec.resize(ws.model->simDim());
+                ws.payoffs.resize(nPay);
+                ws.lrPayoffs.resize(nPay);
+                ws.partPayoffs.resize(nPay);
+                ws.trade = b.trade;
+            }
+
+            const vector<double>* w = weights.empty() || weights[b.trade].empty()
+                ? nullptr : &weights[b.trade];
+            auto aggregator = [w](const vector<Number>& payoffs) -> Number
+            {
+                if (!w) return payoffs[0];
+                return dot(payoffs.begin(), payoffs.end(), w->begin());
+            };
+
+            ws.random->skipTo(b.firstPath);
+
+            const size_t nParam = ws.model->numParams();
+            vector<double>& batchSums = sums[b.trade].batches[b.batch];
+            batchSums.assign(nPay + 1 + nParam, 0.0);
+
+            for (size_t i = 0; i < b.paths; i++)
+            {
+                Number::tape->rewindToMark();
+                ws.random->nextG(ws.gaussVec);
+                Number result = simulPathAAD(prd, *ws.model, ws.gaussVec, aggregator, estimator,
+                    ws.path, ws.payoffs, ws.lrPath, ws.lrPayoffs, ws.partPayoffs);
+                result.propagateToMark();
+                adjointPathAAD(*ws.model, ws.gaussVec, estimator, ws.path);
+
+                for (size_t j = 0; j < nPay; ++j) batchSums[j] += double(ws.payoffs[j]);
+                batchSums[nPay] += double(result);
+            }
+
+            //  Risks of the batch, then clear the adjoints for the next batch
+            Number::propagateMarkToStart();
+            for (size_t j = 0; j < nParam; ++j)
+            {
+                batchSums[nPay + 1 + j] = ws.model->parameters()[j]->adjoint();
+            }
+            Number::tape->resetAdjoints();
+
+            //  Last batch of the trade
+            if (sums[b.trade].reduce(nPath, reduced[b.trade]))
+            {
+                const vector<double>& r = reduced[b.trade];
+                results.values[b.trade].assign(r.begin(), r.begin() + nPay);
+                results.aggregated[b.trade] = r[nPay];
+                results.risks[b.trade].assign(r.begin() + nPay + 1, r.end());
+            }
+
+            return true;
+        }, TaskPriority::foreground, group));
+    }
+
+    for (auto& future : futures) pool->activeWait(future);
+
+    //  Clear the main thread's tape
+    //  The other tapes are cleared on the destruction of the vector of tapes
+    Number::tape->clear();
+
+    return results;
+}
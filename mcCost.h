@@ -0,0 +1,319 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Pre-flight estimates of the wall time and peak memory of simulations
+//  A few pilot paths are simulated serially, exactly like the simulation,
+//      to measure the dimension, the size of the tape before the mark and per path,
+//      and the time per path, which are then extrapolated
+//      to the number of paths and threads of the simulation
+//  Assumes linear scaling across threads, up to the number of cores,
+//      and does not count the memory of the model clones
+//  packJobs() co-schedules jobs from their estimates within a memory budget
+
+#include "mcBase.h"
+#include <chrono>
+#include <thread>
+
+enum class CostedCalculation
+{
+    //  mcSimul() and mcParallelSimul()
+    Value,
+    //  AAD risk of one aggregate, mcSimulAAD() and mcParallelSimulAAD()
+    AADRisk,
+    //  AAD risk of all payoffs, mcSimulAADMulti() and mcParallelSimulAADMulti()
+    AADRiskMulti
+};
+
+struct CostEstimate
+{
+    //  Measured on the pilot
+
+    size_t  simDim = 0;
+    //  Nodes recorded before the mark: parameters and initialization
+    size_t  preMarkNodes = 0;
+    size_t  preMarkArgs = 0;
+    //  Nodes and their arguments recorded on every path
+    size_t  nodesPerPath = 0;
+    size_t  argsPerPath = 0;
+    //  Adjoints per node, 0 without AAD
+    size_t  adjointWidth = 0;
+    //  Time to set up the simulation, and per path
+    double  setupSeconds = 0.0;
+    double  secondsPerPath = 0.0;
+
+    //  Extrapolated
+
+    //  Threads simulating, each with its own tape (workspace slot),
+    //      and how many run at the same time on the hardware
+    size_t  threads = 1;
+    size_t  concurrency = 1;
+    double  wallSeconds = 0.0;
+    //  RAM of the tapes, every thread has its own,
+    //      and they share the region before the mark in parallel
+    size_t  tapeBytes = 0;
+    //  Results held until the end of the simulation
+    size_t  resultBytes = 0;
+    size_t  peakBytes = 0;
+};
+
+namespace Cost
+{
+    using clock = chrono::steady_clock;
+
+    inline double seconds(const clock::time_point start)
+    {
+        return chrono::duration<double>(clock::now() - start).count();
+    }
+
+    //  RAM of a blocklist of n items of size bytes, in blocks of blockSize,
+    //      capped by the out-of-core window, see blocklist.h
+    inline size_t blocklistBytes(const size_t n, const size_t size, const size_t blockSize)
+    {
+        const size_t blocks = max<size_t>(1, (n + blockSize - 1) / blockSize);
+        size_t bytes = blocks * blockSize * size;
+        const size_t window = outOfCore().window;
+        if (window) bytes = min(bytes, window + blockSize * size);
+        return bytes;
+    }
+
+    //  RAM of a tape of nodes with args arguments
+    inline size_t tapeBytes(const size_t nodes, const size_t args, const size_t adjointWidth)
+    {
+        return blocklistBytes(nodes, sizeof(Node), BLOCKSIZE)
+            + blocklistBytes(args, sizeof(Derivative), DATASIZE)
+            + blocklistBytes(args, sizeof(double*), DATASIZE)
+            + (adjointWidth > 1
+                ? blocklistBytes(nodes * adjointWidth, sizeof(double), ADJSIZE)
+                : 0);
+    }
+
+    //  RAM of the tape of one thread
+    inline size_t tapeBytes(const CostEstimate& est)
+    {
+        return tapeBytes(est.preMarkNodes + est.nodesPerPath, 
+            est.preMarkArgs + est.argsPerPath, est.adjointWidth);
+    }
+
+    //  RAM of the tapes of threads threads, of which the first records 
+    //      the region before the mark and the others read it,
+    //      with private adjoints, see Tape::share()
+    inline size_t sharedTapeBytes(const CostEstimate& est, const size_t threads)
+    {
+        return tapeBytes(est) + (threads - 1) *
+            (tapeBytes(est.nodesPerPath, est.argsPerPath, est.adjointWidth)
+                + est.preMarkNodes * est.adjointWidth * sizeof(double));
+    }
+
+    //  Rows of payoffs, with the overhead of their vectors
+    inline size_t resultBytes(const size_t nPath, const size_t nPay)
+    {
+        return nPath * (nPay * sizeof(double) + sizeof(vector<double>) + 16);
+    }
+}
+
+//  Pilot of mcSimul()
+inline CostEstimate mcPilot(
+    const Product<double>&      prd,
+    const Model<double>&        mdl,
+    const RNG&                  rng,
+    const size_t                nPilot)
+{
+    CostEstimate est;
+
+    auto start = Cost::clock::now();
+
+    auto cMdl = mdl.clone();
+    auto cRng = rng.clone();
+    const size_t nPay = prd.payoffLabels().size();
+    vector<double> payoffs(nPay);
+    cMdl->allocate(prd.timeline(), prd.defline());
+    cMdl->init(prd.timeline(), prd.defline());
+    cRng->init(cMdl->simDim());
+    vector<double> gaussVec(cMdl->simDim());
+    Scenario<double> path;
+    allocatePath(prd.defline(), path);
+    initializePath(path);
+
+    est.setupSeconds = Cost::seconds(start);
+    est.simDim = cMdl->simDim();
+
+    start = Cost::clock::now();
+    for (size_t i = 0; i < nPilot; ++i)
+    {
+        cRng->nextG(gaussVec);
+        cMdl->generatePath(gaussVec, path);
+        prd.payoffs(path, payoffs);
+    }
+    est.secondsPerPath = Cost::seconds(start) / nPilot;
+
+    return est;
+}
+
+//  Pilot of mcSimulAAD() or mcSimulAADMulti()
+//  Uses and clears the tape of the calling thread
+template<class F = decltype(defaultAggregator)>
+inline CostEstimate mcPilotAAD(
+    const Product<Number>&      prd,
+    const Model<Number>&        mdl,
+    const RNG&                  rng,
+    const size_t                nPilot,
+    const bool                  multi,
+    const F&                    aggFun = defaultAggregator,
+    const GreekEstimator        estimator = GreekEstimator::Pathwise)
+{
+    checkEstimator(mdl, estimator);
+
+    CostEstimate est;
+
+    auto start = Cost::clock::now();
+
+    auto cMdl = mdl.clone();
+    auto cRng = rng.clone();
+    const size_t nPay = prd.payoffLabels().size();
+    Scenario<Number> path, lrPath;
+    allocatePath(prd.defline(), path);
+    allocatePath(prd.defline(), lrPath);
+    cMdl->allocate(prd.timeline(), prd.defline());
+
+    Tape& tape = *Number::tape;
+    tape.clear();
+    auto resetter = setNumResultsForAAD(multi, multi ? nPay : 1);
+
+    cMdl->putParametersOnTape();
+    cMdl->init(prd.timeline(), prd.defline());
+    initializePath(path);
+    initializePath(lrPath);
+    tape.mark();
+
+    cRng->init(cMdl->simDim());
+    vector<Number> nPayoffs(nPay), lrPayoffs(nPay), partPayoffs(nPay);
+    vector<double> gaussVec(cMdl->simDim());
+
+    est.setupSeconds = Cost::seconds(start);
+    est.simDim = cMdl->simDim();
+    est.adjointWidth = multi ? nPay : 1;
+    tie(est.preMarkNodes, est.preMarkArgs) = tape.footprint(tape.begin(), tape.markIt());
+
+    start = Cost::clock::now();
+    for (size_t i = 0; i < nPilot; ++i)
+    {
+        tape.rewindToMark();
+        cRng->nextG(gaussVec);
+
+        if (multi)
+        {
+            cMdl->generatePath(gaussVec, path);
+            prd.payoffs(path, nPayoffs);
+            for (size_t j = 0; j < nPay; ++j) nPayoffs[j].adjoint(j) = 1.0;
+            Number::propagateAdjointsMulti(prev(tape.end()), tape.markIt());
+        }
+        else
+        {
+            Number result = simulPathAAD(prd, *cMdl, gaussVec, aggFun, estimator,
+                path, nPayoffs, lrPath, lrPayoffs, partPayoffs);
+            result.propagateToMark();
+            adjointPathAAD(*cMdl, gaussVec, estimator, path);
+        }
+    }
+    est.secondsPerPath = Cost::seconds(start) / nPilot;
+
+    //  Size of the last path
+    tie(est.nodesPerPath, est.argsPerPath) = tape.footprint(tape.markIt(), tape.end());
+
+    tape.clear();
+
+    return est;
+}
+
+//  Extrapolate a pilot to a simulation of nPath paths,
+//      in parallel over the thread pool or serial
+inline void extrapolateCost(
+    CostEstimate&               est,
+    const size_t                nPath,
+    const size_t                nPay,
+    const bool                  parallel,
+    //  Cap on the threads of the simulation, see ThreadPool::concurrency()
+    const size_t                maxThreads = 0)
+{
+    //  Worker threads and main thread, limited by the cap and the cores
+    est.threads = parallel ? ThreadPool::getInstance()->concurrency(maxThreads) : 1;
+    est.concurrency = min<size_t>(est.threads, max(1u, thread::hardware_concurrency()));
+
+    //  Batches are distributed over the threads
+    const size_t batches = (nPath + BATCHSIZE - 1) / BATCHSIZE;
+    const size_t pathsPerThread = parallel
+        ? min(nPath, (batches + est.concurrency - 1) / est.concurrency * BATCHSIZE)
+        : nPath;
+    est.wallSeconds = est.setupSeconds + pathsPerThread * est.secondsPerPath;
+
+    //  Tapes: one per thread that simulates
+    est.tapeBytes = est.adjointWidth
+        ? Cost::sharedTapeBytes(est, min(est.threads, batches))
+        : 0;
+    //  Payoffs of all paths, and aggregates in the one-dimensional case
+    est.resultBytes = Cost::resultBytes(nPath, nPay)
+        + (est.adjointWidth == 1 ? nPath * sizeof(double) : 0);
+    est.peakBytes = est.tapeBytes + est.resultBytes;
+}
+
+//  Co-scheduling of jobs within a memory budget
+//  Jobs are packed in waves, run one after the other,
+//      the jobs of a wave at the same time, with a total peak memory within the budget
+//  First fit decreasing: the largest jobs first, each in the first wave with room for it
+//  A job larger than the budget on its own runs alone, in a wave over budget
+//  Waves are ordered by their largest job, decreasing,
+//      jobs in a wave by decreasing peak memory, then by index
+
+struct JobWave
+{
+    //  Indices of the jobs in the estimates
+    vector<size_t>  jobs;
+    //  Sum of their peak memory
+    size_t          peakBytes = 0;
+};
+
+inline vector<JobWave> packJobs(
+    const vector<CostEstimate>&     estimates,
+    const size_t                    memoryBudget)
+{
+    vector<size_t> order(estimates.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b)
+    {
+        return estimates[a].peakBytes > estimates[b].peakBytes;
+    });
+
+    vector<JobWave> waves;
+    for (const size_t job : order)
+    {
+        const size_t bytes = estimates[job].peakBytes;
+        auto wave = find_if(waves.begin(), waves.end(), [&](const JobWave& w)
+        {
+            return w.peakBytes + bytes <= memoryBudget;
+        });
+        if (wave == waves.end())
+        {
+            waves.emplace_back();
+            wave = prev(waves.end());
+        }
+        wave->jobs.push_back(job);
+        wave->peakBytes += bytes;
+    }
+
+    return waves;
+}
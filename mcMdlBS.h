@@ -306,11 +306,9 @@ private:
             }
         );
 
-        copy(myDiscounts[idx].begin(), myDiscounts[idx].end(), 
-            scen.discounts.begin());
-
-        copy(myLibors[idx].begin(), myLibors[idx].end(),
-            scen.libors.begin());
+        //  Deterministic rates: path-invariant, point to the tables
+        scen.discounts = myDiscounts[idx];
+        scen.libors = myLibors[idx];
     }
 
 public:
@@ -348,4 +346,204 @@ public:
             ++idx;
         }
     }
+
+    //  Likelihood ratios
+
+    bool supportsLR() const override
+    {
+        return true;
+    }
+
+    //  Same path as generatePath(), but the spot is simulated in doubles
+    //      and stays constant with respect to the parameters
+    //  Returns the log-likelihood of the simulated log-spots: 
+    //      sum { - 0.5 * ((x(i+1) - x(i) - drift(i)) / std(i)) ^ 2 - log std(i) }
+    //  with x(0) = log(spot(0)) a function of the parameters
+    //  so its derivatives to parameters are the score
+    T generatePathLR(
+        const vector<double>&   gaussVec,
+        Scenario<T>&            path)
+            const override
+    {
+        //  Starting log spot, untemplated
+        double logSpot = log(double(mySpot));
+        //  Next index to fill on the product timeline
+        size_t idx = 0;
+        //  Is today on the product timeline?
+        if (myTodayOnTimeline)
+        {
+            fillScen(idx, mySpot, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+
+        T logLik(0.0);
+
+        //  Iterate through timeline
+        const size_t n = myTimeline.size() - 1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            //  Simulate, untemplated
+            const double nextLogSpot = logSpot
+                + double(myDrifts[i]) + double(myStds[i]) * gaussVec[i];
+
+            //  Gaussian transition density, templated
+            T z = i == 0
+                ? T((nextLogSpot - log(mySpot) - myDrifts[i]) / myStds[i])
+                : T((nextLogSpot - logSpot - myDrifts[i]) / myStds[i]);
+            logLik += - 0.5 * z * z - log(myStds[i]);
+
+            //  Store on the path, constant spot
+            logSpot = nextLogSpot;
+            fillScen(idx, T(exp(logSpot)), path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+
+        return logLik;
+    }
+
+    //  Hand-coded path adjoints
+
+    bool supportsPathAdjoint() const override
+    {
+        return is_same_v<T, Number>;
+    }
+
+private:
+
+    //  Same as fillScen() with a spot off tape, 
+    //      the stochastic samples are new leaves
+    inline void fillLeaves(
+        const size_t        idx,
+        const double        spot,
+        Sample<T>&          scen,
+        const SampleDef&    def)
+            const
+    {
+        if (def.numeraire)
+        {
+            scen.numeraire = mySpotMeasure
+                ? T(double(myNumeraires[idx]) * spot)
+                : myNumeraires[idx];
+        }
+
+        transform(myForwardFactors[idx].begin(), myForwardFactors[idx].end(),
+            scen.forwards.front().begin(),
+            [spot](const T& ff)
+            {
+                return T(spot * double(ff));
+            }
+        );
+
+        scen.discounts = myDiscounts[idx];
+        scen.libors = myLibors[idx];
+    }
+
+public:
+
+    //  Same path as generatePath(), the spot is simulated in doubles
+    //  Today's samples, if any, are recorded on tape as usual
+    void generatePathLeaves(
+        const vector<double>&   gaussVec,
+        Scenario<T>&            path)
+            const override
+    {
+        double spot = double(mySpot);
+        size_t idx = 0;
+        if (myTodayOnTimeline)
+        {
+            fillScen(idx, mySpot, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+
+        const size_t n = myTimeline.size() - 1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            spot = spot * exp(double(myDrifts[i]) 
+                + double(myStds[i]) * gaussVec[i]);
+            fillLeaves(idx, spot, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+    }
+
+    //  spot(i + 1) = spot(i) * exp(drift(i) + std(i) * G(i)), spot(0) = spot parameter
+    //  Adjoints of the samples flow back to the spots, from the last step to the first,
+    //      and from the spots to the drifts, stds, numeraires and forward factors
+    void generatePathAdjoint(
+        const vector<double>&   gaussVec,
+        const Scenario<T>&      path)
+            const override
+    {
+        if constexpr (is_same_v<T, Number>)
+        {
+            //  Temporaries
+            //  spots and growth factors exp(drift + std * G) over the simulation timeline
+            static thread_local vector<double> spots, growths;
+            //  adjoints of the current spot
+            static thread_local vector<double> spotAdj;
+
+            const size_t m = Number::numAdjoints();
+            const size_t n = myTimeline.size() - 1;
+            spots.resize(n + 1);
+            growths.resize(n);
+            spotAdj.assign(m, 0.0);
+
+            //  Forward, same as generatePathLeaves()
+            spots[0] = double(mySpot);
+            for (size_t i = 0; i < n; ++i)
+            {
+                growths[i] = exp(double(myDrifts[i]) + double(myStds[i]) * gaussVec[i]);
+                spots[i + 1] = spots[i] * growths[i];
+            }
+
+            //  Backward
+            for (size_t i = n; i > 0; --i)
+            {
+                const size_t idx = i - 1 + myTodayOnTimeline;
+                const Sample<T>& scen = path[idx];
+                const double spot = spots[i];
+
+                //  Samples
+                if ((*myDefline)[idx].numeraire && mySpotMeasure)
+                {
+                    const double* adj = scen.numeraire.adjointPtr();
+                    double* numAdj = myNumeraires[idx].adjointPtr();
+                    const double num = double(myNumeraires[idx]);
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        spotAdj[j] += num * adj[j];
+                        numAdj[j] += spot * adj[j];
+                    }
+                }
+
+                const vector<T>& ffs = myForwardFactors[idx];
+                for (size_t k = 0; k < ffs.size(); ++k)
+                {
+                    const double* adj = scen.forwards.front()[k].adjointPtr();
+                    double* ffAdj = ffs[k].adjointPtr();
+                    const double ff = double(ffs[k]);
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        spotAdj[j] += ff * adj[j];
+                        ffAdj[j] += spot * adj[j];
+                    }
+                }
+
+                //  Step
+                double* driftAdj = myDrifts[i - 1].adjointPtr();
+                double* stdAdj = myStds[i - 1].adjointPtr();
+                const double g = gaussVec[i - 1], growth = growths[i - 1];
+                for (size_t j = 0; j < m; ++j)
+                {
+                    const double expAdj = spotAdj[j] * spot;
+                    driftAdj[j] += expAdj;
+                    stdAdj[j] += expAdj * g;
+                    spotAdj[j] *= growth;
+                }
+            }
+
+            //  Today's spot
+            double* adj = mySpot.adjointPtr();
+            for (size_t j = 0; j < m; ++j) adj[j] += spotAdj[j];
+        }
+    }
 };
\ No newline at end of file
@@ -45,7 +45,12 @@ class Dupire : public Model<T>
     //  Numerical parameters
 
     //  Maximum space between time steps
-    const Time              myMaxDt;
+    Time                    myMaxDt;
+    //  Adaptive stepping: tolerance on the variation of the local vol 
+    //      over a time step, 0 = uniform steps up to myMaxDt
+    double                  myTolerance;
+    //  Trapezoidal scheme in time, Euler otherwise
+    bool                    myTrapezoid;
 
     //  Similuation timeline
     vector<Time>            myTimeline;
@@ -63,6 +68,9 @@ class Dupire : public Model<T>
     matrix<T>               myInterpVols;
     //  volatilities as stored are multiplied by sqrt(dt) 
     //  so there is no need to do that during paths generation
+    //  Trapezoidal scheme only: 
+    //      volatilities at the end of each step, also multiplied by sqrt(dt)
+    matrix<T>               myInterpVolsEnd;
 
     //  Exported parameters
     vector<T*>              myParameters;
@@ -77,13 +85,17 @@ public:
         const vector<double>    spots,
         const vector<Time>      times,
         const matrix<U>         vols,
-        const Time maxDt =      0.25)
+        const Time maxDt =      0.25,
+        const double tolerance = 0.0,
+        const bool trapezoid =   false)
         : mySpot(spot),
         mySpots(spots),
         myLogSpots(mySpots.size()),
         myTimes(times),
         myVols(vols),
         myMaxDt(maxDt),
+        myTolerance(tolerance),
+        myTrapezoid(trapezoid),
         myParameters(myVols.rows() * myVols.cols() + 1),
         myParameterLabels(myVols.rows() * myVols.cols() + 1)
     {
@@ -138,11 +150,35 @@ public:
         return myTimes;
     }
 
-    const vector<T>& vols() const
+    const matrix<T>& vols() const
     {
         return myVols;
     }
 
+    //  Numerical parameters
+    Time maxDt() const
+    {
+        return myMaxDt;
+    }
+
+    double tolerance() const
+    {
+        return myTolerance;
+    }
+
+    bool trapezoid() const
+    {
+        return myTrapezoid;
+    }
+
+    //  Change numerical parameters, before allocate()
+    void setNumerics(const Time maxDt, const double tolerance, const bool trapezoid)
+    {
+        myMaxDt = maxDt;
+        myTolerance = tolerance;
+        myTrapezoid = trapezoid;
+    }
+
     //  Access to all the model parameters
     const vector<T*>& parameters() override
     {
@@ -161,6 +197,92 @@ public:
         return clone;
     }
 
+private:
+
+    //  Adaptive stepping
+
+    //  Number of steps per unit of time required at time t
+    //  The local vol must not vary by more than a fraction myTolerance over a step
+    //      in time: dt <= tol / |dlog(vol)/dt|
+    //      in spot, which moves by vol * sqrt(dt): dt <= (tol / |dvol/dlog(spot)|)^2
+    //  and steps are capped by myMaxDt
+    double stepDensity(const Time t) const
+    {
+        const size_t nt = myTimes.size(), m = mySpots.size();
+
+        //  Time bucket on the local vol grid, flat extrapolation outside
+        const size_t k = upper_bound(myTimes.begin(), myTimes.end(), t) - myTimes.begin();
+        const bool inside = k > 0 && k < nt;
+        const double w = inside ? (t - myTimes[k - 1]) / (myTimes[k] - myTimes[k - 1]) : 0.0;
+
+        double density = 1.0 / myMaxDt;
+        double prevVol = 0.0;
+        for (size_t j = 0; j < m; ++j)
+        {
+            const T* vols = myVols[j];
+            double vol, dVoldt = 0.0;
+            if (!inside) vol = double(vols[k == 0 ? 0 : nt - 1]);
+            else
+            {
+                const double v1 = double(vols[k - 1]), v2 = double(vols[k]);
+                vol = v1 + w * (v2 - v1);
+                dVoldt = (v2 - v1) / (myTimes[k] - myTimes[k - 1]);
+            }
+
+            if (vol > EPS)
+            {
+                density = max(density, fabs(dVoldt) / vol / myTolerance);
+            }
+
+            if (j > 0)
+            {
+                const double dVoldx = (vol - prevVol) / (myLogSpots[j] - myLogSpots[j - 1]);
+                const double r = dVoldx / myTolerance;
+                density = max(density, r * r);
+            }
+            prevVol = vol;
+        }
+
+        return density;
+    }
+
+    //  Fill the interval (start, end) with steps equidistributing stepDensity()
+    //  end is pushed, start is not
+    void fillAdaptive(const Time start, const Time end, vector<Time>& timeline) const
+    {
+        //  Sub-grid for the quadrature of the density: 
+        //      local vol times inside the interval, and at least 8 points per maxDt
+        vector<Time> grid(1, start);
+        for (const Time t : myTimes) if (t > start + HALF_DAY && t < end - HALF_DAY) grid.push_back(t);
+        grid.push_back(end);
+        grid = fillData(grid, myMaxDt / 8, HALF_DAY);
+
+        //  Cumulative number of steps on the sub-grid
+        const size_t g = grid.size();
+        vector<double> cumul(g, 0.0);
+        for (size_t i = 1; i < g; ++i)
+        {
+            cumul[i] = cumul[i - 1]
+                + (grid[i] - grid[i - 1]) * stepDensity(0.5 * (grid[i - 1] + grid[i]));
+        }
+
+        //  Number of steps, and their positions by inversion of the cumulative
+        const size_t n = max<size_t>(1, size_t(ceil(cumul.back() - EPS)));
+        size_t i = 1;
+        for (size_t k = 1; k < n; ++k)
+        {
+            const double target = cumul.back() * k / n;
+            while (cumul[i] < target) ++i;
+            const Time t = grid[i - 1] 
+                + (grid[i] - grid[i - 1]) * (target - cumul[i - 1]) / (cumul[i] - cumul[i - 1]);
+            if (t > timeline.back() + HALF_DAY && t < end - HALF_DAY) timeline.push_back(t);
+        }
+
+        timeline.push_back(end);
+    }
+
+public:
+
     //  Initialize timeline
     void allocate(
         const vector<Time>&         productTimeline, 
@@ -169,12 +291,31 @@ public:
     {
         //  Fill from product timeline
         
-        //  Do the fill
-        myTimeline = fillData(
-            productTimeline, // Original (product) timeline
-            myMaxDt, // Maximum space allowed
-            HALF_DAY, // Minimum distance = half day
-            &systemTime, &systemTime + 1);  //  Hack to include system time
+        if (myTolerance > 0.0)
+        {
+            //  Event dates, including system time
+            const vector<Time> events = fillData(
+                productTimeline,
+                numeric_limits<Time>::max(), // No filling
+                HALF_DAY,
+                &systemTime, &systemTime + 1);
+
+            //  Adaptive fill between events
+            myTimeline.assign(1, events.front());
+            for (size_t i = 1; i < events.size(); ++i)
+            {
+                fillAdaptive(events[i - 1], events[i], myTimeline);
+            }
+        }
+        else
+        {
+            //  Do the fill
+            myTimeline = fillData(
+                productTimeline, // Original (product) timeline
+                myMaxDt, // Maximum space allowed
+                HALF_DAY, // Minimum distance = half day
+                &systemTime, &systemTime + 1);  //  Hack to include system time
+        }
         
         //  Mark steps on timeline that are on the product timeline
         myCommonSteps.resize(myTimeline.size());
@@ -190,6 +331,7 @@ public:
         //  Allocate the local volatilities
         //      pre-interpolated in time over simulation timeline
         myInterpVols.resize(myTimeline.size() - 1, mySpots.size());
+        if (myTrapezoid) myInterpVolsEnd.resize(myTimeline.size() - 1, mySpots.size());
     }
 
     void init(
@@ -212,6 +354,16 @@ public:
                     myVols[j],
                     myVols[j] + myTimes.size(),
                     myTimeline[i]);
+
+                if (myTrapezoid)
+                {
+                    myInterpVolsEnd[i][j] = sqrtdt * interp(
+                        myTimes.begin(),
+                        myTimes.end(),
+                        myVols[j],
+                        myVols[j] + myTimes.size(),
+                        myTimeline[i + 1]);
+                }
             }
         }
     }
@@ -258,17 +410,40 @@ public:
         const size_t m = myLogSpots.size();
         for (size_t i = 0; i < n; ++i)
         {
-            //  Interpolate volatility in spot
-            T vol = interp(
-                myLogSpots.begin(),
-                myLogSpots.end(),
-                myInterpVols[i],
-                myInterpVols[i] + m,
-                logspot);
-            //  vol comes out * sqrt(dt)
-
-            //  Apply Euler's scheme
-            logspot += vol * (- 0.5 * vol + gaussVec[i]);
+            if (myTrapezoid)
+            {
+                //  Log-Euler with variance averaged over the start and end of the step,
+                //      at the current spot (trapezoidal rule in time)
+                //  vols come out * sqrt(dt)
+                const T vol0 = interp(
+                    myLogSpots.begin(),
+                    myLogSpots.end(),
+                    myInterpVols[i],
+                    myInterpVols[i] + m,
+                    logspot);
+                const T vol1 = interp(
+                    myLogSpots.begin(),
+                    myLogSpots.end(),
+                    myInterpVolsEnd[i],
+                    myInterpVolsEnd[i] + m,
+                    logspot);
+                const T var = 0.5 * (vol0 * vol0 + vol1 * vol1);
+                logspot += - 0.5 * var + sqrt(var) * gaussVec[i];
+            }
+            else
+            {
+                //  Interpolate volatility in spot
+                T vol = interp(
+                    myLogSpots.begin(),
+                    myLogSpots.end(),
+                    myInterpVols[i],
+                    myInterpVols[i] + m,
+                    logspot);
+                //  vol comes out * sqrt(dt)
+
+                //  Apply Euler's scheme
+                logspot += vol * (- 0.5 * vol + gaussVec[i]);
+            }
 
             //  Store on the path?
             if (myCommonSteps[i + 1])
@@ -316,11 +491,12 @@ inline void dupireCalibMaturity(
     int ih = nSpots - 1;
     while (ih >= 0 && spots[ih] > ivs.spot() + 2.5 * std) --ih;
 
-    //  Loop on spots
-    for (int i = il; i <= ih; ++i)
+    //  Dupire's formula, all the spots in one batch
+    if (il <= ih)
     {
-        //  Dupire's formula
-        lVolsBegin[i] = ivs.localVol(spots[i], maturity, &riskView);
+        const vector<double> inner(spots + il, spots + ih + 1);
+        const auto lVols = ivs.localVols(inner, maturity, &riskView);
+        copy(lVols.begin(), lVols.end(), lVolsBegin + il);
     }
 
     //  Extrapolate flat outside std
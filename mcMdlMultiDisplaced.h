@@ -638,11 +638,9 @@ private:
                 });
         }
 
-        copy(myDiscounts[idx].begin(), myDiscounts[idx].end(), 
-            scen.discounts.begin());
-
-        copy(myLibors[idx].begin(), myLibors[idx].end(),
-            scen.libors.begin());
+        //  Deterministic rates: path-invariant, point to the tables
+        scen.discounts = myDiscounts[idx];
+        scen.libors = myLibors[idx];
     }
 
 public:
@@ -658,6 +656,8 @@ public:
         //  Temporaries
 		static thread_local vector<T> spots;
 		spots.resize(myNumAssets);
+		static thread_local vector<T> cws;
+		cws.resize(myNumAssets);
 
         //  Today
 
@@ -679,15 +679,12 @@ public:
         {
             //  Brownian increments for this time step
             const double* w = gaussVec.data() + i * myNumAssets;
+            //  Build correlated Brownians, see matrix.h
+            lowerMatVec(myChol, w, cws.data());
             //  Iterate on assets
             for (size_t a = 0; a < myNumAssets; ++a)
             {
-                //  Build correlated Brownian
-                T cw(0.0);
-                for (size_t i = 0; i <= a; ++i)
-                {
-                    cw += myChol[a][i] * w[i];
-                }
+                const T& cw = cws[a];
 
                 //  Forward
                 T fwd = spots[a] * myDynFwdFacts[i][a];
@@ -715,4 +712,421 @@ public:
             ++idx;
         }
     }
+
+    //  Likelihood ratios
+
+    bool supportsLR() const override
+    {
+        return true;
+    }
+
+    //  Same path as generatePath(), but the spots are simulated in doubles
+    //      and stay constant with respect to the parameters
+    //  Returns the log-likelihood of the simulated spots, 
+    //      as a function of the parameters:
+    //  on each step, the spots map to correlated Gaussians cw = h(spots, params)
+    //      with density -0.5 * cw' C^-1 cw - 0.5 * log det C + sum log |dh/dspot|
+    //  C^-1 and det C are obtained from the Cholesky decomposition C = LL'
+    T generatePathLR(
+        const vector<double>&   gaussVec,
+        Scenario<T>&            path)
+            const override
+    {
+        //  Temporaries
+        //  simulated spots, untemplated
+        static thread_local vector<double> spots, nextSpots;
+        //  correlated and independent Gaussians, as functions of the parameters
+        static thread_local vector<T> cws, ws;
+        //  simulated spots, as constants on tape
+        static thread_local vector<T> cSpots;
+        spots.resize(myNumAssets);
+        nextSpots.resize(myNumAssets);
+        cws.resize(myNumAssets);
+        ws.resize(myNumAssets);
+        cSpots.resize(myNumAssets);
+
+        //  Today
+        transform(mySpots.begin(), mySpots.end(), spots.begin(), 
+            [](const T& spot) { return double(spot); });
+
+        //  Index on the product timeline
+        size_t idx = 0;
+        //  If today is on the product timeline, fill sample
+        //  Note today's spots are parameters, not simulated
+        if (myTodayOnTimeline)
+        {
+            fillScen(idx, mySpots, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+
+        //  Log-determinant of the Cholesky coefs, same on all steps
+        T logDetL(0.0);
+        for (size_t a = 0; a < myNumAssets; ++a)
+        {
+            if (double(myChol[a][a]) < 1.0e-15)
+            {
+                throw runtime_error("MultiDisplaced : singular correlation, likelihood ratio not defined");
+            }
+            logDetL += log(myChol[a][a]);
+        }
+
+        //  Log-likelihood, up to a constant
+        T logLik(0.0);
+
+        //  Iterate through timeline
+        const size_t n = myTimeline.size() - 1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            //  Simulate, untemplated, same scheme as generatePath()
+            const double* w = gaussVec.data() + i * myNumAssets;
+            for (size_t a = 0; a < myNumAssets; ++a)
+            {
+                double cw = 0.0;
+                for (size_t j = 0; j <= a; ++j)
+                {
+                    cw += double(myChol[a][j]) * w[j];
+                }
+
+                const double fwd = spots[a] * double(myDynFwdFacts[i][a]);
+                const double drift = double(myDrifts[i][a]);
+                const double std = double(myStds[i][a]);
+                const double alpha = double(myAlphas[a]);
+
+				switch(myDynamics[a])
+				{
+				case Lognormal:
+					nextSpots[a] = fwd * exp(drift + std * cw);
+					break;
+				case Normal:
+					nextSpots[a] = fwd + std * cw;
+					break;
+				case Surnormal:
+					nextSpots[a] = (fwd + alpha) * exp(drift + std * cw) - alpha;
+					break;
+				case Subnormal:
+				default:
+					nextSpots[a] = (fwd - alpha) * exp(drift + std * cw) + alpha;
+					break;
+				}
+            }
+
+            //  Invert the scheme: correlated Gaussians as functions of the parameters
+            //      and log-Jacobians log |d cw / d nextSpot|
+            for (size_t a = 0; a < myNumAssets; ++a)
+            {
+                const double next = nextSpots[a];
+                //  Spot on the start of the step is a parameter on the first step
+                T fwd = i == 0 
+                    ? T(mySpots[a] * myDynFwdFacts[i][a]) 
+                    : T(spots[a] * myDynFwdFacts[i][a]);
+
+                switch(myDynamics[a])
+                {
+                case Lognormal:
+                    cws[a] = (log(next / fwd) - myDrifts[i][a]) / myStds[i][a];
+                    logLik -= log(fabs(myStds[i][a]));
+                    break;
+                case Normal:
+                    cws[a] = (next - fwd) / myStds[i][a];
+                    logLik -= log(fabs(myStds[i][a]));
+                    break;
+                case Surnormal:
+                    cws[a] = (log((next + myAlphas[a]) / (fwd + myAlphas[a])) - myDrifts[i][a]) / myStds[i][a];
+                    logLik -= log(fabs(myStds[i][a] * (next + myAlphas[a])));
+                    break;
+                case Subnormal:
+                default:
+                    cws[a] = (log((next - myAlphas[a]) / (fwd - myAlphas[a])) - myDrifts[i][a]) / myStds[i][a];
+                    logLik -= log(fabs(myStds[i][a] * (next - myAlphas[a])));
+                    break;
+                }
+            }
+
+            //  Independent Gaussians, forward substitution L ws = cws
+            //      so cws' C^-1 cws = ws' ws
+            for (size_t a = 0; a < myNumAssets; ++a)
+            {
+                T sum = cws[a];
+                for (size_t j = 0; j < a; ++j)
+                {
+                    sum -= myChol[a][j] * ws[j];
+                }
+                ws[a] = sum / myChol[a][a];
+                logLik -= 0.5 * ws[a] * ws[a];
+            }
+            logLik -= logDetL;
+
+            //  Store on the path, constant spots
+            copy(nextSpots.begin(), nextSpots.end(), spots.begin());
+            transform(spots.begin(), spots.end(), cSpots.begin(), 
+                [](const double spot) { return T(spot); });
+            fillScen(idx, cSpots, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+
+        return logLik;
+    }
+
+    //  Hand-coded path adjoints
+
+    bool supportsPathAdjoint() const override
+    {
+        return is_same_v<T, Number>;
+    }
+
+private:
+
+    //  Same as fillScen() with spots off tape, 
+    //      the stochastic samples are new leaves
+    inline void fillLeaves(
+        const size_t            idx,
+        const vector<double>&   spots,
+        Sample<T>&              scen,
+        const SampleDef&        def)
+            const
+    {
+        if (def.numeraire)
+        {
+            scen.numeraire = myNumeraires[idx];
+        }
+
+        auto* fwdFacts = myForwardFactors[idx];
+        for (size_t a = 0; a < myNumAssets; ++a)
+        {
+            transform(fwdFacts[a].begin(), fwdFacts[a].end(),
+                scen.forwards[a].begin(),
+                [spot = spots[a]](const T& ff)
+                {
+                    return T(spot * double(ff));
+                });
+        }
+
+        scen.discounts = myDiscounts[idx];
+        scen.libors = myLibors[idx];
+    }
+
+    //  One step of the scheme of generatePath() in doubles, for all assets
+    //  Returns the next spots, and the correlated Gaussians and growth factors
+    //      exp(drift + std * cw) used by the adjoints
+    inline void stepLeaves(
+        const size_t            i,
+        const double*           w,
+        const double*           spots,
+        double*                 nextSpots,
+        double*                 cws,
+        double*                 growths)
+            const
+    {
+        for (size_t a = 0; a < myNumAssets; ++a)
+        {
+            //  Same order as lowerMatVec()
+            double cw = 0.0;
+            for (size_t j = 0; j <= a; ++j)
+            {
+                cw += w[j] * double(myChol[a][j]);
+            }
+            cws[a] = cw;
+
+            const double fwd = spots[a] * double(myDynFwdFacts[i][a]);
+            const double std = double(myStds[i][a]);
+            const double alpha = double(myAlphas[a]);
+
+            switch (myDynamics[a])
+            {
+            case Lognormal:
+                growths[a] = exp(double(myDrifts[i][a]) + std * cw);
+                nextSpots[a] = fwd * growths[a];
+                break;
+            case Normal:
+                growths[a] = 1.0;
+                nextSpots[a] = fwd + std * cw;
+                break;
+            case Surnormal:
+                growths[a] = exp(double(myDrifts[i][a]) + std * cw);
+                nextSpots[a] = (fwd + alpha) * growths[a] - alpha;
+                break;
+            case Subnormal:
+            default:
+                growths[a] = exp(double(myDrifts[i][a]) + std * cw);
+                nextSpots[a] = (fwd - alpha) * growths[a] + alpha;
+                break;
+            }
+        }
+    }
+
+public:
+
+    //  Same path as generatePath(), the spots are simulated in doubles
+    //  Today's samples, if any, are recorded on tape as usual
+    void generatePathLeaves(
+        const vector<double>&   gaussVec,
+        Scenario<T>&            path)
+            const override
+    {
+        //  Temporaries
+        static thread_local vector<double> spots, nextSpots, cws, growths;
+        spots.resize(myNumAssets);
+        nextSpots.resize(myNumAssets);
+        cws.resize(myNumAssets);
+        growths.resize(myNumAssets);
+
+        transform(mySpots.begin(), mySpots.end(), spots.begin(),
+            [](const T& spot) { return double(spot); });
+
+        size_t idx = 0;
+        if (myTodayOnTimeline)
+        {
+            fillScen(idx, mySpots, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+
+        const size_t n = myTimeline.size() - 1;
+        for (size_t i = 0; i < n; ++i)
+        {
+            stepLeaves(i, gaussVec.data() + i * myNumAssets, 
+                spots.data(), nextSpots.data(), cws.data(), growths.data());
+            spots.swap(nextSpots);
+            fillLeaves(idx, spots, path[idx], (*myDefline)[idx]);
+            ++idx;
+        }
+    }
+
+    //  Adjoints of the samples flow back to the spots, from the last step to the first,
+    //      then through the scheme of each asset:
+    //      fwd = spot * dynFwdFact, cw = sum chol * w and
+    //      lognormal:  next = fwd * exp(drift + std * cw)
+    //      normal:     next = fwd + std * cw
+    //      surnormal:  next = (fwd + alpha) * exp(drift + std * cw) - alpha
+    //      subnormal:  next = (fwd - alpha) * exp(drift + std * cw) + alpha
+    void generatePathAdjoint(
+        const vector<double>&   gaussVec,
+        const Scenario<T>&      path)
+            const override
+    {
+        if constexpr (is_same_v<T, Number>)
+        {
+            //  Temporaries
+            //  spots, correlated Gaussians and growth factors, [step, asset]
+            static thread_local vector<double> spots, cws, growths;
+            //  adjoints of the current spots, [asset, adjoint], and of a correlated Gaussian
+            static thread_local vector<double> spotAdjs, cwAdjs;
+
+            const size_t A = myNumAssets;
+            const size_t m = Number::numAdjoints();
+            const size_t n = myTimeline.size() - 1;
+            spots.resize((n + 1) * A);
+            cws.resize(n * A);
+            growths.resize(n * A);
+            spotAdjs.assign(A * m, 0.0);
+            cwAdjs.resize(m);
+
+            //  Forward, same as generatePathLeaves()
+            transform(mySpots.begin(), mySpots.end(), spots.begin(),
+                [](const T& spot) { return double(spot); });
+            for (size_t i = 0; i < n; ++i)
+            {
+                stepLeaves(i, gaussVec.data() + i * A, &spots[i * A], &spots[(i + 1) * A], 
+                    &cws[i * A], &growths[i * A]);
+            }
+
+            //  Backward
+            for (size_t i = n; i > 0; --i)
+            {
+                const size_t idx = i - 1 + myTodayOnTimeline;
+                const Sample<T>& scen = path[idx];
+                const double* next = &spots[i * A];
+                const double* prev = &spots[(i - 1) * A];
+                const double* w = gaussVec.data() + (i - 1) * A;
+
+                //  Samples
+                auto* fwdFacts = myForwardFactors[idx];
+                for (size_t a = 0; a < A; ++a)
+                {
+                    double* spotAdj = &spotAdjs[a * m];
+                    const vector<T>& ffs = fwdFacts[a];
+                    for (size_t k = 0; k < ffs.size(); ++k)
+                    {
+                        const double* adj = scen.forwards[a][k].adjointPtr();
+                        double* ffAdj = ffs[k].adjointPtr();
+                        const double ff = double(ffs[k]);
+                        for (size_t j = 0; j < m; ++j)
+                        {
+                            spotAdj[j] += ff * adj[j];
+                            ffAdj[j] += next[a] * adj[j];
+                        }
+                    }
+                }
+
+                //  Step
+                for (size_t a = 0; a < A; ++a)
+                {
+                    double* spotAdj = &spotAdjs[a * m];
+                    const double cw = cws[(i - 1) * A + a];
+                    const double growth = growths[(i - 1) * A + a];
+                    const double dff = double(myDynFwdFacts[i - 1][a]);
+                    const double fwd = prev[a] * dff;
+                    const double std = double(myStds[i - 1][a]);
+                    const double alpha = double(myAlphas[a]);
+
+                    double* dffAdj = myDynFwdFacts[i - 1][a].adjointPtr();
+                    double* driftAdj = myDrifts[i - 1][a].adjointPtr();
+                    double* stdAdj = myStds[i - 1][a].adjointPtr();
+                    double* alphaAdj = myAlphas[a].adjointPtr();
+
+                    for (size_t j = 0; j < m; ++j)
+                    {
+                        const double nextAdj = spotAdj[j];
+
+                        //  Adjoints of fwd and of drift + std * cw
+                        double fwdAdj, expAdj;
+                        switch (myDynamics[a])
+                        {
+                        case Lognormal:
+                            fwdAdj = nextAdj * growth;
+                            expAdj = nextAdj * fwd * growth;
+                            break;
+                        case Normal:
+                            //  No exponential: next = fwd + std * cw
+                            fwdAdj = nextAdj;
+                            expAdj = nextAdj;
+                            break;
+                        case Surnormal:
+                            fwdAdj = nextAdj * growth;
+                            expAdj = nextAdj * (fwd + alpha) * growth;
+                            alphaAdj[j] += nextAdj * (growth - 1.0);
+                            break;
+                        case Subnormal:
+                        default:
+                            fwdAdj = nextAdj * growth;
+                            expAdj = nextAdj * (fwd - alpha) * growth;
+                            alphaAdj[j] += nextAdj * (1.0 - growth);
+                            break;
+                        }
+
+                        if (myDynamics[a] != Normal) driftAdj[j] += expAdj;
+                        stdAdj[j] += expAdj * cw;
+                        cwAdjs[j] = expAdj * std;
+
+                        //  fwd = spot * dynFwdFact
+                        dffAdj[j] += fwdAdj * prev[a];
+                        spotAdj[j] = fwdAdj * dff;
+                    }
+
+                    //  cw = sum chol[a][k] * w[k]
+                    for (size_t k = 0; k <= a; ++k)
+                    {
+                        double* cholAdj = myChol[a][k].adjointPtr();
+                        for (size_t j = 0; j < m; ++j) cholAdj[j] += cwAdjs[j] * w[k];
+                    }
+                }
+            }
+
+            //  Today's spots
+            for (size_t a = 0; a < A; ++a)
+            {
+                double* adj = mySpots[a].adjointPtr();
+                for (size_t j = 0; j < m; ++j) adj[j] += spotAdjs[a * m + j];
+            }
+        }
+    }
 };
\ No newline at end of file
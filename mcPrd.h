@@ -85,6 +85,22 @@ public:
         European(strike, exerciseDate, exerciseDate)
     {}
 
+    //  Access to product data
+    double strike() const
+    {
+        return myStrike;
+    }
+
+    Time exerciseDate() const
+    {
+        return myExerciseDate;
+    }
+
+    Time settlementDate() const
+    {
+        return mySettlementDate;
+    }
+
     //  Virtual copy constructor
     unique_ptr<Product<T>> clone() const override
     {
@@ -207,6 +223,33 @@ public:
         myLabels[0] = ost.str();
     }
 
+    //  Access to product data
+    double strike() const
+    {
+        return myStrike;
+    }
+
+    double barrier() const
+    {
+        return myBarrier;
+    }
+
+    Time maturity() const
+    {
+        return myMaturity;
+    }
+
+    double smooth() const
+    {
+        return mySmooth;
+    }
+
+    //  false = call, true = put
+    bool callPut() const
+    {
+        return myCallPut;
+    }
+
     //  Virtual copy constructor
     unique_ptr<Product<T>> clone() const override
     {
@@ -273,18 +316,47 @@ public:
         }
 
         //  Payoff
+        const T euro = vanilla(path);
+        payoffs[0] = alive * euro;                                    
+        payoffs[1] = euro;
+    }
+
+    //  Split for mixed pathwise / likelihood ratio Greeks
+    //  Continuous: the European, discontinuous: the knock-out, not smoothed
+    void splitPayoffs(
+        const Scenario<T>&          path,
+        vector<T>&                  continuous,
+        vector<T>&                  discontinuous)
+            const override
+    {
+        const T euro = vanilla(path);
+        continuous[0] = continuous[1] = euro;
+
+        //  Breached?
+        const bool breached = any_of(path.begin(), path.end(), 
+            [this](const Sample<T>& sample) 
+            { 
+                return sample.forwards.front().front() > myBarrier; 
+            });
+
+        discontinuous[0] = breached ? T(-euro) : T(0.0);
+        discontinuous[1] = T(0.0);
+    }
+
+private:
+
+    //  The European payoff at maturity
+    T vanilla(const Scenario<T>& path) const
+    {
         const auto finalSpot = path.back().forwards.front().front();
-		T euro;
 		if (myCallPut)
 		{
-			euro = max(myStrike - finalSpot, 0.0) / path.back().numeraire;
+			return max(myStrike - finalSpot, 0.0) / path.back().numeraire;
 		}
 		else
 		{
-			euro = max(finalSpot - myStrike, 0.0) / path.back().numeraire;     		
+			return max(finalSpot - myStrike, 0.0) / path.back().numeraire;     		
 		}
-        payoffs[0] = alive * euro;                                    
-        payoffs[1] = euro;
     }
 };
 
@@ -527,9 +599,10 @@ public:
         const double smooth = double(path.front().forwards.front().front() * mySmooth),
             twoSmooth = 2 * smooth;
 
-        //  Period by period
+        //  Period by period, coupons and redemption summed in one node at the end
         const size_t n = path.size() - 1;
-        payoffs.front() = 0;
+        static thread_local vector<T> flows;
+        flows.resize(n + 1);
         for (size_t i = 0; i < n; ++i)
         {
             const auto& start = path[i];
@@ -562,14 +635,45 @@ public:
 
             //  ~smoothing
 
-            payoffs.front() += 
+            flows[i] = 
                 digital                     //  contingency
                 * ( start.libors.front()    //  libor(Ti, Ti+1)
                 + myCpn)                    //  + coupon
                 * myDt[i]                   //  day count / 365
                 / end.numeraire;            //  paid at Ti+1
         }
-        payoffs.front() += 1.0 / path.back().numeraire;  //  redemption at maturity
+        flows[n] = 1.0 / path.back().numeraire;  //  redemption at maturity
+
+        //  Fused sum, see AAD.h
+        payoffs.front() = sum(flows.begin(), flows.end());
+    }
+
+    //  Split for mixed pathwise / likelihood ratio Greeks
+    //  Continuous: the redemption, discontinuous: the coupons, not smoothed
+    void splitPayoffs(
+        const Scenario<T>&          path,
+        vector<T>&                  continuous,
+        vector<T>&                  discontinuous)
+        const override
+    {
+        continuous.front() = 1.0 / path.back().numeraire;
+
+        const size_t n = path.size() - 1;
+        discontinuous.front() = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto& start = path[i];
+            const auto& end = path[i + 1];
+
+            //  Is asset performance positive?
+            if (end.forwards.front().front() >= start.forwards.front().front())
+            {
+                discontinuous.front() += 
+                    (start.libors.front() + myCpn)
+                    * myDt[i]
+                    / end.numeraire;
+            }
+        }
     }
 };
 
@@ -278,8 +278,12 @@ public:
 		vector<T>&                  payoffs)
 		const override
 	{
-		T basket = inner_product(myWeights.begin(), myWeights.end(), path[0].forwards.begin(), T(0.0),
-			plus<T>(), [](const double weight, const vector<T>& fwds) { return weight * fwds[0]; });
+		//  Fused inner product, see AAD.h
+		static thread_local vector<T> spots;
+		spots.resize(myWeights.size());
+		transform(path[0].forwards.begin(), path[0].forwards.begin() + myWeights.size(), spots.begin(),
+			[](const vector<T>& fwds) { return fwds[0]; });
+		const T basket = dot(spots.begin(), spots.end(), myWeights.begin());
 
 		transform(myStrikes.begin(), myStrikes.end(), payoffs.begin(),
 			[&basket, num = path[0].numeraire](const double k) {return max(basket - k, 0.0) / num; });
@@ -392,6 +396,26 @@ public:
 		vector<T>&                  payoffs)
 		const override
 	{
+        payoffs[0] = payoff(path, mySmooth);
+	}
+
+    //  Split for mixed pathwise / likelihood ratio Greeks
+    //  The whole payoff is conditional to KO, so discontinuous, not smoothed
+	void splitPayoffs(
+		const Scenario<T>&          path,
+		vector<T>&                  continuous,
+		vector<T>&                  discontinuous)
+		const override
+	{
+        continuous[0] = T(0.0);
+        discontinuous[0] = payoff(path, 0.0);
+	}
+
+private:
+
+    //  Payoff with a given smoothing, 0 = no smoothing
+    T payoff(const Scenario<T>& path, const double smooth) const
+    {
         //  Temporaries
         static thread_local vector<T> perfs;
         perfs.resize(myNumAssets);
@@ -399,7 +423,7 @@ public:
         //  Periods
         const double dt = myMaturity / myNumPeriods;
         T notionalAlive(1.0);
-        payoffs[0] = 0.0;
+        T result(0.0);
         for (int step=0; step<myNumPeriods-1; ++step)
         {
             auto& state = path[step];
@@ -407,14 +431,16 @@ public:
             T worst = *min_element(perfs.begin(), perfs.end());
 
             //  receive cpn
-            payoffs[0] += notionalAlive * myCpn * dt / state.numeraire;
+            result += notionalAlive * myCpn * dt / state.numeraire;
 
-            //  apply ko smoothly
-            T notionalSurviving = notionalAlive * min(1.0, max(0.0, (myKO + mySmooth - worst) / 2 / mySmooth));
+            //  apply ko smoothly, or not
+            T notionalSurviving = smooth > 0.0
+                ? T(notionalAlive * min(1.0, max(0.0, (myKO + smooth - worst) / 2 / smooth)))
+                : (worst > myKO ? T(0.0) : notionalAlive);
             T notionalDead = notionalAlive - notionalSurviving;
 
             //  receive redemption on dead notional
-            payoffs[0] += notionalDead / state.numeraire;
+            result += notionalDead / state.numeraire;
 
             //  continue with the rest
             notionalAlive = notionalSurviving;
@@ -428,13 +454,15 @@ public:
             T worst = *min_element(perfs.begin(), perfs.end());
 
             //  receive cpn
-            payoffs[0] += notionalAlive * myCpn * dt / state.numeraire;
+            result += notionalAlive * myCpn * dt / state.numeraire;
 
             //  receive redemption
-            payoffs[0] += notionalAlive / state.numeraire;
+            result += notionalAlive / state.numeraire;
 
             // pay put
-            payoffs[0] -= notionalAlive * max(myStrike - worst, 0.0) / myStrike / state.numeraire;        
+            result -= notionalAlive * max(myStrike - worst, 0.0) / myStrike / state.numeraire;        
         }
-	}
+
+        return result;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Result sinks, for simulations that stream the payoffs of every path,
+//      instead of returning the nPath x nPay matrix, 
+//      see ResultSink and mcSimul(), mcParallelSimul() in mcBase.h
+//  Memory is bounded by the sinks, so distributions of payoffs,
+//      like exposures or PnLs, are estimated in one pass over any number of paths
+
+#include "mcBase.h"
+#include "quantileSketch.h"
+
+//  Distribution of every payoff, one quantile sketch per payoff
+class QuantileSink : public ResultSink
+{
+    const size_t            myK;
+    vector<QuantileSketch>  mySketches;
+
+public:
+
+    //  k = accuracy of the sketches, see quantileSketch.h
+    QuantileSink(const size_t k = 1000) : myK(k) {}
+
+    void init(const size_t nPay) override
+    {
+        mySketches.assign(nPay, QuantileSketch(myK));
+    }
+
+    void consume(const size_t, const vector<double>& payoffs) override
+    {
+        for (size_t j = 0; j < mySketches.size(); ++j) mySketches[j].add(payoffs[j]);
+    }
+
+    unique_ptr<ResultSink> cloneEmpty() const override
+    {
+        auto sink = make_unique<QuantileSink>(myK);
+        sink->init(mySketches.size());
+        return sink;
+    }
+
+    void merge(const ResultSink& rhs) override
+    {
+        const auto& other = dynamic_cast<const QuantileSink&>(rhs);
+        for (size_t j = 0; j < mySketches.size(); ++j) mySketches[j].merge(other.mySketches[j]);
+    }
+
+    const QuantileSketch& sketch(const size_t payoff) const
+    {
+        return mySketches[payoff];
+    }
+};
@@ -0,0 +1,735 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Statistics engine for the forwards simulated on the event dates of a product
+//  Means and covariances of forwards and increments are accumulated directly
+//      from the paths, in blocks, instead of going through one payoff per
+//      first and second moment (see MultiStats in mcPrdMulti.h)
+
+#include "mcBase.h"
+
+//  Moments of a stream of observation vectors
+//  Observations are buffered in blocks of BATCHSIZE,
+//      each block is centred on its own mean and folded into the cross-products
+//      with a symmetric rank-k update (lower triangle only),
+//      then merged into the running totals with the pairwise formula of Chan et al.
+
+class MomentAccumulator
+{
+    size_t          myDim;
+
+    //  Pending observations, stored dimension major myBlock[dim][obs]
+    //      so the rank-k update runs over contiguous memory
+    matrix<double>  myBlock;
+    size_t          myPending;
+
+    //  Running totals: number of observations, mean and
+    //      lower triangle of the centred cross-products sum (x - mean)(x - mean)'
+    size_t          myCount;
+    vector<double>  myMean;
+    matrix<double>  myCross;
+
+    //  Work space for one block
+    vector<double>  myBlockMean;
+    matrix<double>  myBlockCross;
+    vector<double>  myDelta;
+
+    //  Merge n2 observations with given mean and centred cross-products
+    void merge(const size_t n2, const vector<double>& mean2, const matrix<double>& cross2)
+    {
+        if (!n2) return;
+
+        const size_t n1 = myCount, n = n1 + n2;
+        const double w = double(n1) * double(n2) / n;
+
+        for (size_t i = 0; i < myDim; ++i) myDelta[i] = mean2[i] - myMean[i];
+
+        for (size_t i = 0; i < myDim; ++i)
+        {
+            const double wdi = w * myDelta[i];
+            for (size_t j = 0; j <= i; ++j)
+            {
+                myCross[i][j] += cross2[i][j] + wdi * myDelta[j];
+            }
+        }
+
+        const double w2 = double(n2) / n;
+        for (size_t i = 0; i < myDim; ++i) myMean[i] += w2 * myDelta[i];
+
+        myCount = n;
+    }
+
+public:
+
+    MomentAccumulator(const size_t dim = 0)
+    {
+        init(dim);
+    }
+
+    void init(const size_t dim)
+    {
+        myDim = dim;
+        myBlock.resize(dim, BATCHSIZE);
+        myPending = 0;
+        myCount = 0;
+        myMean.assign(dim, 0.0);
+        myCross.resize(dim, dim);
+        fill(myCross.begin(), myCross.end(), 0.0);
+        myBlockMean.resize(dim);
+        myBlockCross.resize(dim, dim);
+        myDelta.resize(dim);
+    }
+
+    size_t dim() const
+    {
+        return myDim;
+    }
+
+    //  Add one observation, x points to dim() contiguous values
+    void add(const double* x)
+    {
+        for (size_t i = 0; i < myDim; ++i) myBlock[i][myPending] = x[i];
+        if (++myPending == BATCHSIZE) flush();
+    }
+
+    //  Fold pending observations into the totals
+    //  Must be called before reading results
+    void flush()
+    {
+        const size_t m = myPending;
+        if (!m) return;
+
+        //  Block mean, then centre
+        for (size_t i = 0; i < myDim; ++i)
+        {
+            double* xi = myBlock[i];
+            double s = 0.0;
+            for (size_t r = 0; r < m; ++r) s += xi[r];
+            s /= m;
+            myBlockMean[i] = s;
+            for (size_t r = 0; r < m; ++r) xi[r] -= s;
+        }
+
+        //  Rank-m update of the lower triangle
+        for (size_t i = 0; i < myDim; ++i)
+        {
+            const double* xi = myBlock[i];
+            double* ci = myBlockCross[i];
+            for (size_t j = 0; j <= i; ++j)
+            {
+                ci[j] = dot(xi, myBlock[j], m);
+            }
+        }
+
+        merge(m, myBlockMean, myBlockCross);
+        myPending = 0;
+    }
+
+    //  Merge with another accumulator of the same dimension
+    void merge(MomentAccumulator& rhs)
+    {
+        flush();
+        rhs.flush();
+        merge(rhs.myCount, rhs.myMean, rhs.myCross);
+    }
+
+    //  Results, after flush()
+
+    size_t count() const
+    {
+        return myCount;
+    }
+
+    const vector<double>& mean() const
+    {
+        return myMean;
+    }
+
+    //  Unbiased covariance, full symmetric matrix
+    matrix<double> covariance() const
+    {
+        matrix<double> cov(myDim, myDim);
+        const double scale = myCount > 1 ? 1.0 / (myCount - 1) : 0.0;
+        for (size_t i = 0; i < myDim; ++i) for (size_t j = 0; j <= i; ++j)
+        {
+            cov[i][j] = cov[j][i] = scale * myCross[i][j];
+        }
+        return cov;
+    }
+};
+
+//  Means and covariances on a sequence of dates
+struct MomentStats
+{
+    //  One vector(0..nAssets-1) per date
+    vector<vector<double>>  means;
+    //  One matrix(0..nAssets-1, 0..nAssets-1) per date
+    vector<matrix<double>>  covs;
+};
+
+//  Results of the statistics engine
+struct StatsSimulResults
+{
+    //  Forwards (first forward of each asset) fixed on the event dates
+    MomentStats             levels;
+    //  Increments of the forwards between consecutive event dates
+    MomentStats             increments;
+
+    //  AAD only: sensitivities of the means and covariances,
+    //      one MomentStats per model parameter
+    vector<MomentStats>     levelRisks;
+    vector<MomentStats>     incrementRisks;
+};
+
+//  Accumulates the moments of levels and increments over paths
+class ForwardStatsAccumulator
+{
+    size_t                      myNumAssets;
+    vector<MomentAccumulator>   myLevels;
+    vector<MomentAccumulator>   myIncrements;
+
+    //  Work space
+    vector<double>              myPrev;
+    vector<double>              myCurr;
+    vector<double>              myIncr;
+
+    static MomentStats pack(const vector<MomentAccumulator>& accs)
+    {
+        MomentStats stats;
+        for (const auto& acc : accs)
+        {
+            stats.means.push_back(acc.mean());
+            stats.covs.push_back(acc.covariance());
+        }
+        return stats;
+    }
+
+public:
+
+    ForwardStatsAccumulator(const size_t nTimes = 0, const size_t nAssets = 0)
+    {
+        init(nTimes, nAssets);
+    }
+
+    void init(const size_t nTimes, const size_t nAssets)
+    {
+        myNumAssets = nAssets;
+        myLevels.assign(nTimes, MomentAccumulator(nAssets));
+        myIncrements.assign(nTimes > 1 ? nTimes - 1 : 0, MomentAccumulator(nAssets));
+        myPrev.resize(nAssets);
+        myCurr.resize(nAssets);
+        myIncr.resize(nAssets);
+    }
+
+    template <class T>
+    void add(const Scenario<T>& path)
+    {
+        for (size_t t = 0; t < myLevels.size(); ++t)
+        {
+            for (size_t a = 0; a < myNumAssets; ++a)
+            {
+                myCurr[a] = double(path[t].forwards[a].front());
+            }
+            myLevels[t].add(myCurr.data());
+
+            if (t > 0)
+            {
+                for (size_t a = 0; a < myNumAssets; ++a) myIncr[a] = myCurr[a] - myPrev[a];
+                myIncrements[t - 1].add(myIncr.data());
+            }
+
+            myPrev.swap(myCurr);
+        }
+    }
+
+    void merge(ForwardStatsAccumulator& rhs)
+    {
+        for (size_t t = 0; t < myLevels.size(); ++t) myLevels[t].merge(rhs.myLevels[t]);
+        for (size_t t = 0; t < myIncrements.size(); ++t) myIncrements[t].merge(rhs.myIncrements[t]);
+    }
+
+    void flush()
+    {
+        for (auto& acc : myLevels) acc.flush();
+        for (auto& acc : myIncrements) acc.flush();
+    }
+
+    //  Write means and covariances into results, after flush()
+    void pack(StatsSimulResults& results) const
+    {
+        results.levels = pack(myLevels);
+        results.increments = pack(myIncrements);
+    }
+};
+
+//  The product's defline must request one forward for every asset on every event date
+//  Only the first forward is used
+template <class T>
+inline void checkStatsDefline(const Product<T>& prd)
+{
+    for (const auto& def : prd.defline())
+    {
+        if (def.forwardMats.size() != prd.numAssets()
+            || any_of(def.forwardMats.begin(), def.forwardMats.end(),
+                [](const vector<Time>& mats) { return mats.empty(); }))
+        {
+            throw runtime_error("Statistics engine: product must fix one forward per asset on every event date");
+        }
+    }
+}
+
+//  Serial
+
+inline StatsSimulResults mcSimulStats(
+    const Product<double>&      prd,
+    const Model<double>&        mdl,
+    const RNG&                  rng,
+    const size_t                nPath)
+{
+    if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
+    checkStatsDefline(prd);
+
+    auto cMdl = mdl.clone();
+    auto cRng = rng.clone();
+
+    Scenario<double> path;
+    allocatePath(prd.defline(), path);
+    cMdl->allocate(prd.timeline(), prd.defline());
+    cMdl->init(prd.timeline(), prd.defline());
+    initializePath(path);
+    cRng->init(cMdl->simDim());
+    vector<double> gaussVec(cMdl->simDim());
+
+    ForwardStatsAccumulator stats(prd.timeline().size(), prd.numAssets());
+
+    for (size_t i = 0; i < nPath; i++)
+    {
+        cRng->nextG(gaussVec);
+        cMdl->generatePath(gaussVec, path);
+        stats.add(path);
+    }
+
+    stats.flush();
+    StatsSimulResults results;
+    stats.pack(results);
+
+    return results;
+}
+
+//  Parallel, one accumulator per workspace slot, merged at the end
+//  Merging is exact up to rounding, so results may differ
+//      from the serial version in the last digits
+
+inline StatsSimulResults mcParallelSimulStats(
+    const Product<double>&      prd,
+    const Model<double>&        mdl,
+    const RNG&                  rng,
+    const size_t                nPath,
+    //  Cap on the threads working on the simulation, 0: the whole pool
+    const size_t                maxThreads = 0)
+{
+    if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
+    checkStatsDefline(prd);
+
+    auto cMdl = mdl.clone();
+
+    cMdl->allocate(prd.timeline(), prd.defline());
+    cMdl->init(prd.timeline(), prd.defline());
+
+    ThreadPool *pool = ThreadPool::getInstance();
+    const size_t nSlots = pool->concurrency(maxThreads);
+    WorkspaceSlots slots(nSlots);
+    auto group = make_shared<TaskGroup>(nSlots);
+    vector<vector<double>> gaussVecs(nSlots);
+    vector<Scenario<double>> paths(nSlots);
+    for (auto& vec : gaussVecs) vec.resize(cMdl->simDim());
+    for (auto& path : paths)
+    {
+        allocatePath(prd.defline(), path);
+        initializePath(path);
+    }
+
+    vector<unique_ptr<RNG>> rngs(nSlots);
+    for (auto& random : rngs)
+    {
+        random = rng.clone();
+        random->init(cMdl->simDim());
+    }
+
+    vector<ForwardStatsAccumulator> stats(nSlots,
+        ForwardStatsAccumulator(prd.timeline().size(), prd.numAssets()));
+
+    vector<TaskHandle> futures;
+    futures.reserve(nPath / BATCHSIZE + 1);
+
+    size_t firstPath = 0;
+    size_t pathsLeft = nPath;
+    while (pathsLeft > 0)
+    {
+        size_t pathsInTask = min<size_t>(pathsLeft, BATCHSIZE);
+
+        futures.push_back(pool->spawnTask([&, firstPath, pathsInTask]()
+        {
+            const auto slot = slots.lease();
+            vector<double>& gaussVec = gaussVecs[slot];
+            Scenario<double>& path = paths[slot];
+
+            auto& random = rngs[slot];
+            random->skipTo(firstPath);
+
+            for (size_t i = 0; i < pathsInTask; i++)
+            {
+                random->nextG(gaussVec);
+                cMdl->generatePath(gaussVec, path);
+                stats[slot].add(path);
+            }
+
+            return true;
+        }, TaskPriority::foreground, group));
+
+        pathsLeft -= pathsInTask;
+        firstPath += pathsInTask;
+    }
+
+    for (auto& future : futures) pool->activeWait(future);
+
+    for (size_t i = 1; i < stats.size(); ++i) stats[0].merge(stats[i]);
+    stats[0].flush();
+
+    StatsSimulResults results;
+    stats[0].pack(results);
+
+    return results;
+}
+
+//  AAD
+//  The risk of the means and covariances is computed with multi-dimensional adjoints,
+//      one adjoint per mean and per second moment E[x_a x_b], a >= b,
+//      on every date, in the order of the payoffs of MultiStats
+//  The gradients of the second moments are seeded directly on the forwards:
+//      d(x_a x_b) = x_b dx_a + x_a dx_b
+//      so the products are never recorded on tape
+//  Sensitivities of covariances are recovered after propagation from
+//      cov = n / (n - 1) * (E[x_a x_b] - E[x_a] E[x_b])
+
+//  Number of adjoints for nAssets on nTimes dates
+inline size_t statsNumAdjoints(const size_t nTimes, const size_t nAssets)
+{
+    const size_t nBlocks = nTimes + (nTimes > 1 ? nTimes - 1 : 0);
+    return nBlocks * (nAssets + nAssets * (nAssets + 1) / 2);
+}
+
+//  Seed the adjoints of the forwards of one path
+inline void seedStatsAdjoints(Scenario<Number>& path, const size_t nAssets)
+{
+    const size_t nTimes = path.size();
+    size_t k = 0;
+
+    //  Levels
+    for (size_t t = 0; t < nTimes; ++t)
+    {
+        auto& fwds = path[t].forwards;
+
+        for (size_t a = 0; a < nAssets; ++a)
+        {
+            fwds[a].front().adjoint(k++) += 1.0;
+        }
+
+        for (size_t a1 = 0; a1 < nAssets; ++a1) for (size_t a2 = 0; a2 <= a1; ++a2)
+        {
+            const double x1 = fwds[a1].front().value(), x2 = fwds[a2].front().value();
+            fwds[a1].front().adjoint(k) += x2;
+            fwds[a2].front().adjoint(k) += x1;
+            ++k;
+        }
+    }
+
+    //  Increments
+    for (size_t t2 = 1; t2 < nTimes; ++t2)
+    {
+        const size_t t1 = t2 - 1;
+        auto& fwds1 = path[t1].forwards;
+        auto& fwds2 = path[t2].forwards;
+
+        for (size_t a = 0; a < nAssets; ++a)
+        {
+            fwds2[a].front().adjoint(k) += 1.0;
+            fwds1[a].front().adjoint(k) -= 1.0;
+            ++k;
+        }
+
+        for (size_t a1 = 0; a1 < nAssets; ++a1) for (size_t a2 = 0; a2 <= a1; ++a2)
+        {
+            const double d1 = fwds2[a1].front().value() - fwds1[a1].front().value();
+            const double d2 = fwds2[a2].front().value() - fwds1[a2].front().value();
+            fwds2[a1].front().adjoint(k) += d2;
+            fwds1[a1].front().adjoint(k) -= d2;
+            fwds2[a2].front().adjoint(k) += d1;
+            fwds1[a2].front().adjoint(k) -= d1;
+            ++k;
+        }
+    }
+}
+
+//  Turn the derivatives of the raw moments, in the order of seedStatsAdjoints(),
+//      into derivatives of means and covariances
+//  dMoments is indexed by adjoint, already averaged over paths
+inline void packStatsRisks(
+    const vector<double>&   dMoments,
+    const size_t            nTimes,
+    const size_t            nAssets,
+    const size_t            nPath,
+    //  Values, for the product rule
+    const MomentStats&      levels,
+    const MomentStats&      increments,
+    MomentStats&            levelRisks,
+    MomentStats&            incrementRisks)
+{
+    const double scale = nPath > 1 ? double(nPath) / (nPath - 1) : 0.0;
+    size_t k = 0;
+
+    auto unpack = [&](const vector<double>& mean, vector<double>& dMean, matrix<double>& dCov)
+    {
+        dMean.resize(nAssets);
+        dCov.resize(nAssets, nAssets);
+        for (size_t a = 0; a < nAssets; ++a) dMean[a] = dMoments[k++];
+        for (size_t a1 = 0; a1 < nAssets; ++a1) for (size_t a2 = 0; a2 <= a1; ++a2)
+        {
+            dCov[a1][a2] = dCov[a2][a1] = scale *
+                (dMoments[k++] - dMean[a1] * mean[a2] - mean[a1] * dMean[a2]);
+        }
+    };
+
+    levelRisks.means.resize(nTimes);
+    levelRisks.covs.resize(nTimes);
+    for (size_t t = 0; t < nTimes; ++t)
+    {
+        unpack(levels.means[t], levelRisks.means[t], levelRisks.covs[t]);
+    }
+
+    const size_t nIncs = nTimes > 1 ? nTimes - 1 : 0;
+    incrementRisks.means.resize(nIncs);
+    incrementRisks.covs.resize(nIncs);
+    for (size_t t = 0; t < nIncs; ++t)
+    {
+        unpack(increments.means[t], incrementRisks.means[t], incrementRisks.covs[t]);
+    }
+}
+
+//  Serial
+
+inline StatsSimulResults mcSimulStatsAAD(
+    const Product<Number>&  prd,
+    const Model<Number>&    mdl,
+    const RNG&              rng,
+    const size_t            nPath)
+{
+    if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
+    checkStatsDefline(prd);
+
+    auto cMdl = mdl.clone();
+    auto cRng = rng.clone();
+
+    Scenario<Number> path;
+    allocatePath(prd.defline(), path);
+    cMdl->allocate(prd.timeline(), prd.defline());
+
+    const size_t nTimes = prd.timeline().size();
+    const size_t nAssets = prd.numAssets();
+    const size_t nAdj = statsNumAdjoints(nTimes, nAssets);
+    const vector<Number*>& params = cMdl->parameters();
+    const size_t nParam = params.size();
+
+    Tape& tape = *Number::tape;
+    tape.clear();
+
+    auto resetter = setNumResultsForAAD(true, nAdj);
+
+    cMdl->putParametersOnTape();
+    cMdl->init(prd.timeline(), prd.defline());
+    initializePath(path);
+    tape.mark();
+
+    cRng->init(cMdl->simDim());
+    vector<double> gaussVec(cMdl->simDim());
+
+    ForwardStatsAccumulator stats(nTimes, nAssets);
+
+    for (size_t i = 0; i < nPath; i++)
+    {
+        tape.rewindToMark();
+
+        cRng->nextG(gaussVec);
+        cMdl->generatePath(gaussVec, path);
+
+        stats.add(path);
+
+        seedStatsAdjoints(path, nAssets);
+        Number::propagateAdjointsMulti(prev(tape.end()), tape.markIt());
+    }
+
+    Number::propagateAdjointsMulti(tape.markIt(), tape.begin());
+
+    stats.flush();
+    StatsSimulResults results;
+    stats.pack(results);
+
+    results.levelRisks.resize(nParam);
+    results.incrementRisks.resize(nParam);
+    vector<double> dMoments(nAdj);
+    for (size_t j = 0; j < nParam; ++j)
+    {
+        for (size_t k = 0; k < nAdj; ++k) dMoments[k] = params[j]->adjoint(k) / nPath;
+        packStatsRisks(dMoments, nTimes, nAssets, nPath, results.levels, results.increments,
+            results.levelRisks[j], results.incrementRisks[j]);
+    }
+
+    tape.clear();
+
+    return results;
+}
+
+//  Parallel
+
+inline StatsSimulResults mcParallelSimulStatsAAD(
+    const Product<Number>&  prd,
+    const Model<Number>&    mdl,
+    const RNG&              rng,
+    const size_t            nPath,
+    //  Cap on the threads working on the simulation, 0: the whole pool
+    const size_t            maxThreads = 0)
+{
+    if (!checkCompatiblity(prd, mdl)) throw runtime_error("Model and product are not compatible");
+    checkStatsDefline(prd);
+
+    const size_t nTimes = prd.timeline().size();
+    const size_t nAssets = prd.numAssets();
+    const size_t nAdj = statsNumAdjoints(nTimes, nAssets);
+    const size_t nParam = mdl.numParams();
+
+    Number::tape->clear();
+    auto resetter = setNumResultsForAAD(true, nAdj);
+
+    //  Float emulation of this calculation, carried into the tasks, see AAD.h
+    const bool emulateFloatDers = Tape::emulateFloatDers;
+
+    ThreadPool *pool = ThreadPool::getInstance();
+    const size_t nSlots = pool->concurrency(maxThreads);
+    WorkspaceSlots slots(nSlots);
+    auto group = make_shared<TaskGroup>(nSlots);
+
+    auto cMdl = mdl.clone();
+    cMdl->allocate(prd.timeline(), prd.defline());
+
+    vector<Scenario<Number>> paths(nSlots);
+    for (auto& path : paths)
+    {
+        allocatePath(prd.defline(), path);
+    }
+
+    Tape* mainTape = Number::tape;
+    vector<Tape> tapes(nSlots - 1);
+
+    //  Once, shared by the other tapes, see mcBase.h
+    const auto region = initSharedModel4ParallelAAD(prd, *cMdl, paths, nullptr, tapes);
+
+    vector<unique_ptr<RNG>> rngs(nSlots);
+    for (auto& random : rngs)
+    {
+        random = rng.clone();
+        random->init(cMdl->simDim());
+    }
+
+    vector<vector<double>> gaussVecs
+    (nSlots, vector<double>(cMdl->simDim()));
+
+    vector<ForwardStatsAccumulator> stats(nSlots,
+        ForwardStatsAccumulator(nTimes, nAssets));
+
+    vector<TaskHandle> futures;
+    futures.reserve(nPath / BATCHSIZE + 1);
+
+    size_t firstPath = 0;
+    size_t pathsLeft = nPath;
+    while (pathsLeft > 0)
+    {
+        size_t pathsInTask = min<size_t>(pathsLeft, BATCHSIZE);
+
+        futures.push_back(pool->spawnTask([&, firstPath, pathsInTask]()
+        {
+            const auto lease = slots.lease();
+            const size_t slot = lease;
+
+            TapeSwitch tapeSwitch(slot ? &tapes[slot - 1] : mainTape);
+
+            //  Multi-dimensional context on this thread, see AAD.h
+            auto taskResetter = setNumResultsForAAD(true, nAdj);
+            floatDersEmulation emulation(emulateFloatDers);
+
+            auto& random = rngs[slot];
+            random->skipTo(firstPath);
+
+            for (size_t i = 0; i < pathsInTask; i++)
+            {
+                Number::tape->rewindToMark();
+                random->nextG(gaussVecs[slot]);
+                cMdl->generatePath(
+                    gaussVecs[slot],
+                    paths[slot]);
+
+                stats[slot].add(paths[slot]);
+
+                seedStatsAdjoints(paths[slot], nAssets);
+                Number::propagateAdjointsMulti(prev(Number::tape->end()), Number::tape->markIt());
+            }
+
+            return true;
+        }, TaskPriority::foreground, group));
+
+        pathsLeft -= pathsInTask;
+        firstPath += pathsInTask;
+    }
+
+    for (auto& future : futures) pool->activeWait(future);
+
+    for (const auto& tape : tapes) tape.mergeShared();
+    Number::propagateAdjointsMulti(Number::tape->markIt(), Number::tape->begin());
+
+    for (size_t i = 1; i < stats.size(); ++i) stats[0].merge(stats[i]);
+    stats[0].flush();
+
+    StatsSimulResults results;
+    stats[0].pack(results);
+
+    results.levelRisks.resize(nParam);
+    results.incrementRisks.resize(nParam);
+    vector<double> dMoments(nAdj);
+    for (size_t j = 0; j < nParam; ++j)
+    {
+        for (size_t k = 0; k < nAdj; ++k)
+        {
+            dMoments[k] = cMdl->parameters()[j]->adjoint(k) / nPath;
+        }
+        packStatsRisks(dMoments, nTimes, nAssets, nPath, results.levels, results.increments,
+            results.levelRisks[j], results.incrementRisks[j]);
+    }
+
+    Number::tape->clear();
+
+    return results;
+}
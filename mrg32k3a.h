@@ -22,11 +22,29 @@ As long as this comment is preserved at the top of the file
 #include "mcBase.h"
 #include "gaussians.h"
 
+//	Transformation of the uniform numbers into Gaussians
+//	Both consume exactly one number per Gaussian, so skip ahead is unaffected
+enum class GaussianTransform
+{
+	//	Inverse CDF, the default, required for stratification, see stratified.h
+	InverseCdf,
+	//	Ziggurat, see gaussians.h, faster, for pseudo-random simulations
+	Ziggurat
+};
+
 class mrg32k3a : public RNG
 {
+	//	Substreams of stratified generators, see stratified.h
+	friend class Stratified;
 
 	//	Seed
 	const double	myA, myB;
+
+	//	Gaussian transform
+	const GaussianTransform	myTransform;
+
+	//	Start of the sequence: the seed, or the start of a substream
+	double			myStartX[3], myStartY[3];
 	
 	//  Dimension
     size_t			myDim;
@@ -51,8 +69,8 @@ class mrg32k3a : public RNG
 	//		by m1 + 1 so we never hit 1
 	static constexpr  double	m1p1 = 4294967088;
 
-    //  Produce next number and update state
-    double nextNumber()
+    //  Produce next integer in [1, m1) and update state
+    double nextInteger()
     {
         //  Update X
 		//	Recursion
@@ -73,28 +91,47 @@ class mrg32k3a : public RNG
 		myYn1 = myYn;
 		myYn = y;
 
-        //  Uniform 
-        const double u = x > y 
-			? (x - y) / m1p1 
-			: (x - y + m1) / m1p1;
-        return u;
+        return x > y ? x - y : x - y + m1;
+    }
+
+    //  Produce next uniform
+    double nextNumber()
+    {
+        return nextInteger() / m1p1;
+    }
+
+    //  Produce next Gaussian
+    double nextGaussian()
+    {
+        return myTransform == GaussianTransform::Ziggurat
+            ? Ziggurat::normal(uint32_t(nextInteger()))
+            : invNormalCdf(nextNumber());
     }
 
 public:
 
     //  Constructor with seed
-    mrg32k3a(const unsigned a = 12345, const unsigned b = 12346) :
-        myA(a), myB(b)
+    mrg32k3a(
+		const unsigned				a = 12345, 
+		const unsigned				b = 12346,
+		const GaussianTransform		transform = GaussianTransform::InverseCdf) :
+        myA(a), myB(b), myTransform(transform),
+		myStartX{ double(a), double(a), double(a) }, 
+		myStartY{ double(b), double(b), double(b) }
     {
         reset();
     }
 
-	//	Reset state to 0 (seed)
+	//	Reset state to 0 (seed or start of the substream)
     void reset()
     {
 		//	Reset state
-        myXn = myXn1 = myXn2 = myA;
-        myYn = myYn1 = myYn2 = myB;
+        myXn = myStartX[0];
+		myXn1 = myStartX[1];
+		myXn2 = myStartX[2];
+        myYn = myStartY[0];
+		myYn1 = myStartY[1];
+		myYn2 = myStartY[2];
 		
 		//	Anti = false: generate next
 		myAnti = false;
@@ -106,6 +143,17 @@ public:
         return make_unique<mrg32k3a>(*this);
     }
 
+	//	Substreams are 2^76 numbers apart, as in L'Ecuyer's RngStreams,
+	//		substream k starts k * 2^76 numbers after the start of this sequence
+	//	Distinct keys don't overlap as long as each substream 
+	//		consumes less than 2^76 numbers, the period is about 2^191
+	unique_ptr<RNG> substream(const uint64_t key) const override
+	{
+		auto stream = make_unique<mrg32k3a>(*this);
+		stream->jumpSubstreams(key);
+		return stream;
+	}
+
     //  Initializer 
     void init(const size_t simDim) override      
     {
@@ -170,7 +218,7 @@ public:
 			generate(
 				myCachedGaussians.begin(),
 				myCachedGaussians.end(),
-				[this]() { return invNormalCdf(nextNumber()); });
+				[this]() { return nextGaussian(); });
 
 			//	Copy
 			copy(
@@ -229,7 +277,7 @@ public:
 			generate(
 				myCachedGaussians.begin(),
 				myCachedGaussians.end(),
-				[this]() { return invNormalCdf(nextNumber()); });
+				[this]() { return nextGaussian(); });
 		}
 		else
 		{
@@ -303,15 +351,95 @@ private:
 		}
 	}
 
+	//	Matrix power with modulus, by squaring
+	static void mPow(
+		const unsigned long long	base[3][3],
+		uint64_t					exponent,
+		const unsigned long long	mod,
+		unsigned long long			result[3][3])
+	{
+		unsigned long long power[3][3], temp[3][3] = {
+			{ 1, 0 ,0 },
+			{ 0, 1, 0 },
+			{ 0, 0, 1 }
+		};
+		for (size_t j = 0; j < 3; j++) for (size_t k = 0; k < 3; k++) power[j][k] = base[j][k];
+
+		while (exponent > 0)
+		{
+			if (exponent & 1) mPrd(temp, power, mod, temp);
+			mPrd(power, power, mod, power);
+			exponent >>= 1;
+		}
+
+		for (size_t j = 0; j < 3; j++) for (size_t k = 0; k < 3; k++) result[j][k] = temp[j][k];
+	}
+
+	//	Move the start of the sequence key * 2^76 numbers ahead
+	void jumpSubstreams(const uint64_t key)
+	{
+		static constexpr unsigned long long
+			m1l = (unsigned long long)(m1);
+		static constexpr unsigned long long
+			m2l = (unsigned long long)(m2);
+
+		//	Transition matrices, as in skipNumbers()
+		unsigned long long A[3][3] = {
+			{ 0, (unsigned long long)(a12), (unsigned long long)(m1 - a13) },
+			{ 1, 0, 0 },
+			{ 0, 1, 0 }
+		},
+			B[3][3] = {
+			{ (unsigned long long)(a21), 0, (unsigned long long)(m2 - a23) },
+			{ 1, 0, 0 },
+			{ 0, 1, 0 }
+		};
+
+		//	A^(2^76), then to the power key
+		for (int i = 0; i < 76; ++i)
+		{
+			mPrd(A, A, m1l, A);
+			mPrd(B, B, m2l, B);
+		}
+		mPow(A, key, m1l, A);
+		mPow(B, key, m2l, B);
+
+		unsigned long long X0[3] =
+		{
+			(unsigned long long)(myStartX[0]),
+			(unsigned long long)(myStartX[1]),
+			(unsigned long long)(myStartX[2])
+		},
+			Y0[3] =
+		{
+			(unsigned long long)(myStartY[0]),
+			(unsigned long long)(myStartY[1]),
+			(unsigned long long)(myStartY[2])
+		},
+			temp[3];
+
+		vPrd(A, X0, m1l, temp);
+		myStartX[0] = double(temp[0]);
+		myStartX[1] = double(temp[1]);
+		myStartX[2] = double(temp[2]);
+
+		vPrd(B, Y0, m2l, temp);
+		myStartY[0] = double(temp[0]);
+		myStartY[1] = double(temp[1]);
+		myStartY[2] = double(temp[2]);
+
+		reset();
+	}
+
 	void skipNumbers(const unsigned b) 
     {
         if ( b <= 0) return;
         unsigned skip = b;
 
 		static constexpr unsigned long long
-			m1l = unsigned long long(m1);
+			m1l = (unsigned long long)(m1);
 		static constexpr unsigned long long
-			m2l = unsigned long long(m2);
+			m2l = (unsigned long long)(m2);
 
 		unsigned long long Ab[3][3] = {
             { 1, 0 ,0 },        
@@ -326,8 +454,8 @@ private:
             Ai[3][3] = {        //  A0 = A
                 { 
 					0, 
-					unsigned long long (a12) , 
-					unsigned long long (m1 - a13) 
+					(unsigned long long)(a12) , 
+					(unsigned long long)(m1 - a13) 
 					//	m1 - a13 instead of -a13
 					//	so results are always positive
 					//	and we can use unsigned long longs
@@ -338,9 +466,9 @@ private:
         },
             Bi[3][3] = {        //  B0 = B
                 { 
-					unsigned long long (a21), 
+					(unsigned long long)(a21), 
 					0 , 
-					unsigned long long (m2 - a23) 
+					(unsigned long long)(m2 - a23) 
 					//	same logic: m2 - a32
 				},
                 { 1, 0, 0 },
@@ -366,15 +494,15 @@ private:
         //  Final result
 		unsigned long long X0[3] =
         {
-			unsigned long long (myXn),
-			unsigned long long (myXn1),
-			unsigned long long (myXn2)
+			(unsigned long long)(myXn),
+			(unsigned long long)(myXn1),
+			(unsigned long long)(myXn2)
         },
             Y0[3] =
         {
-			unsigned long long (myYn),
-			unsigned long long (myYn1),
-			unsigned long long (myYn2)
+			(unsigned long long)(myYn),
+			(unsigned long long)(myYn1),
+			(unsigned long long)(myYn2)
         },
             temp[3];
         
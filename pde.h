@@ -0,0 +1,690 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Finite difference pricer for single asset products
+//      (European, UOC, Europeans) in BlackScholes or Dupire
+
+//  Crank-Nicolson scheme in log spot on a uniform grid centred on today's spot,
+//      with Rannacher smoothing: the first steps after every event date
+//      are replaced by fully implicit half steps
+//  The model is seen as a local vol grid, interpolated like in Dupire's simulations:
+//      linearly in log spot and time, flat outside,
+//      BlackScholes is a grid with a single node
+//  All the payoffs of the product are solved together, one column per payoff,
+//      so the tridiagonal solver sweeps over rows of payoffs and vectorises
+
+//  Sensitivities to all model parameters are computed with the adjoint of the scheme,
+//      coded by hand: the adjoint runs the steps in reverse order,
+//      with one adjoint column per payoff, and does not use the tape
+//  The grid is held fixed in the differentiation, 
+//      although its width depends on the vol at today's spot
+//  Delta is the derivative in spot of the solution on today's node
+
+#include "mcMdl.h"
+#include "mcPrd.h"
+
+struct PdeParam
+{
+    //  Number of nodes in space, rounded up to an odd number, today's spot in the middle
+    size_t      numX = 201;
+    //  Number of time steps per year
+    size_t      numT = 100;
+    //  Half width of the grid in standard deviations to the last date
+    double      numStd = 5.0;
+    //  Number of Crank-Nicolson steps after event dates
+    //      replaced by 2 fully implicit half steps each
+    size_t      rannacher = 2;
+};
+
+//  Values and risks of all the payoffs
+//  Risks: parameters in rows, payoffs in columns
+struct PdeResults
+{
+    vector<string>  payoffs;
+    vector<string>  params;
+    vector<double>  values;
+    matrix<double>  risks;
+};
+
+//  Solves the tridiagonal systems a[k] x[k-1] + b[k] x[k] + c[k] x[k+1] = r[k]
+//      for all the columns of r at once, r is overwritten with the solution x
+//  a[0] and c[n-1] are not used
+//  The elimination is the same for all the columns, so it is computed once,
+//      and the sweeps run over contiguous rows
+inline void tridag(
+    const vector<double>&   a,
+    const vector<double>&   b,
+    const vector<double>&   c,
+    matrix<double>&         r,
+    //  Workspace, size n
+    vector<double>&         gam,
+    vector<double>&         ibet)
+{
+    const size_t n = r.rows(), m = r.cols();
+
+    //  Elimination
+    ibet[0] = 1.0 / b[0];
+    for (size_t k = 1; k < n; ++k)
+    {
+        gam[k] = c[k - 1] * ibet[k - 1];
+        ibet[k] = 1.0 / (b[k] - a[k] * gam[k]);
+    }
+
+    //  Forward sweep
+    {
+        double* x = r[0];
+        const double ib = ibet[0];
+        for (size_t p = 0; p < m; ++p) x[p] *= ib;
+    }
+    for (size_t k = 1; k < n; ++k)
+    {
+        double* x = r[k];
+        const double* xp = r[k - 1];
+        const double ak = a[k], ib = ibet[k];
+        for (size_t p = 0; p < m; ++p) x[p] = (x[p] - ak * xp[p]) * ib;
+    }
+
+    //  Back substitution
+    for (size_t k = n - 1; k > 0; --k)
+    {
+        double* x = r[k - 1];
+        const double* xn = r[k];
+        const double g = gam[k];
+        for (size_t p = 0; p < m; ++p) x[p] -= g * xn[p];
+    }
+}
+
+class Pde1D
+{
+    //  Model
+
+    double                  mySpot;
+    double                  myRate = 0.0;
+    double                  myDiv = 0.0;
+    //  Local vol grid, spot major
+    vector<double>          myLogSpots;
+    vector<Time>            myTimes;
+    matrix<double>          myVols;
+    //  Dupire: parameters are spot then local vols,
+    //      BlackScholes: spot, vol, rate, div
+    bool                    myDupire;
+    vector<string>          myParamLabels;
+
+    //  Product
+
+    //  One payoff per column
+    struct Payoff
+    {
+        Time    maturity;
+        double  strike;
+        bool    put;
+        //  Time from exercise to settlement
+        Time    lag;
+    };
+    vector<Payoff>          myPayoffs;
+    vector<string>          myPayoffLabels;
+
+    //  Smooth knock-out applied to one column on monitoring dates, see UOC
+    struct KnockOut
+    {
+        size_t          column;
+        double          barrier;
+        double          smooth;
+        vector<Time>    dates;
+    };
+    vector<KnockOut>        myKnockOuts;
+
+    //  Grid
+
+    size_t                  myM;
+    //  Today's node
+    size_t                  myC;
+    double                  myH;
+    vector<double>          myX;
+    //  Interpolation of local vols in spot on the nodes
+    vector<size_t>          mySpotIdx;
+    vector<double>          mySpotW;
+
+    //  Time nodes, step s goes backwards from node s + 1 to node s
+    vector<Time>            myTimeline;
+    //  1 = implicit, 0.5 = Crank-Nicolson
+    vector<double>          myTheta;
+    //  Payoffs set and knock-outs applied on every time node
+    vector<vector<size_t>>  myPayoffEvents;
+    vector<vector<size_t>>  myKnockOutEvents;
+
+    //  Solutions at the start and the end of every step, for the adjoint
+    vector<matrix<double>>  myIn;
+    vector<matrix<double>>  myOut;
+
+    //  Workspace
+    vector<double>          myL, myD, myU, myA, myB, myCc, myGam, myIbet;
+
+    //  Index of a time on the timeline
+    size_t timeIdx(const Time t) const
+    {
+        auto it = lower_bound(myTimeline.begin(), myTimeline.end(), t - ONE_HOUR);
+        return distance(myTimeline.begin(), it);
+    }
+
+    //  Terminal payoff of a column on a node
+    double payoff(const Payoff& pay, const double x) const
+    {
+        const double fwd = exp(x + (myRate - myDiv) * pay.lag);
+        const double intrinsic = pay.put ? pay.strike - fwd : fwd - pay.strike;
+        return max(intrinsic, 0.0) * exp(-myRate * pay.lag);
+    }
+
+    //  Smooth survival factor, same as UOC
+    static double survival(const KnockOut& ko, const double spot)
+    {
+        if (spot > ko.barrier + ko.smooth) return 0.0;
+        if (spot > ko.barrier - ko.smooth) return (ko.barrier + ko.smooth - spot) / (2 * ko.smooth);
+        return 1.0;
+    }
+
+    //  Local vol in the middle of step s on every node
+    //      and interpolation weights in time
+    void stepVols(const size_t s, vector<double>& vols, size_t& j0, size_t& j1, double& wt) const
+    {
+        const Time t = 0.5 * (myTimeline[s] + myTimeline[s + 1]);
+        const size_t nt = myTimes.size();
+        const size_t k = upper_bound(myTimes.begin(), myTimes.end(), t) - myTimes.begin();
+        if (k == 0)
+        {
+            j0 = j1 = 0;
+            wt = 0.0;
+        }
+        else if (k == nt)
+        {
+            j0 = j1 = nt - 1;
+            wt = 0.0;
+        }
+        else
+        {
+            j0 = k - 1;
+            j1 = k;
+            wt = (t - myTimes[j0]) / (myTimes[j1] - myTimes[j0]);
+        }
+
+        for (size_t i = 0; i < myM; ++i)
+        {
+            const size_t i0 = mySpotIdx[i], i1 = min(i0 + 1, myLogSpots.size() - 1);
+            const double w = mySpotW[i];
+            const double v0 = myVols[i0][j0] + wt * (myVols[i0][j1] - myVols[i0][j0]);
+            const double v1 = myVols[i1][j0] + wt * (myVols[i1][j1] - myVols[i1][j0]);
+            vols[i] = v0 + w * (v1 - v0);
+        }
+    }
+
+    //  Operator L = l V[i-1] + d V[i] + u V[i+1] on step s
+    //  Interior: drift and diffusion in log spot, discounting
+    //  Boundaries: V is linear in spot, so the diffusion is drift - r + d
+    //      and the first derivative is taken one-sided
+    void coefficients(const vector<double>& vols)
+    {
+        const double h = myH, h2 = h * h, mu = myRate - myDiv;
+        for (size_t i = 1; i + 1 < myM; ++i)
+        {
+            const double var = vols[i] * vols[i];
+            const double drift = mu - 0.5 * var;
+            myL[i] = 0.5 * var / h2 - 0.5 * drift / h;
+            myD[i] = -var / h2 - myRate;
+            myU[i] = 0.5 * var / h2 + 0.5 * drift / h;
+        }
+        myL[0] = 0.0;
+        myD[0] = -mu / h - myRate;
+        myU[0] = mu / h;
+        myL[myM - 1] = -mu / h;
+        myD[myM - 1] = mu / h - myRate;
+        myU[myM - 1] = 0.0;
+    }
+
+    //  Events on a time node: set payoffs then apply knock-outs
+    void applyEvents(const size_t n, matrix<double>& V) const
+    {
+        for (const size_t p : myPayoffEvents[n])
+        {
+            for (size_t i = 0; i < myM; ++i) V[i][p] = payoff(myPayoffs[p], myX[i]);
+        }
+        for (const size_t ko : myKnockOutEvents[n])
+        {
+            const KnockOut& knockOut = myKnockOuts[ko];
+            for (size_t i = 0; i < myM; ++i) V[i][knockOut.column] *= survival(knockOut, exp(myX[i]));
+        }
+    }
+
+    //  Adjoint of the events, in reverse order
+    //  Accumulates sensitivities of payoffs to rate and dividend
+    void adjointEvents(
+        const size_t            n,
+        matrix<double>&         bar,
+        vector<double>&         rateAdj,
+        vector<double>&         divAdj) const
+    {
+        for (const size_t ko : myKnockOutEvents[n])
+        {
+            const KnockOut& knockOut = myKnockOuts[ko];
+            for (size_t i = 0; i < myM; ++i) bar[i][knockOut.column] *= survival(knockOut, exp(myX[i]));
+        }
+        for (const size_t p : myPayoffEvents[n])
+        {
+            const Payoff& pay = myPayoffs[p];
+            for (size_t i = 0; i < myM; ++i)
+            {
+                if (pay.lag > 0.0)
+                {
+                    const double df = exp(-myRate * pay.lag);
+                    const double fwd = exp(myX[i] + (myRate - myDiv) * pay.lag);
+                    const bool itm = pay.put ? fwd < pay.strike : fwd > pay.strike;
+                    const double dFwd = itm ? (pay.put ? -df * fwd * pay.lag : df * fwd * pay.lag) : 0.0;
+                    rateAdj[p] += bar[i][p] * (dFwd - pay.lag * payoff(pay, myX[i]));
+                    divAdj[p] -= bar[i][p] * dFwd;
+                }
+                //  Overwritten
+                bar[i][p] = 0.0;
+            }
+        }
+    }
+
+public:
+
+    Pde1D(
+        const Model<double>&    model,
+        const Product<double>&  product,
+        const PdeParam&         param)
+    {
+        //  Model
+
+        if (auto* dupire = dynamic_cast<const Dupire<double>*>(&model))
+        {
+            myDupire = true;
+            mySpot = dupire->spot();
+            myLogSpots.resize(dupire->spots().size());
+            transform(dupire->spots().begin(), dupire->spots().end(), myLogSpots.begin(),
+                [](const double s) { return log(s); });
+            myTimes = dupire->times();
+            myVols = dupire->vols();
+        }
+        else if (auto* bs = dynamic_cast<const BlackScholes<double>*>(&model))
+        {
+            myDupire = false;
+            mySpot = bs->spot();
+            myRate = bs->rate();
+            myDiv = bs->div();
+            myLogSpots.assign(1, log(mySpot));
+            myTimes.assign(1, systemTime);
+            myVols.resize(1, 1);
+            myVols[0][0] = bs->vol();
+        }
+        else
+        {
+            throw runtime_error("Pde1D : model must be BlackScholes or Dupire");
+        }
+        myParamLabels = model.parameterLabels();
+
+        //  Product
+
+        if (auto* euro = dynamic_cast<const European<double>*>(&product))
+        {
+            myPayoffs.push_back({ euro->exerciseDate(), euro->strike(), false,
+                euro->settlementDate() - euro->exerciseDate() });
+        }
+        else if (auto* uoc = dynamic_cast<const UOC<double>*>(&product))
+        {
+            const Payoff vanilla = { uoc->maturity(), uoc->strike(), uoc->callPut(), 0.0 };
+            myPayoffs.push_back(vanilla);
+            myPayoffs.push_back(vanilla);
+            myKnockOuts.push_back({ 0, uoc->barrier(), mySpot * uoc->smooth(), uoc->timeline() });
+        }
+        else if (auto* euros = dynamic_cast<const Europeans<double>*>(&product))
+        {
+            for (size_t i = 0; i < euros->maturities().size(); ++i)
+            {
+                for (const double strike : euros->strikes()[i])
+                {
+                    myPayoffs.push_back({ euros->maturities()[i], strike, false, 0.0 });
+                }
+            }
+        }
+        else
+        {
+            throw runtime_error("Pde1D : product must be European, UOC or Europeans");
+        }
+        myPayoffLabels = product.payoffLabels();
+
+        //  Event dates
+
+        vector<Time> events(1, systemTime);
+        for (const Payoff& pay : myPayoffs) events.push_back(pay.maturity);
+        for (const KnockOut& ko : myKnockOuts) events.insert(events.end(), ko.dates.begin(), ko.dates.end());
+        sort(events.begin(), events.end());
+        events.erase(unique(events.begin(), events.end(),
+            [](const Time t1, const Time t2) { return t2 - t1 < ONE_HOUR; }), events.end());
+        if (events.front() < systemTime - ONE_HOUR || events.back() < systemTime + ONE_HOUR)
+        {
+            throw runtime_error("Pde1D : event dates must be in the future");
+        }
+
+        //  Time steps, uniform between events,
+        //      the last steps before each event (the first ones solved) are implicit half steps
+
+        myTimeline.assign(1, events.front());
+        for (size_t e = 1; e < events.size(); ++e)
+        {
+            const Time start = events[e - 1], end = events[e];
+            const size_t n = max<size_t>(1, size_t(ceil((end - start) * param.numT - EPS)));
+            const double dt = (end - start) / n;
+            const size_t implicit = min(param.rannacher, n);
+            for (size_t k = 1; k <= n; ++k)
+            {
+                const Time t = k == n ? end : start + k * dt;
+                if (k > n - implicit)
+                {
+                    myTimeline.push_back(t - 0.5 * dt);
+                    myTheta.push_back(1.0);
+                    myTheta.push_back(1.0);
+                }
+                else
+                {
+                    myTheta.push_back(0.5);
+                }
+                myTimeline.push_back(t);
+            }
+        }
+
+        const size_t N = myTimeline.size();
+        myPayoffEvents.resize(N);
+        myKnockOutEvents.resize(N);
+        for (size_t p = 0; p < myPayoffs.size(); ++p)
+        {
+            myPayoffEvents[timeIdx(myPayoffs[p].maturity)].push_back(p);
+        }
+        for (size_t ko = 0; ko < myKnockOuts.size(); ++ko)
+        {
+            for (const Time t : myKnockOuts[ko].dates)
+            {
+                if (t > systemTime - ONE_HOUR) myKnockOutEvents[timeIdx(t)].push_back(ko);
+            }
+        }
+
+        //  Space grid, the width is set by the largest local vol at today's spot
+
+        double volMax = 0.0;
+        for (size_t j = 0; j < myTimes.size(); ++j)
+        {
+            vector<double> col(myLogSpots.size());
+            for (size_t i = 0; i < col.size(); ++i) col[i] = myVols[i][j];
+            volMax = max(volMax, interp(myLogSpots.begin(), myLogSpots.end(), col.begin(), col.end(), log(mySpot)));
+        }
+        if (volMax < EPS)
+        {
+            throw runtime_error("Pde1D : zero volatility");
+        }
+
+        myM = param.numX | 1;
+        if (myM < 5)
+        {
+            throw runtime_error("Pde1D : not enough nodes");
+        }
+        myC = myM / 2;
+        myH = param.numStd * volMax * sqrt(myTimeline.back() - myTimeline.front()) / myC;
+        myX.resize(myM);
+        mySpotIdx.resize(myM);
+        mySpotW.resize(myM);
+        const double x0 = log(mySpot);
+        for (size_t i = 0; i < myM; ++i)
+        {
+            myX[i] = x0 + (double(i) - double(myC)) * myH;
+            if (i == myC) myX[i] = x0;
+
+            //  Interpolation in log spot, flat outside
+            auto it = upper_bound(myLogSpots.begin(), myLogSpots.end(), myX[i]);
+            if (it == myLogSpots.begin())
+            {
+                mySpotIdx[i] = 0;
+                mySpotW[i] = 0.0;
+            }
+            else if (it == myLogSpots.end())
+            {
+                mySpotIdx[i] = myLogSpots.size() - 1;
+                mySpotW[i] = 0.0;
+            }
+            else
+            {
+                const size_t i0 = distance(myLogSpots.begin(), it) - 1;
+                mySpotIdx[i] = i0;
+                mySpotW[i] = (myX[i] - myLogSpots[i0]) / (myLogSpots[i0 + 1] - myLogSpots[i0]);
+            }
+        }
+
+        //  Workspace
+        for (auto* v : { &myL, &myD, &myU, &myA, &myB, &myCc, &myGam, &myIbet }) v->resize(myM);
+    }
+
+    //  Solve, and compute risks with the adjoint if required
+    PdeResults solve(const bool risk = true)
+    {
+        const size_t N = myTimeline.size() - 1, P = myPayoffs.size();
+        vector<double> vols(myM);
+        size_t j0, j1;
+        double wt;
+
+        //  Backward induction
+
+        if (risk)
+        {
+            myIn.resize(N);
+            myOut.resize(N);
+        }
+
+        matrix<double> V(myM, P), R(myM, P);
+        for (size_t i = 0; i < myM; ++i) fill(V[i], V[i] + P, 0.0);
+        applyEvents(N, V);
+
+        for (size_t s = N; s-- > 0;)
+        {
+            const double dt = myTimeline[s + 1] - myTimeline[s], theta = myTheta[s];
+            stepVols(s, vols, j0, j1, wt);
+            coefficients(vols);
+
+            //  Explicit part: R = (I + (1 - theta) dt L) V
+            const double e = (1.0 - theta) * dt;
+            for (size_t i = 0; i < myM; ++i)
+            {
+                double* r = R[i];
+                const double* v = V[i];
+                const double* vp = i > 0 ? V[i - 1] : v;
+                const double* vn = i + 1 < myM ? V[i + 1] : v;
+                const double l = e * myL[i], d = 1.0 + e * myD[i], u = e * myU[i];
+                for (size_t p = 0; p < P; ++p) r[p] = l * vp[p] + d * v[p] + u * vn[p];
+            }
+
+            //  Implicit part: (I - theta dt L) V = R
+            const double m = theta * dt;
+            for (size_t i = 0; i < myM; ++i)
+            {
+                myA[i] = -m * myL[i];
+                myB[i] = 1.0 - m * myD[i];
+                myCc[i] = -m * myU[i];
+            }
+            tridag(myA, myB, myCc, R, myGam, myIbet);
+
+            if (risk)
+            {
+                myIn[s] = V;
+                myOut[s] = R;
+            }
+            V.swap(R);
+
+            applyEvents(s, V);
+        }
+
+        PdeResults results;
+        results.payoffs = myPayoffLabels;
+        results.params = myParamLabels;
+        results.values.assign(V[myC], V[myC] + P);
+        if (!risk) return results;
+
+        //  Delta: derivative in spot of the quadratic through today's node and its neighbours
+        results.risks.resize(myParamLabels.size(), P);
+        for (size_t p = 0; p < P; ++p)
+        {
+            results.risks[0][p] = (V[myC + 1][p] - V[myC - 1][p]) / (2 * myH) / mySpot;
+        }
+
+        //  Adjoint
+
+        const size_t nSpots = myLogSpots.size(), nTimes = myTimes.size();
+        matrix<double> volAdj(nSpots * nTimes, P), spotVolAdj(nSpots, P);
+        for (size_t i = 0; i < volAdj.rows(); ++i) fill(volAdj[i], volAdj[i] + P, 0.0);
+        vector<double> rateAdj(P, 0.0), divAdj(P, 0.0);
+
+        //  Seed: one adjoint column per payoff, on today's node
+        matrix<double> bar(myM, P), W(myM, P);
+        for (size_t i = 0; i < myM; ++i) fill(bar[i], bar[i] + P, i == myC ? 1.0 : 0.0);
+
+        const double h = myH, h2 = h * h;
+        const double al = 0.5 / h2 + 0.25 / h, ad = -1.0 / h2, au = 0.5 / h2 - 0.25 / h;
+
+        for (size_t s = 0; s < N; ++s)
+        {
+            adjointEvents(s, bar, rateAdj, divAdj);
+
+            const double dt = myTimeline[s + 1] - myTimeline[s], theta = myTheta[s];
+            stepVols(s, vols, j0, j1, wt);
+            coefficients(vols);
+
+            //  Transposed implicit solve
+            const double m = theta * dt;
+            for (size_t i = 0; i < myM; ++i)
+            {
+                myA[i] = i > 0 ? -m * myU[i - 1] : 0.0;
+                myB[i] = 1.0 - m * myD[i];
+                myCc[i] = i + 1 < myM ? -m * myL[i + 1] : 0.0;
+            }
+            tridag(myA, myB, myCc, bar, myGam, myIbet);
+            //  bar is now the adjoint of R
+
+            //  Adjoints of the coefficients: dt * bar(R) * W, W = theta V(out) + (1 - theta) V(in)
+            const matrix<double>& Vin = myIn[s];
+            const matrix<double>& Vout = myOut[s];
+            for (size_t i = 0; i < myM; ++i)
+            {
+                double* w = W[i];
+                const double* vi = Vin[i];
+                const double* vo = Vout[i];
+                for (size_t p = 0; p < P; ++p) w[p] = theta * vo[p] + (1.0 - theta) * vi[p];
+            }
+
+            for (size_t i = 0; i < nSpots; ++i) fill(spotVolAdj[i], spotVolAdj[i] + P, 0.0);
+
+            for (size_t i = 0; i < myM; ++i)
+            {
+                const double* b = bar[i];
+                const double* w = W[i];
+                const double* wp = i > 0 ? W[i - 1] : w;
+                const double* wn = i + 1 < myM ? W[i + 1] : w;
+
+                if (i == 0)
+                {
+                    for (size_t p = 0; p < P; ++p)
+                    {
+                        const double bd = dt * b[p] * w[p], bu = dt * b[p] * wn[p];
+                        rateAdj[p] += bd * (-1.0 / h - 1.0) + bu / h;
+                        divAdj[p] += bd / h - bu / h;
+                    }
+                }
+                else if (i + 1 == myM)
+                {
+                    for (size_t p = 0; p < P; ++p)
+                    {
+                        const double bl = dt * b[p] * wp[p], bd = dt * b[p] * w[p];
+                        rateAdj[p] += -bl / h + bd * (1.0 / h - 1.0);
+                        divAdj[p] += bl / h - bd / h;
+                    }
+                }
+                else
+                {
+                    //  Vol adjoint on the node, split on the spots of the local vol grid
+                    const size_t i0 = mySpotIdx[i], i1 = min(i0 + 1, nSpots - 1);
+                    const double w1 = mySpotW[i], w0 = 1.0 - w1;
+                    const double twoVol = 2.0 * vols[i];
+                    double* s0 = spotVolAdj[i0];
+                    double* s1 = spotVolAdj[i1];
+                    for (size_t p = 0; p < P; ++p)
+                    {
+                        const double bl = dt * b[p] * wp[p], bd = dt * b[p] * w[p], bu = dt * b[p] * wn[p];
+                        const double bVol = twoVol * (al * bl + ad * bd + au * bu);
+                        s0[p] += w0 * bVol;
+                        s1[p] += w1 * bVol;
+                        rateAdj[p] += 0.5 * (bu - bl) / h - bd;
+                        divAdj[p] += 0.5 * (bl - bu) / h;
+                    }
+                }
+            }
+
+            //  Split in time
+            for (size_t i = 0; i < nSpots; ++i)
+            {
+                double* a0 = volAdj[i * nTimes + j0];
+                double* a1 = volAdj[i * nTimes + j1];
+                const double* sa = spotVolAdj[i];
+                for (size_t p = 0; p < P; ++p)
+                {
+                    a0[p] += (1.0 - wt) * sa[p];
+                    a1[p] += wt * sa[p];
+                }
+            }
+
+            //  Explicit part: bar(V in) = (I + (1 - theta) dt L)^T bar(R)
+            const double e = (1.0 - theta) * dt;
+            for (size_t i = 0; i < myM; ++i)
+            {
+                double* w = W[i];
+                const double* b = bar[i];
+                const double* bp = i > 0 ? bar[i - 1] : b;
+                const double* bn = i + 1 < myM ? bar[i + 1] : b;
+                const double l = i + 1 < myM ? e * myL[i + 1] : 0.0;
+                const double d = 1.0 + e * myD[i];
+                const double u = i > 0 ? e * myU[i - 1] : 0.0;
+                for (size_t p = 0; p < P; ++p) w[p] = u * bp[p] + d * b[p] + l * bn[p];
+            }
+            bar.swap(W);
+        }
+        adjointEvents(N, bar, rateAdj, divAdj);
+
+        //  Results
+
+        if (myDupire)
+        {
+            for (size_t k = 0; k < volAdj.rows(); ++k)
+            {
+                copy(volAdj[k], volAdj[k] + P, results.risks[k + 1]);
+            }
+        }
+        else
+        {
+            copy(volAdj[0], volAdj[0] + P, results.risks[1]);
+            copy(rateAdj.begin(), rateAdj.end(), results.risks[2]);
+            copy(divAdj.begin(), divAdj.end(), results.risks[3]);
+        }
+
+        return results;
+    }
+};
@@ -0,0 +1,354 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Cache of the Gaussian points of Sobol's sequence
+//  Repeated simulations of the same dimension and number of paths,
+//      like Europeans or baskets under Black-Scholes in an intraday loop,
+//      regenerate the same Gaussians every time
+//  The cache keeps the points of a (dimension, number of paths, scrambling),
+//      generated once, and CachedSobol reads them in place of Sobol,
+//      with no skip ahead and no inverse CDF
+//  In memory, the points are shared by the threads of the process
+//  With a directory, they are also persisted in files, mapped read only,
+//      and shared by all the processes and runs that use the directory
+//  Results are identical to Sobol's
+
+#include "sobol.h"
+#include "mappedFile.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+//  Gaussian points, path by path
+class QmcPointSet
+{
+    size_t              myDim;
+    size_t              myCount;
+    const double*       myPoints;
+
+    //  In memory, or mapped from a file
+    vector<double>      myMemory;
+    mappedView          myFile;
+
+    //  File layout: header, then the points
+    struct Header
+    {
+        char            tag[8];
+        uint64_t        dim;
+        uint64_t        count;
+        uint64_t        scrambled;
+        uint64_t        key;
+    };
+    static constexpr size_t headerSize = 64;
+    static constexpr char tag[8] = { 'S', 'O', 'B', 'O', 'L', 'G', '0', '1' };
+
+    static Header header(const Sobol& sobol, const size_t dim, const size_t count)
+    {
+        Header h;
+        copy(tag, tag + 8, h.tag);
+        h.dim = dim;
+        h.count = count;
+        h.scrambled = sobol.scrambled();
+        h.key = sobol.scrambleKey();
+        return h;
+    }
+
+    static bool matches(const Header& lhs, const Header& rhs)
+    {
+        return equal(lhs.tag, lhs.tag + 8, rhs.tag) && lhs.dim == rhs.dim && lhs.count == rhs.count
+            && lhs.scrambled == rhs.scrambled && lhs.key == rhs.key;
+    }
+
+    //  The points of the sequence
+    void generate(const Sobol& sobol)
+    {
+        myMemory.resize(myDim * myCount);
+        Sobol gen(sobol);
+        gen.init(myDim);
+        vector<double> gaussVec(myDim);
+        for (size_t i = 0; i < myCount; ++i)
+        {
+            gen.nextG(gaussVec);
+            copy(gaussVec.begin(), gaussVec.end(), myMemory.begin() + i * myDim);
+        }
+        myPoints = myMemory.data();
+    }
+
+    //  Map the file if it holds these points
+    bool load(const string& path, const Header& h)
+    {
+        if (!myFile.open(path)) return false;
+        const size_t bytes = headerSize + myDim * myCount * sizeof(double);
+        if (myFile.size() != bytes || !matches(*static_cast<const Header*>(myFile.data()), h))
+        {
+            myFile.close();
+            return false;
+        }
+        myPoints = reinterpret_cast<const double*>(
+            static_cast<const char*>(myFile.data()) + headerSize);
+        return true;
+    }
+
+    //  Write to a temporary file, then rename,
+    //      so other processes never map a partial file
+    //  If another process renamed first, keep its file
+    void save(const string& path, const Header& h) const
+    {
+        ostringstream tmp;
+        tmp << path << '.' << this_thread::get_id() << ".tmp";
+        {
+            ofstream file(tmp.str(), ios::binary | ios::trunc);
+            if (!file) return;
+            char pad[headerSize] = {};
+            copy(reinterpret_cast<const char*>(&h), reinterpret_cast<const char*>(&h) + sizeof(h), pad);
+            file.write(pad, headerSize);
+            file.write(reinterpret_cast<const char*>(myMemory.data()), myMemory.size() * sizeof(double));
+            if (!file)
+            {
+                file.close();
+                remove(tmp.str().c_str());
+                return;
+            }
+        }
+        if (rename(tmp.str().c_str(), path.c_str()) != 0) remove(tmp.str().c_str());
+    }
+
+public:
+
+    //  Points of count paths of the sequence of sobol in dimension dim,
+    //      from the file in dir if any, generated otherwise (and saved in dir)
+    QmcPointSet(const Sobol& sobol, const size_t dim, const size_t count, const string& dir) :
+        myDim(dim), myCount(count), myPoints(nullptr)
+    {
+        if (dir.empty())
+        {
+            generate(sobol);
+            return;
+        }
+
+        ostringstream name;
+        name << dir << "/sobol_" << dim << "_" << count << "_"
+            << (sobol.scrambled() ? sobol.scrambleKey() : 0) << (sobol.scrambled() ? "s" : "") << ".qmc";
+        const Header h = header(sobol, dim, count);
+
+        if (load(name.str(), h)) return;
+
+        generate(sobol);
+        save(name.str(), h);
+
+        //  Read from the file, shared with other processes, if saved
+        if (load(name.str(), h))
+        {
+            vector<double>().swap(myMemory);
+        }
+        else
+        {
+            myPoints = myMemory.data();
+        }
+    }
+
+    QmcPointSet(const QmcPointSet&) = delete;
+    QmcPointSet& operator=(const QmcPointSet&) = delete;
+
+    size_t dim() const
+    {
+        return myDim;
+    }
+
+    size_t count() const
+    {
+        return myCount;
+    }
+
+    //  Gaussians of path i
+    const double* operator[](const size_t i) const
+    {
+        return myPoints + i * myDim;
+    }
+
+    bool mapped() const
+    {
+        return myFile.data() != nullptr;
+    }
+};
+
+//  The cache, one per process
+class QmcCache
+{
+    using Key = tuple<size_t, size_t, bool, uint64_t>;
+
+    //  Points are generated once, by the first thread to request them
+    struct Entry
+    {
+        once_flag                       init;
+        shared_ptr<const QmcPointSet>   points;
+    };
+
+    bool                                myEnabled = false;
+    string                              myDir;
+    map<Key, shared_ptr<Entry>>         myEntries;
+    mutex                               myMutex;
+
+    QmcCache() {}
+
+public:
+
+    static QmcCache& instance()
+    {
+        static QmcCache cache;
+        return cache;
+    }
+
+    //  Enable the cache, in memory, and in files in dir if not empty,
+    //      or disable it, clearing the points in memory
+    //  Simulations running keep their points until they finish
+    void set(const bool enabled, const string& dir = "")
+    {
+        lock_guard<mutex> lk(myMutex);
+        myEnabled = enabled;
+        myDir = dir;
+        myEntries.clear();
+    }
+
+    bool enabled()
+    {
+        lock_guard<mutex> lk(myMutex);
+        return myEnabled;
+    }
+
+    //  Points of count paths of the sequence of sobol in dimension dim
+    shared_ptr<const QmcPointSet> get(const Sobol& sobol, const size_t dim, const size_t count)
+    {
+        shared_ptr<Entry> entry;
+        string dir;
+        {
+            lock_guard<mutex> lk(myMutex);
+            const Key key{ dim, count, sobol.scrambled(), sobol.scrambleKey() };
+            auto& e = myEntries[key];
+            if (!e) e = make_shared<Entry>();
+            entry = e;
+            dir = myDir;
+        }
+
+        //  Outside the lock, so other point sets are served meanwhile
+        call_once(entry->init, [&]()
+        {
+            entry->points = make_shared<const QmcPointSet>(sobol, dim, count, dir);
+        });
+
+        return entry->points;
+    }
+};
+
+//  Sobol's sequence read from the cache
+//  Paths beyond the cached count, and uniforms, are generated by Sobol
+class CachedSobol : public RNG
+{
+    //  The sequence, not initialized
+    Sobol                               mySobol;
+    //  Paths cached
+    size_t                              myCount;
+
+    size_t                              myDim;
+    shared_ptr<const QmcPointSet>       myPoints;
+    //  Current path
+    size_t                              myPath;
+
+    //  Live generator, created on demand, and its path
+    unique_ptr<Sobol>                   myLive;
+    size_t                              myLivePath;
+
+    Sobol& live()
+    {
+        if (!myLive)
+        {
+            myLive = make_unique<Sobol>(mySobol);
+            myLive->init(myDim);
+            myLivePath = 0;
+        }
+        if (myLivePath != myPath)
+        {
+            myLive->reset();
+            myLive->skipTo(unsigned(myPath));
+            myLivePath = myPath;
+        }
+        return *myLive;
+    }
+
+public:
+
+    //  count: paths to cache, typically the number of paths of the simulation
+    CachedSobol(const size_t count, const Sobol& sobol = Sobol()) :
+        mySobol(sobol), myCount(count), myDim(0), myPath(0), myLivePath(0) {}
+
+    CachedSobol(const CachedSobol& rhs) :
+        mySobol(rhs.mySobol), myCount(rhs.myCount), myDim(rhs.myDim),
+        myPoints(rhs.myPoints), myPath(rhs.myPath), myLivePath(0) {}
+
+    unique_ptr<RNG> clone() const override
+    {
+        return make_unique<CachedSobol>(*this);
+    }
+
+    //  Scrambled sequence, see Sobol::substream()
+    unique_ptr<RNG> substream(const uint64_t key) const override
+    {
+        const auto stream = mySobol.substream(key);
+        return make_unique<CachedSobol>(myCount, static_cast<const Sobol&>(*stream));
+    }
+
+    void init(const size_t simDim) override
+    {
+        myDim = simDim;
+        myPoints = QmcCache::instance().get(mySobol, simDim, myCount);
+        myPath = 0;
+        myLive.reset();
+    }
+
+    void nextU(vector<double>& uVec) override
+    {
+        live().nextU(uVec);
+        ++myPath;
+        ++myLivePath;
+    }
+
+    void nextG(vector<double>& gaussVec) override
+    {
+        if (myPath < myCount)
+        {
+            const double* points = (*myPoints)[myPath];
+            copy(points, points + myDim, gaussVec.begin());
+            ++myPath;
+        }
+        else
+        {
+            live().nextG(gaussVec);
+            ++myPath;
+            ++myLivePath;
+        }
+    }
+
+    void skipTo(const unsigned b) override
+    {
+        myPath = b;
+    }
+};
@@ -0,0 +1,223 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Mergeable quantile sketch of Karnin, Lang and Liberty (KLL, 2016)
+//  Holds a stack of compactors, level h holding items of weight 2^h
+//  When the sketch is full, the lowest full level is sorted
+//      and every other item is promoted to the next level
+//  Memory is bounded by about 3k items whatever the number of observations,
+//      and the rank error of a quantile is about 1.7 / k
+//  Sketches built on separate streams merge into the sketch of the union
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+using namespace std;
+
+class QuantileSketch
+{
+    //  Accuracy parameter, capacity of the top level
+    size_t                  myK;
+
+    //  Compactors
+    vector<vector<double>>  myLevels;
+    //  Items held, and their total capacity
+    size_t                  mySize;
+    size_t                  myCapacity;
+
+    //  Observations
+    size_t                  myCount;
+    double                  mySum;
+    double                  myMin, myMax;
+
+    //  Deterministic coin for the offsets of compactions (xorshift)
+    uint64_t                myCoin;
+
+    bool flip()
+    {
+        myCoin ^= myCoin << 13;
+        myCoin ^= myCoin >> 7;
+        myCoin ^= myCoin << 17;
+        return myCoin & 1;
+    }
+
+    //  Capacity decreases geometrically with depth below the top level
+    size_t capacity(const size_t level) const
+    {
+        const size_t depth = myLevels.size() - 1 - level;
+        return max<size_t>(2, size_t(ceil(myK * pow(2.0 / 3.0, double(depth)))));
+    }
+
+    void updateCapacity()
+    {
+        myCapacity = 0;
+        for (size_t h = 0; h < myLevels.size(); ++h) myCapacity += capacity(h);
+    }
+
+    //  Compact until the items fit
+    void compress()
+    {
+        while (mySize >= myCapacity)
+        {
+            //  Lowest full level, there is one since the sketch is full
+            size_t h = 0;
+            while (myLevels[h].size() < capacity(h)) ++h;
+
+            if (h + 1 == myLevels.size())
+            {
+                myLevels.emplace_back();
+                updateCapacity();
+            }
+
+            vector<double>& level = myLevels[h];
+            vector<double>& next = myLevels[h + 1];
+
+            sort(level.begin(), level.end());
+
+            //  With an odd number of items, the largest one stays
+            const bool odd = level.size() & 1;
+            const size_t n = level.size() - odd;
+
+            for (size_t i = flip(); i < n; i += 2) next.push_back(level[i]);
+            mySize -= n / 2;
+
+            if (odd) level.front() = level.back();
+            level.resize(odd);
+        }
+    }
+
+public:
+
+    QuantileSketch(const size_t k = 1000) :
+        myK(max<size_t>(k, 8)),
+        myLevels(1),
+        mySize(0),
+        myCount(0),
+        mySum(0.0),
+        myMin(numeric_limits<double>::infinity()),
+        myMax(-numeric_limits<double>::infinity()),
+        myCoin(0x9E3779B97F4A7C15ull)
+    {
+        updateCapacity();
+    }
+
+    void add(const double x)
+    {
+        myLevels[0].push_back(x);
+        ++mySize;
+        ++myCount;
+        mySum += x;
+        myMin = min(myMin, x);
+        myMax = max(myMax, x);
+
+        if (mySize >= myCapacity) compress();
+    }
+
+    //  Merge a sketch with the same k
+    void merge(const QuantileSketch& rhs)
+    {
+        if (rhs.myK != myK) throw runtime_error("QuantileSketch : merging sketches of different sizes");
+        if (!rhs.myCount) return;
+
+        if (rhs.myLevels.size() > myLevels.size())
+        {
+            myLevels.resize(rhs.myLevels.size());
+            updateCapacity();
+        }
+        for (size_t h = 0; h < rhs.myLevels.size(); ++h)
+        {
+            myLevels[h].insert(myLevels[h].end(), rhs.myLevels[h].begin(), rhs.myLevels[h].end());
+        }
+
+        mySize += rhs.mySize;
+        myCount += rhs.myCount;
+        mySum += rhs.mySum;
+        myMin = min(myMin, rhs.myMin);
+        myMax = max(myMax, rhs.myMax);
+
+        compress();
+    }
+
+    size_t k() const
+    {
+        return myK;
+    }
+
+    size_t count() const
+    {
+        return myCount;
+    }
+
+    double mean() const
+    {
+        return myCount ? mySum / myCount : 0.0;
+    }
+
+    double minimum() const
+    {
+        return myMin;
+    }
+
+    double maximum() const
+    {
+        return myMax;
+    }
+
+    //  Smallest observation x such that a proportion q of observations is <= x,
+    //      exact until the first compaction
+    double quantile(const double q) const
+    {
+        if (!myCount) throw runtime_error("QuantileSketch : no observations");
+        if (q <= 0.0) return myMin;
+        if (q >= 1.0) return myMax;
+
+        //  Weighted items
+        vector<pair<double, size_t>> items;
+        items.reserve(mySize);
+        for (size_t h = 0; h < myLevels.size(); ++h)
+        {
+            for (const double x : myLevels[h]) items.emplace_back(x, size_t(1) << h);
+        }
+        sort(items.begin(), items.end());
+
+        //  Total weight may differ from count by the rounding of compactions
+        size_t total = 0;
+        for (const auto& item : items) total += item.second;
+
+        const double target = q * total;
+        size_t cumul = 0;
+        for (const auto& item : items)
+        {
+            cumul += item.second;
+            if (cumul >= target) return item.first;
+        }
+        return myMax;
+    }
+
+    //  Normalized rank error of quantile(),
+    //      with 99% confidence (empirical fit of Apache DataSketches)
+    //  0 while the sketch is exact
+    double rankError() const
+    {
+        if (myLevels.size() == 1) return 0.0;
+        return 2.296 / pow(double(myK), 0.9723);
+    }
+};
@@ -0,0 +1,66 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Random number streams keyed by trade
+//  A trade draws its random numbers from the substream of the generator,
+//      see RNG::substream(), keyed by the seed, the trade id and the model id
+//  The results of a trade are then reproducible whatever else is simulated with it,
+//      in a book or alone, and don't shift when trades are added or removed
+//  Within the substream, skipTo() positions the batches of parallel simulations as usual
+
+#include "mcBase.h"
+#include <string>
+
+class RngStreams
+{
+    const uint64_t  mySeed;
+
+    //  FNV-1a hash of a string
+    static uint64_t hash(const string& s)
+    {
+        uint64_t h = 0xCBF29CE484222325ull;
+        for (const char c : s)
+        {
+            h ^= uint64_t(static_cast<unsigned char>(c));
+            h *= 0x100000001B3ull;
+        }
+        return h;
+    }
+
+public:
+
+    RngStreams(const uint64_t seed) : mySeed(seed) {}
+
+    //  Seeds of mrg32k3a
+    RngStreams(const unsigned seed1, const unsigned seed2) :
+        mySeed((uint64_t(seed1) << 32) | seed2) {}
+
+    //  Key of the stream of a trade
+    //  Never 0, the key of the generator's own sequence
+    uint64_t key(const string& tradeId, const string& modelId) const
+    {
+        const uint64_t k = splitmix64(splitmix64(splitmix64(mySeed) ^ hash(tradeId)) ^ hash(modelId));
+        return k ? k : 1;
+    }
+
+    //  Generator of the stream of a trade, same type and seed as rng
+    unique_ptr<RNG> stream(const RNG& rng, const string& tradeId, const string& modelId) const
+    {
+        return rng.substream(key(tradeId, modelId));
+    }
+};
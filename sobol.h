@@ -43,6 +43,21 @@ class Sobol : public RNG
     //      direction number of dimension dim
     const unsigned * const *    jkDir;
 
+    //  Substreams: random digital shift of the points, see substream()
+    bool                        myScrambled = false;
+    uint64_t                    myScrambleKey = 0;
+    //  one shift per dimension, set on init
+    vector<unsigned>            myShift;
+
+    void setShift()
+    {
+        myShift.resize(myDim);
+        for (size_t i = 0; i < myDim; ++i)
+        {
+            myShift[i] = unsigned(splitmix64(myScrambleKey ^ splitmix64(i)) >> 32);
+        }
+    }
+
 public:
 
     //  Virtual copy constructor
@@ -51,6 +66,32 @@ public:
         return make_unique<Sobol>(*this);
     }
 
+    //  Substreams are digital shifts of the sequence, 
+    //      the integer points XORed with a random shift per dimension, keyed by key
+    //  Shifted points keep the equidistribution of the sequence 
+    //      and are read at the centre of their cell, so never 0 or 1
+    //  Shifted sequences are not independent like mrg32k3a's substreams,
+    //      but every key gets its own randomization of the point set
+    unique_ptr<RNG> substream(const uint64_t key) const override
+    {
+        auto stream = make_unique<Sobol>(*this);
+        stream->myScrambled = true;
+        stream->myScrambleKey = splitmix64(myScrambleKey ^ key);
+        if (!stream->myState.empty()) stream->setShift();
+        return stream;
+    }
+
+    //  Identity of the sequence, for caches of points, see qmcCache.h
+    bool scrambled() const
+    {
+        return myScrambled;
+    }
+
+    uint64_t scrambleKey() const
+    {
+        return myScrambleKey;
+    }
+
     //  Initializer 
     void init(const size_t simDim) override
     {
@@ -60,6 +101,7 @@ public:
         //  Dimension
         myDim = simDim;
         myState.resize(myDim);
+        if (myScrambled) setShift();
 
         //  Reset to 0
         reset();
@@ -102,6 +144,13 @@ public:
 	void nextU(vector<double>& uVec) override
 	{
 		next();
+		if (myScrambled)
+		{
+			transform(myState.begin(), myState.end(), myShift.begin(), uVec.begin(),
+				[](const unsigned long i, const unsigned long s)
+					{return ONEOVER2POW32 * ((i ^ s) + 0.5); });
+			return;
+		}
 		transform(myState.begin(), myState.end(), uVec.begin(),
 			[](const unsigned long i) 
 				{return ONEOVER2POW32 * i; });
@@ -110,6 +159,13 @@ public:
 	void nextG(vector<double>& gaussVec) override
     {
 		next();
+		if (myScrambled)
+		{
+			transform(myState.begin(), myState.end(), myShift.begin(), gaussVec.begin(),
+				[](const unsigned long i, const unsigned long s)
+					{return invNormalCdf(ONEOVER2POW32 * ((i ^ s) + 0.5)); });
+			return;
+		}
 		transform(myState.begin(), myState.end(), gaussVec.begin(),
 			[](const unsigned long i) 
 				{return invNormalCdf(ONEOVER2POW32 * i); });
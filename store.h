@@ -60,13 +60,17 @@ void putDupire(
     //  spot major
     const matrix<double>&   vols,
     const double            maxDt,
-    const string&           store)
+    const string&           store,
+    //  adaptive stepping tolerance, 0 = uniform steps
+    const double            tolerance = 0.0,
+    //  trapezoidal scheme in time, Euler otherwise
+    const bool              trapezoid = false)
 {
     //  We create 2 models, one for valuation and one for risk
     unique_ptr<Model<double>> mdl = make_unique<Dupire<double>>(
-        spot, spots, times, vols, maxDt);
+        spot, spots, times, vols, maxDt, tolerance, trapezoid);
     unique_ptr<Model<Number>> riskMdl = make_unique<Dupire<Number>>(
-        spot, spots, times, vols, maxDt);
+        spot, spots, times, vols, maxDt, tolerance, trapezoid);
 
     //  And move them into the map
     modelStore[store] = make_pair(move(mdl), move(riskMdl));
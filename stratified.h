@@ -0,0 +1,210 @@
+
+/*
+Written by Antoine Savine in 2018
+
+This code is the strict IP of Antoine Savine
+
+License to use and alter this code for personal and commercial applications
+is freely granted to any person or company who purchased a copy of the book
+
+Modern Computational Finance: AAD and Parallel Simulations
+Antoine Savine
+Wiley, 2018
+
+As long as this comment is preserved at the top of the file
+*/
+
+#pragma once
+
+//  Stratified sampling and Latin hypercubes over mrg32k3a
+
+//  Paths are grouped in blocks of numStrata consecutive paths
+//  Within a block, every stratified dimension visits each of
+//      the numStrata equiprobable strata of [0,1) exactly once,
+//      in an order given by a pseudo-random permutation
+//      of the path index within the block,
+//      keyed by the seeds, the dimension and the block
+//  The uniform within the stratum comes from mrg32k3a
+//  The stratum of a path is a deterministic function of its index,
+//      so skipTo() is exact and parallel simulations
+//      reproduce serial ones
+
+//  The plain average over paths is the stratified estimator
+//      when numPath is a multiple of numStrata,
+//      a partial last block only contributes standard Monte-Carlo noise
+
+//  Which dimensions benefit depends on the model
+//  In Black-Scholes, a single maturity European only has one dimension,
+//      stratifying it stratifies the terminal spot
+//  Schemes that generate the path with a Brownian bridge
+//      draw the terminal point from the leading dimension
+
+#include "mrg32k3a.h"
+#include <cstdint>
+
+class Stratified : public RNG
+{
+    //  Uniforms within strata
+    mrg32k3a                myBase;
+    //  Key of the permutations, not const for substreams
+    uint64_t                mySeed;
+
+    //  Number of strata = paths per block
+    const size_t            myNumStrata;
+
+    //  Stratified dimensions as specified, negative from the end, empty = all
+    const vector<int>       mySpec;
+    //  Resolved on init
+    size_t                  myDim;
+    vector<bool>            myStratified;
+
+    //  Index of the next path
+    size_t                  myPath;
+
+    //  Working memory
+    vector<double>          myU;
+
+    //  Bijections on [0, 2^bits)
+    static uint64_t mix(uint64_t x, const uint64_t key, const uint64_t mask)
+    {
+        for (int round = 0; round < 3; ++round)
+        {
+            x = (x ^ key) & mask;
+            x = (x * 0x9E3779B97F4A7C15ull + (key >> 17)) & mask;
+            x ^= x >> 7;
+            x = (x * 0xBF58476D1CE4E5B9ull) & mask;
+            x ^= x >> 11;
+        }
+        return x;
+    }
+
+    //  Permutation of [0, n), cycle walking
+    //      the bijection on the smallest power of 2 >= n
+    static size_t permute(const size_t i, const size_t n, const uint64_t key)
+    {
+        uint64_t mask = 1;
+        while (mask < n) mask <<= 1;
+        --mask;
+
+        uint64_t x = i;
+        do
+        {
+            x = mix(x, key, mask);
+        } while (x >= n);
+
+        return size_t(x);
+    }
+
+    //  Stratum of the current path in a dimension
+    size_t stratum(const size_t dim) const
+    {
+        const size_t block = myPath / myNumStrata;
+        const uint64_t key = splitmix64(splitmix64(splitmix64(mySeed) ^ dim) ^ block);
+        return permute(myPath % myNumStrata, myNumStrata, key);
+    }
+
+public:
+
+    //  dims: stratified dimensions, negative from the end:
+    //      { -1 } stratifies the terminal dimension, { 0 } the leading one
+    //      empty stratifies all dimensions, a Latin hypercube per block
+    Stratified(
+        const size_t            numStrata,
+        const vector<int>&      dims = { -1 },
+        const unsigned          a = 12345,
+        const unsigned          b = 12346) :
+        myBase(a, b),
+        mySeed(a * 2654435761u ^ b),
+        myNumStrata(numStrata),
+        mySpec(dims),
+        myDim(0),
+        myPath(0)
+    {
+        if (numStrata < 1) throw runtime_error("Stratified : at least one stratum required");
+    }
+
+    //  Virtual copy constructor
+    unique_ptr<RNG> clone() const override
+    {
+        return make_unique<Stratified>(*this);
+    }
+
+    //  Substream: uniforms from the substream of mrg32k3a, 
+    //      and permutations keyed by the key
+    unique_ptr<RNG> substream(const uint64_t key) const override
+    {
+        auto stream = clone();
+        auto& stratified = static_cast<Stratified&>(*stream);
+        stratified.myBase.jumpSubstreams(key);
+        stratified.mySeed = splitmix64(mySeed ^ splitmix64(key));
+        return stream;
+    }
+
+    //  Initializer
+    void init(const size_t simDim) override
+    {
+        myBase.init(simDim);
+        myDim = simDim;
+        myU.resize(simDim);
+        myPath = 0;
+
+        myStratified.assign(simDim, mySpec.empty());
+        for (const int d : mySpec)
+        {
+            const int dim = d < 0 ? int(simDim) + d : d;
+            if (dim < 0 || dim >= int(simDim))
+            {
+                throw runtime_error("Stratified : dimension out of range");
+            }
+            myStratified[dim] = true;
+        }
+    }
+
+    void nextU(vector<double>& uVec) override
+    {
+        myBase.nextU(uVec);
+
+        for (size_t i = 0; i < myDim; ++i)
+        {
+            if (myStratified[i])
+            {
+                uVec[i] = (stratum(i) + uVec[i]) / myNumStrata;
+            }
+        }
+
+        ++myPath;
+    }
+
+    void nextG(vector<double>& gaussVec) override
+    {
+        nextU(myU);
+        transform(myU.begin(), myU.end(), gaussVec.begin(), invNormalCdf);
+    }
+
+    //  Skip ahead
+    void skipTo(const unsigned b) override
+    {
+        myBase.skipTo(b);
+        myPath = b;
+    }
+};
+
+//  Latin hypercube of numPoints points:
+//      all dimensions stratified over all the paths
+//  For a simulation, numPoints should be numPath
+class LatinHypercube : public Stratified
+{
+public:
+
+    LatinHypercube(
+        const size_t            numPoints,
+        const unsigned          a = 12345,
+        const unsigned          b = 12346) :
+        Stratified(numPoints, {}, a, b) {}
+
+    //  Virtual copy constructor
+    unique_ptr<RNG> clone() const override
+    {
+        return make_unique<LatinHypercube>(*this);
+    }
+};
@@ -18,8 +18,17 @@ As long as this comment is preserved at the top of the file
 
 //  Thread pool of chapter 3
 
+//  The pool may be resized while calculations run, see resize():
+//      calculations must not index workspace by threadNum(),
+//      but spawn their tasks in a TaskGroup of limited concurrency
+//      and lease workspace from WorkspaceSlots, see below
+
 #include <future>
 #include <thread>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+#include <memory>
 #include "ConcurrentQueue.h"
 
 using namespace std;
@@ -27,44 +36,201 @@ using namespace std;
 typedef packaged_task<bool(void)> Task;
 typedef future<bool> TaskHandle;
 
+//  Priority classes, served in this order at task (batch) granularity
+//  foreground: synchronous calculations, the caller helps while it waits
+//  interactive, batch: asynchronous jobs, see main.h, 
+//      the controller of the job helps while it waits, see activeWait()
+enum class TaskPriority
+{
+    foreground = 0,
+    interactive = 1,
+    batch = 2
+};
+
+//  Limits the concurrency of a set of tasks, like the batches of one calculation
+//  At most limit tasks of the group are queued or running at a time,
+//      the others wait in the group and are queued as running ones complete,
+//      at the back of their priority lane
+class TaskGroup
+{
+    const size_t            myLimit;
+
+    mutex                   myMutex;
+    size_t                  myInFlight;
+    queue<pair<Task, size_t>> myPending;
+
+    friend class ThreadPool;
+
+public:
+
+    TaskGroup(const size_t limit) : myLimit(max<size_t>(1, limit)), myInFlight(0) {}
+
+    size_t limit() const
+    {
+        return myLimit;
+    }
+};
+
+//  Workspace of a calculation, one slot per task that may run concurrently
+//  Tasks lease a slot for their duration and use the workspace of that slot
+//  The tasks must be spawned in a TaskGroup limited to the number of slots
+class WorkspaceSlots
+{
+    mutex                   myMutex;
+    vector<size_t>          myFree;
+
+public:
+
+    WorkspaceSlots(const size_t n)
+    {
+        //  Slot 0 leased first
+        for (size_t i = n; i > 0; --i) myFree.push_back(i - 1);
+    }
+
+    class Lease
+    {
+        WorkspaceSlots&     mySlots;
+        const size_t        mySlot;
+
+    public:
+
+        Lease(WorkspaceSlots& slots) : mySlots(slots), mySlot(slots.acquire()) {}
+        ~Lease() { mySlots.release(mySlot); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        operator size_t() const
+        {
+            return mySlot;
+        }
+    };
+
+    Lease lease()
+    {
+        return Lease(*this);
+    }
+
+private:
+
+    size_t acquire()
+    {
+        lock_guard<mutex> lk(myMutex);
+        if (myFree.empty()) throw runtime_error("WorkspaceSlots : more concurrent tasks than slots");
+        const size_t slot = myFree.back();
+        myFree.pop_back();
+        return slot;
+    }
+
+    void release(const size_t slot)
+    {
+        lock_guard<mutex> lk(myMutex);
+        myFree.push_back(slot);
+    }
+};
+
 class ThreadPool 
 {
 	//	The one and only instance
 	static ThreadPool myInstance;
 
-	//	The task queue
-    ConcurrentQueue<Task> myQueue;
+	//	The task queue, one lane per priority class
+    ConcurrentQueue<Task, 3> myQueue;
 
 	//	The threads
-	vector<thread> myThreads;
+    //  Retired workers finish their current task and exit,
+    //      they are joined on the next resize() or stop()
+    struct Worker
+    {
+        size_t          num;
+        atomic<bool>    retired;
+        atomic<bool>    finished;
+        thread          handle;
+
+        Worker(const size_t n) : num(n), retired(false), finished(false) {}
+    };
+	vector<unique_ptr<Worker>> myWorkers;
+    //  Guards myWorkers
+    mutex myResizeMutex;
+    //  Workers not retired
+    atomic<size_t> myNumThreads;
 
     //  Active indicator
     bool myActive;
 
 	//	Interruption indicator
-	bool myInterrupt;
+	atomic<bool> myInterrupt;
 
 	//	Thread number
 	static thread_local size_t myTLSNum;
 
 	//	The function that is executed on every thread
-	void threadFunc(const size_t num)
+	void threadFunc(Worker* worker)
 	{
-		myTLSNum = num;
+		myTLSNum = worker->num;
 
 		Task t;
 
-		//	"Infinite" loop, only broken on destruction
-		while (!myInterrupt) 
+		//	"Infinite" loop, only broken on destruction or retirement
+		while (!myInterrupt && !worker->retired) 
 		{
 			//	Pop and executes tasks
-			myQueue.pop(t);
-			if (!myInterrupt) t();			
+			if (myQueue.pop(t, [worker] { return bool(worker->retired); }) && !myInterrupt) t();
 		}
+
+        worker->finished = true;
 	}
 
+    //  Join the retired workers that finished, call under myResizeMutex
+    void reap()
+    {
+        for (auto it = myWorkers.begin(); it != myWorkers.end();)
+        {
+            if ((*it)->finished)
+            {
+                (*it)->handle.join();
+                it = myWorkers.erase(it);
+            }
+            else ++it;
+        }
+    }
+
+    //  Queue a task of a group, once it may run
+    void pushInGroup(const shared_ptr<TaskGroup>& group, Task t, const size_t level)
+    {
+        {
+            lock_guard<mutex> lk(group->myMutex);
+            if (group->myInFlight >= group->myLimit)
+            {
+                group->myPending.emplace(move(t), level);
+                return;
+            }
+            ++group->myInFlight;
+        }
+        myQueue.push(move(t), level);
+    }
+
+    //  Called by the tasks of a group on completion: queue the next one
+    void completeInGroup(TaskGroup& group)
+    {
+        Task next;
+        size_t level;
+        {
+            lock_guard<mutex> lk(group.myMutex);
+            if (group.myPending.empty())
+            {
+                --group.myInFlight;
+                return;
+            }
+            next = move(group.myPending.front().first);
+            level = group.myPending.front().second;
+            group.myPending.pop();
+        }
+        myQueue.push(move(next), level);
+    }
+
     //  The constructor stays private, ensuring single instance
-    ThreadPool() : myActive(false), myInterrupt(false) {}
+    ThreadPool() : myNumThreads(0), myActive(false), myInterrupt(false) {}
 
 public:
 
@@ -72,9 +238,20 @@ public:
 	static ThreadPool* getInstance() { return &myInstance; }
 
 	//	Number of threads
-	size_t numThreads() const { return myThreads.size(); }
+	size_t numThreads() const { return myNumThreads; }
+
+    //  Number of tasks of a calculation that may run at the same time:
+    //      the worker threads and the caller, capped by maxThreads unless 0
+    //  Calculations size their workspace and TaskGroup with it,
+    //      threads added later serve the next calculations
+    size_t concurrency(const size_t maxThreads = 0) const
+    {
+        const size_t n = numThreads() + 1;
+        return maxThreads ? min(n, maxThreads) : n;
+    }
 
 	//	The number of the caller thread
+    //  Unique among running threads, but may exceed numThreads() after a resize
 	static size_t threadNum() { return myTLSNum; }
 
 	//	Starter
@@ -82,16 +259,61 @@ public:
 	{
         if (!myActive)  //  Only start once
         {
-            myThreads.reserve(nThread);
-
-            //	Launch threads on threadFunc and keep handles in a vector
-            for (size_t i = 0; i < nThread; i++)
-                myThreads.push_back(thread(&ThreadPool::threadFunc, this, i + 1));
-
             myActive = true;
+
+            resize(nThread);
         }
 	}
 
+    //  Change the number of worker threads while calculations run
+    //  New workers start serving the queue at once
+    //  Retired workers complete their current task first, 
+    //      resize() does not wait for them
+    void resize(const size_t nThread)
+    {
+        if (!myActive)
+        {
+            start(nThread);
+            return;
+        }
+
+        lock_guard<mutex> lk(myResizeMutex);
+        reap();
+
+        vector<Worker*> active;
+        for (auto& w : myWorkers) if (!w->retired) active.push_back(w.get());
+
+        if (nThread > active.size())
+        {
+            //  Smallest numbers not in use, 0 is for threads outside the pool
+            vector<bool> used(myWorkers.size() + nThread + 1, false);
+            used[0] = true;
+            for (auto& w : myWorkers) if (w->num < used.size()) used[w->num] = true;
+
+            size_t num = 0;
+            for (size_t i = active.size(); i < nThread; ++i)
+            {
+                while (used[num]) ++num;
+                used[num] = true;
+                myWorkers.push_back(make_unique<Worker>(num));
+                Worker* w = myWorkers.back().get();
+                w->handle = thread(&ThreadPool::threadFunc, this, w);
+            }
+        }
+        else if (nThread < active.size())
+        {
+            //  Retire the workers with the highest numbers
+            sort(active.begin(), active.end(), 
+                [](const Worker* a, const Worker* b) { return a->num > b->num; });
+            for (size_t i = 0; i < active.size() - nThread; ++i) active[i]->retired = true;
+
+            //  Wake idle workers so they see it
+            myQueue.wakeAll();
+        }
+
+        myNumThreads = nThread;
+    }
+
 	//	Destructor
     ~ThreadPool()
     {
@@ -108,11 +330,15 @@ public:
             //	Interrupt all waiting threads
             myQueue.interrupt();
 
-            //	Wait for them all to join
-            for_each(myThreads.begin(), myThreads.end(), mem_fn(&thread::join));
+            //	Wait for them all to join, including retired ones
+            {
+                lock_guard<mutex> lk(myResizeMutex);
+                for (auto& w : myWorkers) w->handle.join();
 
-            //  Clear all threads
-            myThreads.clear();
+                //  Clear all threads
+                myWorkers.clear();
+                myNumThreads = 0;
+            }
 
             //  Clear the queue and reset interrupt
             myQueue.clear();
@@ -134,18 +360,44 @@ public:
 
 	//	Spawn task
 	template<typename Callable>
-	TaskHandle spawnTask(Callable c)
+	TaskHandle spawnTask(Callable c, const TaskPriority priority = TaskPriority::foreground)
 	{
 		Task t(move(c));
 		TaskHandle f = t.get_future();
-		myQueue.push(move(t));
+		myQueue.push(move(t), static_cast<size_t>(priority));
+		return f;
+	}
+
+    //  Spawn task in a group
+    //  The group is shared with the queued tasks,
+    //      which complete after their future is ready
+	template<typename Callable>
+	TaskHandle spawnTask(
+        Callable                        c, 
+        const TaskPriority              priority, 
+        const shared_ptr<TaskGroup>&    group)
+	{
+        auto task = make_shared<Task>(move(c));
+		TaskHandle f = task->get_future();
+        Task t([this, task, group]()
+        {
+            (*task)();
+            completeInGroup(*group);
+            return true;
+        });
+        pushInGroup(group, move(t), static_cast<size_t>(priority));
 		return f;
 	}
 
 	//	Run queued tasks synchronously 
 	//	while waiting on a future, 
 	//	return true if at least one task was run
-	bool activeWait(const TaskHandle& f)
+    //  The waiting thread helps with the tasks of the priority of its calculation, or higher:
+    //      synchronous calculations with foreground tasks,
+    //      the controllers of asynchronous jobs with the batches of their lane
+    //  So jobs complete even when the pool is resized to no workers
+    //  Tasks lease their workspace and set their own AAD context, any thread may run them
+	bool activeWait(const TaskHandle& f, const TaskPriority priority = TaskPriority::foreground)
 	{
 		Task t;
 		bool b = false;
@@ -156,14 +408,16 @@ public:
 		while (f.wait_for(0s) != future_status::ready)
 		{
 			//	Non blocking
-			if (myQueue.tryPop(t)) 
+			if (myQueue.tryPop(t, static_cast<size_t>(priority))) 
 			{
 				t();
 				b = true;
 			}
 			else //	Nothing in the queue: go to sleep
 			{
-				f.wait();
+                //  Not for good: tasks of a group are queued as others complete,
+                //      and if the pool was resized to no workers, we run them
+				f.wait_for(1ms);
 			}
 		}
 
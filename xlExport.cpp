@@ -18,9 +18,10 @@ As long as this comment is preserved at the top of the file
 
 #pragma warning(disable:4996)
 
-#include "ThreadPool.h"
+#include "threadPool.h"
 #include "main.h"
 #include "toyCode.h"
+#include <sstream>
 
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -65,6 +66,33 @@ NumericalParam xl2num(
     return num;
 }
 
+//  0 or omitted: pathwise, 1: likelihood ratio, 2: mixed, 
+//      3: pathwise with the model's hand-coded path adjoints
+GreekEstimator xl2estimator(
+    const double              greeks)
+{
+    const int estimator = static_cast<int>(greeks + EPS);
+    return estimator == 1 
+        ? GreekEstimator::LikelihoodRatio
+        : estimator == 2 
+            ? GreekEstimator::Mixed
+            : estimator == 3
+                ? GreekEstimator::PathwiseAdjoint
+                : GreekEstimator::Pathwise;
+}
+
+//  Sampling: strata > 1 stratifies the terminal dimension,
+//      latinHypercube > 0 samples a Latin hypercube over all dimensions
+//  Pseudo-random numbers only, see stratified.h
+void xl2sampling(
+    NumericalParam&           num,
+    const double              strata,
+    const double              latinHypercube)
+{
+    num.numStrata = strata > 1 ? static_cast<int>(strata + EPS) : 0;
+    num.latinHypercube = latinHypercube > EPS;
+}
+
 //	Wrappers
 
 //  change number of threads in the pool
@@ -79,6 +107,41 @@ double xRestartThreadPool(
     return numThread;
 }
 
+//  change number of threads in the pool without stopping running calculations
+extern "C" __declspec(dllexport)
+double xResizeThreadPool(
+    double              xNthread)
+{
+    const int numThread = max(0, int(xNthread + EPS));
+    ThreadPool::getInstance()->resize(numThread);
+
+    return numThread;
+}
+
+//  Spill tapes to disk beyond windowMB megabytes per blocklist, 0 = all in RAM
+extern "C" __declspec(dllexport)
+double xSetTapeOutOfCore(
+    double              windowMB,
+    LPXLOPER12          xdir)
+{
+    if (windowMB < 0.0) return -1;
+
+    setTapeOutOfCore(windowMB, getString(xdir));
+
+    return windowMB;
+}
+
+//  Cache the Gaussians of Sobol's sequence, in memory and in files in dir if given
+extern "C" __declspec(dllexport)
+double xSetQmcCache(
+    double              enabled,
+    LPXLOPER12          xdir)
+{
+    setQmcCache(enabled > EPS, getString(xdir));
+
+    return enabled > EPS;
+}
+
 extern "C" __declspec(dllexport)
  LPXLOPER12 xPutDupire(
     //  model parameters
@@ -87,14 +150,17 @@ extern "C" __declspec(dllexport)
     FP12*               times,
     FP12*               vols,
     double              maxDt,
-    LPXLOPER12          xid)
+    LPXLOPER12          xid,
+    //  optional numerical parameters
+    double              tolerance,
+    double              trapezoid)
 {
     FreeAllTempMemory();
 
     const string id = getString(xid);
 
     //  Make sure we have an id
-    if (maxDt <= 0.0 || id.empty()) return TempErr12(xlerrNA);
+    if (maxDt <= 0.0 || tolerance < 0.0 || id.empty()) return TempErr12(xlerrNA);
 
     //  Unpack
 
@@ -108,7 +174,7 @@ extern "C" __declspec(dllexport)
     matrix<double> vvols = to_matrix(vols);
 
     //  Call and return
-    putDupire(spot, vspots, vtimes, vvols, maxDt, id);
+    putDupire(spot, vspots, vtimes, vvols, maxDt, id, tolerance, trapezoid > EPS);
 
     return TempStr12(id);
 }
@@ -550,7 +616,12 @@ LPXLOPER12 xValue(
     double              seed1,
     double              seed2,
     double              numPath,
-    double              parallel)
+    double              parallel,
+    //  optional sampling
+    double              strata,
+    double              latinHypercube,
+    //  optional threads generating Gaussians
+    double              generators)
 {
     FreeAllTempMemory();
 
@@ -571,7 +642,9 @@ LPXLOPER12 xValue(
     if (!mdl) return TempErr12(xlerrNA);
 
     //  Numerical params
-    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    xl2sampling(num, strata, latinHypercube);
+    num.generatorThreads = generators > EPS ? static_cast<int>(generators + EPS) : 0;
     //  Make sure we have a numPath
     if (!num.numPath) return TempErr12(xlerrNA);
 
@@ -650,7 +723,14 @@ LPXLOPER12 xAADrisk(
     double              seed1,
     double              seed2,
     double              numPath,
-    double              parallel)
+    double              parallel,
+    //  greek estimator
+    double              greeks,
+    //  optional sampling
+    double              strata,
+    double              latinHypercube,
+    //  optional groups of paths for standard errors, in a third column
+    double              errorBatches)
 {
     FreeAllTempMemory();
 
@@ -663,7 +743,10 @@ LPXLOPER12 xAADrisk(
     if (mid.empty()) return TempErr12(xlerrNA);
 
     //  Numerical params
-    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    num.estimator = xl2estimator(greeks);
+    xl2sampling(num, strata, latinHypercube);
+    num.riskErrorBatches = errorBatches > EPS ? static_cast<int>(errorBatches + EPS) : 0;
     //  Make sure we have a numPath
     if (!num.numPath) return TempErr12(xlerrNA);
 
@@ -674,17 +757,20 @@ LPXLOPER12 xAADrisk(
     {
         auto results = AADriskOne(mid, pid, num, riskPayoff);
 		const size_t n = results.risks.size(), N = n + 1;
+        const bool errors = !results.riskErrors.empty();
 
         LPXLOPER12 oper = TempXLOPER12();
-        resize(oper, N, 2);
+        resize(oper, N, errors ? 3 : 2);
 
         setString(oper, "value", 0, 0);
         setNum(oper, results.riskPayoffValue, 0, 1);
+        if (errors) setString(oper, "std error", 0, 2);
 
         for (size_t i = 0; i < n; ++i)
         {
             setString(oper, results.paramIds[i], i + 1, 0);
             setNum(oper, results.risks[i], i + 1, 1);
+            if (errors) setNum(oper, results.riskErrors[i], i + 1, 2);
         }
 
         return oper;
@@ -706,7 +792,9 @@ LPXLOPER12 xAADriskAggregate(
     double              seed1,
     double              seed2,
     double              numPath,
-    double              parallel)
+    double              parallel,
+    //  greek estimator
+    double              greeks)
 {
     FreeAllTempMemory();
 
@@ -719,7 +807,8 @@ LPXLOPER12 xAADriskAggregate(
     if (mid.empty()) return TempErr12(xlerrNA);
 
     //  Numerical params
-    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    num.estimator = xl2estimator(greeks);
     //  Make sure we have a numPath
     if (!num.numPath) return TempErr12(xlerrNA);
 
@@ -770,6 +859,135 @@ LPXLOPER12 xAADriskAggregate(
     }
 }
 
+//  Book of trades, one model and one product per trade, see mcBook.h
+//  Reads the ids in pairs, skipping blank rows
+bool xl2book(
+    LPXLOPER12          modelids,
+    LPXLOPER12          productids,
+    vector<string>&     modelIds,
+    vector<string>&     productIds)
+{
+    const vector<string> mids = to_strVector(modelids);
+    const vector<string> pids = to_strVector(productids);
+    if (mids.size() != pids.size()) return false;
+
+    for (size_t i = 0; i < mids.size(); ++i)
+    {
+        if (mids[i].empty() && pids[i].empty()) continue;
+        if (mids[i].empty() || pids[i].empty()) return false;
+        modelIds.push_back(mids[i]);
+        productIds.push_back(pids[i]);
+    }
+
+    return !modelIds.empty();
+}
+
+//  Values of all the payoffs of all the trades, labelled productId.payoffId
+extern "C" __declspec(dllexport)
+LPXLOPER12 xValueBook(
+    LPXLOPER12          modelids,
+    LPXLOPER12          productids,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    //  optional pilot paths per trade to schedule the longest trades first
+    double              pilot,
+    //  optional: every trade draws its own substream, independent of the book
+    double              tradeStreams)
+{
+    FreeAllTempMemory();
+
+    vector<string> mids, pids;
+    if (!xl2book(modelids, productids, mids, pids)) return TempErr12(xlerrNA);
+
+    //  Numerical params
+    auto num = xl2num(useSobol, seed1, seed2, numPath, 1.0);
+    num.tradeStreams = tradeStreams > EPS;
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    const size_t nPilot = pilot > EPS ? static_cast<size_t>(pilot + EPS) : 4;
+
+    try
+    {
+        auto results = valueBook(mids, pids, num, nPilot);
+
+        vector<string> labels;
+        vector<double> values;
+        for (size_t i = 0; i < pids.size(); ++i)
+        {
+            for (size_t j = 0; j < results.values[i].size(); ++j)
+            {
+                labels.push_back(pids[i] + "." + results.identifiers[i][j]);
+                values.push_back(results.values[i][j]);
+            }
+        }
+
+        return from_labelsAndNumbers(labels, values);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+//  AAD risk of the book, the aggregate of every trade is its first payoff
+//  Value of the book, then risks labelled modelId.parameterId
+extern "C" __declspec(dllexport)
+LPXLOPER12 xAADriskBook(
+    LPXLOPER12          modelids,
+    LPXLOPER12          productids,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    //  greek estimator
+    double              greeks,
+    //  optional pilot paths per trade to schedule the longest trades first
+    double              pilot,
+    //  optional: every trade draws its own substream, independent of the book
+    double              tradeStreams)
+{
+    FreeAllTempMemory();
+
+    vector<string> mids, pids;
+    if (!xl2book(modelids, productids, mids, pids)) return TempErr12(xlerrNA);
+
+    //  Numerical params
+    auto num = xl2num(useSobol, seed1, seed2, numPath, 1.0);
+    num.estimator = xl2estimator(greeks);
+    num.tradeStreams = tradeStreams > EPS;
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    const size_t nPilot = pilot > EPS ? static_cast<size_t>(pilot + EPS) : 4;
+
+    try
+    {
+        auto results = AADriskBook(mids, pids, num, {}, nPilot);
+
+        vector<string> labels = { "value" };
+        vector<double> values = { results.bookValue };
+        for (size_t m = 0; m < results.modelIds.size(); ++m)
+        {
+            for (size_t j = 0; j < results.risks[m].size(); ++j)
+            {
+                labels.push_back(results.modelIds[m] + "." + results.paramIds[m][j]);
+                values.push_back(results.risks[m][j]);
+            }
+        }
+
+        return from_labelsAndNumbers(labels, values);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
 unordered_map<string, RiskReports> riskStore;
 
 extern "C" __declspec(dllexport)
@@ -872,150 +1090,693 @@ LPXLOPER12 xAADriskMulti(
     }
 }
 
+//  Sparse: one row per non-zero sensitivity, labelled "param / payoff"
 extern "C" __declspec(dllexport)
-LPXLOPER12 xDisplayRisk(
-    LPXLOPER12          riskid,
-    LPXLOPER12          displayid)
+LPXLOPER12 xAADriskMultiSparse(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    double              parallel)
 {
     FreeAllTempMemory();
 
-    RiskReports* results;
-    const string riskId = getString(riskid);
-    const auto& it = riskStore.find(riskId);
-    if (it == riskStore.end()) return TempErr12(xlerrNA);
-    else results = &it->second;
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
 
-    const vector<string> riskIds = to_strVector(displayid);
-    
-    vector<size_t> riskCols;
-    
-    for (const auto& id : riskIds)
-    {
-        auto it2 = find(results->payoffs.begin(), results->payoffs.end(), id);
-        if (it2 == results->payoffs.end()) return TempErr12(xlerrNA);
-        riskCols.push_back(distance(results->payoffs.begin(), it2));
-    }
-    if (riskCols.empty()) return TempErr12(xlerrNA);
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
 
-    const size_t nParam = results->risks.rows();
-    const size_t nPayoffs = riskCols.size();
+    //  Numerical params
+    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
 
-    vector<double> showVals(nPayoffs);
-    matrix<double> showRisks(nParam, nPayoffs);
-    for (size_t j = 0; j < nPayoffs; ++j)
+    try
     {
-        for (size_t i = 0; i < nParam; ++i)
+        const auto results = AADriskMultiSparse(mid, pid, num);
+        const auto& risks = results.risks;
+
+        vector<string> labels;
+        vector<double> numbers;
+        labels.reserve(risks.nonZeros());
+        numbers.reserve(risks.nonZeros());
+        for (size_t i = 0; i < risks.rows; ++i)
         {
-            showRisks[i][j] = results->risks[i][riskCols[j]];
+            for (size_t k = risks.rowStart[i]; k < risks.rowStart[i + 1]; ++k)
+            {
+                labels.push_back(results.params[i] + " / " + results.payoffs[risks.colIdx[k]]);
+                numbers.push_back(risks.values[k]);
+            }
         }
-        showVals[j] = results->values[riskCols[j]];
-    }
 
-    return from_labelledMatrix(results->params, riskIds, showRisks, "value", showVals);
+        return from_labelsAndNumbers(labels, numbers);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
 }
 
+//  Error of float derivatives on tape: one row per payoff
 extern "C" __declspec(dllexport)
- LPXLOPER12 xDupireCalib(
-    //  Merton market parameters
-    const double spot,
-    const double vol,
-    const double jmpIntens,
-    const double jmpAverage,
-    const double jmpStd,
-    //  Discretization
-    FP12* spots,
-    const double maxDs,
-    FP12* times,
-    const double maxDt)
+LPXLOPER12 xPrecisionReport(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    double              parallel)
 {
     FreeAllTempMemory();
 
-    //  Make sure the last input is given
-    if (maxDs == 0 || maxDt == 0) return 0;
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
 
-    //  Unpack
-    vector<double> vspots;
-    {
-        size_t rows = spots->rows;
-        size_t cols = spots->columns;
-        double* numbers = spots->array;
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
 
-        vspots.resize(rows*cols);
-        copy(numbers, numbers + rows*cols, vspots.begin());
-    }
+    //  Numerical params
+    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
 
-    vector<double> vtimes;
+    try
     {
-        size_t rows = times->rows;
-        size_t cols = times->columns;
-        double* numbers = times->array;
-
-        vtimes.resize(rows*cols);
-        copy(numbers, numbers + rows*cols, vtimes.begin());
-    }
+        const auto results = precisionReport(mid, pid, num);
 
-    auto results = dupireCalib(vspots, maxDs, vtimes, maxDt,
-        spot, vol, jmpIntens, jmpAverage, jmpStd);
+        const size_t nPay = results.payoffs.size();
+        matrix<double> report(nPay, 3);
+        for (size_t j = 0; j < nPay; ++j)
+        {
+            report[j][0] = results.maxRisks[j];
+            report[j][1] = results.maxErrors[j];
+            report[j][2] = results.relErrors[j];
+        }
 
-    //  Return
-    return from_labelledMatrix(results.spots, results.times, results.lVols);
+        return from_labelledMatrix(results.payoffs, { "max risk", "max error", "relative error" }, report);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
 }
 
+//  Quantiles of the payoffs: means, quantiles of probabilities probs and rank error
 extern "C" __declspec(dllexport)
- LPXLOPER12 xDupireSuperbucket(
-    //  Merton market parameters
-    const double spot,
-    const double vol,
-    const double jmpIntens,
-    const double jmpAverage,
-    const double jmpStd,
-    //  risk view
-    FP12* strikes,
-    FP12* mats,
-    //  calibration
-    FP12* spots,
-    double maxDs,
-    FP12* times,
-    double maxDtVol,
-    //  MC
-    double              maxDtSimul,
-    //  product 
+LPXLOPER12 xQuantiles(
+    LPXLOPER12          modelid,
     LPXLOPER12          productid,
-    LPXLOPER12          xPayoffs,
-    FP12*               xNotionals,
+    FP12*               probs,
     //  numerical parameters
     double              useSobol,
     double              seed1,
     double              seed2,
     double              numPath,
     double              parallel,
-    //  bump or AAD?
-    double              bump)
-
+    //  sketch accuracy, 0 = default
+    double              k)
 {
     FreeAllTempMemory();
 
-    //  Make sure the last input is given
-    if (numPath <= 0) return TempErr12(xlerrNA);
-
-    //  Make sure we have a product
     const string pid = getString(productid);
     //  Make sure we have an id
     if (pid.empty()) return TempErr12(xlerrNA);
 
-    //  Unpack
-    vector<double> vstrikes = to_vector(strikes);
-    vector<double> vmats = to_vector(mats);
-    vector<double> vspots = to_vector(spots);
-    vector<double> vtimes = to_vector(times);
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
 
     //  Numerical params
     const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
     //  Make sure we have a numPath
     if (!num.numPath) return TempErr12(xlerrNA);
 
-    //  Payoffs and notionals, removing blanks
-    map<string, double> notionals;
+    const vector<double> vprobs = to_vector(probs);
+    if (vprobs.empty()) return TempErr12(xlerrNA);
+
+    try
+    {
+        const auto results = quantiles(mid, pid, num, vprobs, 
+            k > 1 ? size_t(k + EPS) : 1000);
+
+        const size_t nPay = results.identifiers.size(), nProbs = vprobs.size();
+        vector<string> cols(nProbs + 2);
+        cols.front() = "mean";
+        for (size_t i = 0; i < nProbs; ++i)
+        {
+            ostringstream label;
+            label << "q " << vprobs[i];
+            cols[i + 1] = label.str();
+        }
+        cols.back() = "rank error";
+
+        matrix<double> report(nPay, nProbs + 2);
+        for (size_t j = 0; j < nPay; ++j)
+        {
+            report[j][0] = results.values[j];
+            for (size_t i = 0; i < nProbs; ++i) report[j][i + 1] = results.quantiles[j][i];
+            report[j][nProbs + 1] = results.rankErrors[j];
+        }
+
+        return from_labelledMatrix(results.identifiers, cols, report);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+//  Pre-flight estimate of wall time and memory
+//  calculation: 0 = value, 1 = AAD risk, 2 = AAD risk of all payoffs
+extern "C" __declspec(dllexport)
+LPXLOPER12 xEstimateCost(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    double              calculation,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    double              parallel,
+    //  pilot paths, 0 = default
+    double              pilot)
+{
+    FreeAllTempMemory();
+
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
+
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
+
+    //  Numerical params
+    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    const int calc = static_cast<int>(calculation + EPS);
+    if (calc < 0 || calc > 2) return TempErr12(xlerrNA);
+
+    try
+    {
+        const auto est = estimateCost(mid, pid, num, static_cast<CostedCalculation>(calc),
+            pilot >= 1 ? size_t(pilot + EPS) : 16);
+
+        return from_labelsAndNumbers(
+            { "simDim", "pre-mark nodes", "nodes per path", "args per path", "adjoint width",
+                "setup seconds", "seconds per path", "threads", "concurrency",
+                "wall seconds", "tape MB", "results MB", "peak MB" },
+            { double(est.simDim), double(est.preMarkNodes), double(est.nodesPerPath), 
+                double(est.argsPerPath), double(est.adjointWidth),
+                est.setupSeconds, est.secondsPerPath, double(est.threads), double(est.concurrency),
+                est.wallSeconds, est.tapeBytes / 1048576.0, est.resultBytes / 1048576.0, 
+                est.peakBytes / 1048576.0 });
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+//  Asynchronous risk jobs, by id
+struct XlJob
+{
+    AsyncJob<RiskReports>   job;
+    vector<string>          payoffs;
+};
+unordered_map<string, XlJob> jobStore;
+
+//  Submit a risk report in the background, return the job id at once
+//  method: 0 = AAD, 1 = bumps
+extern "C" __declspec(dllexport)
+LPXLOPER12 xSubmitJob(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    //  AAD or bumps
+    double              method,
+    //  batch priority, else interactive
+    double              batch,
+    LPXLOPER12          jobid,
+    //  optional cap on the threads of the pool working on the job
+    double              maxThreads)
+{
+    FreeAllTempMemory();
+
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
+
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
+
+    const string jobId = getString(jobid);
+    if (jobId.empty()) return TempErr12(xlerrNA);
+
+    const auto* prd = getProduct<double>(pid);
+    if (!prd) return TempErr12(xlerrNA);
+
+    //  Numerical params
+    auto num = xl2num(useSobol, seed1, seed2, numPath, 1.0);
+    num.maxThreads = maxThreads > EPS ? static_cast<int>(maxThreads + EPS) : 0;
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    const TaskPriority priority = batch > 0.5 ? TaskPriority::batch : TaskPriority::interactive;
+
+    try
+    {
+        //  Cancel the previous job with this id, if any
+        auto it = jobStore.find(jobId);
+        if (it != jobStore.end()) it->second.job.cancel();
+
+        auto job = method > 0.5 
+            ? submitBumpRisk(mid, pid, num, priority) 
+            : submitAADriskMulti(mid, pid, num, priority);
+        jobStore[jobId] = { job, prd->payoffLabels() };
+
+        return jobid;
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+//  Progress of a job, with the estimates of the payoffs so far
+extern "C" __declspec(dllexport)
+LPXLOPER12 xJobProgress(
+    LPXLOPER12          jobid)
+{
+    FreeAllTempMemory();
+
+    const auto it = jobStore.find(getString(jobid));
+    if (it == jobStore.end()) return TempErr12(xlerrNA);
+    const XlJob& xlJob = it->second;
+
+    const auto estimates = xlJob.job.estimates();
+
+    vector<string> labels = { "batches done", "batches total", "progress", "paths", "ready" };
+    vector<double> numbers = { 
+        double(xlJob.job.batchesDone()), 
+        double(xlJob.job.batchesTotal()), 
+        xlJob.job.progress(), 
+        double(estimates.numPaths),
+        xlJob.job.ready() ? 1.0 : 0.0 };
+    for (size_t i = 0; i < estimates.values.size() && i < xlJob.payoffs.size(); ++i)
+    {
+        labels.push_back(xlJob.payoffs[i]);
+        numbers.push_back(estimates.values[i]);
+        labels.push_back(xlJob.payoffs[i] + " std error");
+        numbers.push_back(estimates.stdErrs[i]);
+    }
+
+    return from_labelsAndNumbers(labels, numbers);
+}
+
+extern "C" __declspec(dllexport)
+LPXLOPER12 xCancelJob(
+    LPXLOPER12          jobid)
+{
+    FreeAllTempMemory();
+
+    const auto it = jobStore.find(getString(jobid));
+    if (it == jobStore.end()) return TempErr12(xlerrNA);
+
+    it->second.job.cancel();
+
+    return jobid;
+}
+
+//  Result of a completed job, #N/A until then
+extern "C" __declspec(dllexport)
+LPXLOPER12 xJobResult(
+    LPXLOPER12          jobid,
+    //  display now or put in memory?
+    double              displayNow,
+    LPXLOPER12          storeid)
+{
+    FreeAllTempMemory();
+
+    const auto it = jobStore.find(getString(jobid));
+    if (it == jobStore.end() || !it->second.job.ready()) return TempErr12(xlerrNA);
+
+    try
+    {
+        const auto& results = it->second.job.get();
+        if (displayNow > 0.5)
+        {
+            return from_labelledMatrix(results.params, results.payoffs, results.risks, "value", results.values);
+        }
+        else
+        {
+            const string riskId = getString(storeid);
+            if (riskId == "") return TempErr12(xlerrNA);
+            riskStore[riskId] = results;
+            return storeid;
+        }
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+extern "C" __declspec(dllexport)
+LPXLOPER12 xPdeRisk(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    //  numerical parameters
+    double              numX,
+    double              numT,
+    double              numStd,
+    //  display now or put in memory?
+    double              displayNow,
+    LPXLOPER12          storeid)
+{
+    FreeAllTempMemory();
+
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
+
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
+
+    //  Numerical params, defaults when omitted
+    PdeParam pde;
+    if (numX > 0.5) pde.numX = static_cast<size_t>(numX + EPS);
+    if (numT > 0.5) pde.numT = static_cast<size_t>(numT + EPS);
+    if (numStd > EPS) pde.numStd = numStd;
+
+    try
+    {
+        auto results = pdeRisk(mid, pid, pde);
+        if (displayNow > 0.5)
+        {
+            return from_labelledMatrix(results.params, results.payoffs, results.risks, "value", results.values);
+        }
+        else
+        {
+            const string riskId = getString(storeid);
+            if (riskId == "") return TempErr12(xlerrNA);
+            riskStore[riskId] = results;
+            return storeid;
+        }
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+extern "C" __declspec(dllexport)
+LPXLOPER12 xForwardStats(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    double              parallel,
+    //  which statistics: event date index and levels or increments
+    double              dateIdx,
+    double              increments,
+    //  optional: parameter id, for AAD risk of the statistics
+    LPXLOPER12          paramid)
+{
+    FreeAllTempMemory();
+
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
+
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
+
+    const auto* prd = getProduct<double>(pid);
+    const auto* mdl = getModel<double>(mid);
+    if (!prd || !mdl) return TempErr12(xlerrNA);
+
+    //  Numerical params
+    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    const size_t t = static_cast<size_t>(dateIdx + EPS);
+    const bool incs = increments > EPS;
+    const string param = getString(paramid);
+
+    try
+    {
+        const MomentStats* stats;
+        StatsSimulResults results;
+
+        if (param.empty())
+        {
+            results = forwardStats(mid, pid, num);
+            stats = incs ? &results.increments : &results.levels;
+        }
+        else
+        {
+            const vector<string>& params = mdl->parameterLabels();
+            auto it = find(params.begin(), params.end(), param);
+            if (it == params.end()) return TempErr12(xlerrNA);
+            const size_t j = distance(params.begin(), it);
+
+            results = AADforwardStats(mid, pid, num);
+            stats = incs ? &results.incrementRisks[j] : &results.levelRisks[j];
+        }
+
+        if (t >= stats->means.size()) return TempErr12(xlerrNA);
+
+        return from_labelledMatrix(prd->assetNames(), prd->assetNames(), stats->covs[t], "mean", stats->means[t]);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+extern "C" __declspec(dllexport)
+LPXLOPER12 xDisplayRisk(
+    LPXLOPER12          riskid,
+    LPXLOPER12          displayid)
+{
+    FreeAllTempMemory();
+
+    RiskReports* results;
+    const string riskId = getString(riskid);
+    const auto& it = riskStore.find(riskId);
+    if (it == riskStore.end()) return TempErr12(xlerrNA);
+    else results = &it->second;
+
+    const vector<string> riskIds = to_strVector(displayid);
+    
+    vector<size_t> riskCols;
+    
+    for (const auto& id : riskIds)
+    {
+        auto it2 = find(results->payoffs.begin(), results->payoffs.end(), id);
+        if (it2 == results->payoffs.end()) return TempErr12(xlerrNA);
+        riskCols.push_back(distance(results->payoffs.begin(), it2));
+    }
+    if (riskCols.empty()) return TempErr12(xlerrNA);
+
+    const size_t nParam = results->risks.rows();
+    const size_t nPayoffs = riskCols.size();
+
+    vector<double> showVals(nPayoffs);
+    matrix<double> showRisks(nParam, nPayoffs);
+    for (size_t j = 0; j < nPayoffs; ++j)
+    {
+        for (size_t i = 0; i < nParam; ++i)
+        {
+            showRisks[i][j] = results->risks[i][riskCols[j]];
+        }
+        showVals[j] = results->values[riskCols[j]];
+    }
+
+    return from_labelledMatrix(results->params, riskIds, showRisks, "value", showVals);
+}
+
+extern "C" __declspec(dllexport)
+ LPXLOPER12 xDupireCalib(
+    //  Merton market parameters
+    const double spot,
+    const double vol,
+    const double jmpIntens,
+    const double jmpAverage,
+    const double jmpStd,
+    //  Discretization
+    FP12* spots,
+    const double maxDs,
+    FP12* times,
+    const double maxDt)
+{
+    FreeAllTempMemory();
+
+    //  Make sure the last input is given
+    if (maxDs == 0 || maxDt == 0) return 0;
+
+    //  Unpack
+    vector<double> vspots;
+    {
+        size_t rows = spots->rows;
+        size_t cols = spots->columns;
+        double* numbers = spots->array;
+
+        vspots.resize(rows*cols);
+        copy(numbers, numbers + rows*cols, vspots.begin());
+    }
+
+    vector<double> vtimes;
+    {
+        size_t rows = times->rows;
+        size_t cols = times->columns;
+        double* numbers = times->array;
+
+        vtimes.resize(rows*cols);
+        copy(numbers, numbers + rows*cols, vtimes.begin());
+    }
+
+    auto results = dupireCalib(vspots, maxDs, vtimes, maxDt,
+        spot, vol, jmpIntens, jmpAverage, jmpStd);
+
+    //  Return
+    return from_labelledMatrix(results.spots, results.times, results.lVols);
+}
+
+extern "C" __declspec(dllexport)
+LPXLOPER12 xDupireConvergence(
+    LPXLOPER12          modelid,
+    LPXLOPER12          productid,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    double              parallel,
+    //  uniform max dts and adaptive tolerances to test, 0 entries ignored
+    FP12*               maxDts,
+    FP12*               tolerances,
+    //  payoff, first one if omitted
+    LPXLOPER12          payoffid)
+{
+    FreeAllTempMemory();
+
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
+
+    const string mid = getString(modelid);
+    //  Make sure we have an id
+    if (mid.empty()) return TempErr12(xlerrNA);
+
+    //  Numerical params
+    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    vector<double> vdts = to_vector(maxDts), vtols = to_vector(tolerances);
+    vdts.erase(remove_if(vdts.begin(), vdts.end(), [](const double x) { return x <= 0.0; }), vdts.end());
+    vtols.erase(remove_if(vtols.begin(), vtols.end(), [](const double x) { return x <= 0.0; }), vtols.end());
+
+    try
+    {
+        auto results = dupireConvergence(mid, pid, vdts, vtols, num, getString(payoffid));
+
+        matrix<double> table(results.labels.size(), 2);
+        for (size_t i = 0; i < table.rows(); ++i)
+        {
+            table[i][0] = results.steps[i];
+            table[i][1] = results.values[i];
+        }
+
+        return from_labelledMatrix(results.labels, { "steps", "value" }, table);
+    }
+    catch (const exception&)
+    {
+        return TempErr12(xlerrNA);
+    }
+}
+
+extern "C" __declspec(dllexport)
+ LPXLOPER12 xDupireSuperbucket(
+    //  Merton market parameters
+    const double spot,
+    const double vol,
+    const double jmpIntens,
+    const double jmpAverage,
+    const double jmpStd,
+    //  risk view
+    FP12* strikes,
+    FP12* mats,
+    //  calibration
+    FP12* spots,
+    double maxDs,
+    FP12* times,
+    double maxDtVol,
+    //  MC
+    double              maxDtSimul,
+    //  product 
+    LPXLOPER12          productid,
+    LPXLOPER12          xPayoffs,
+    FP12*               xNotionals,
+    //  numerical parameters
+    double              useSobol,
+    double              seed1,
+    double              seed2,
+    double              numPath,
+    double              parallel,
+    //  bump or AAD?
+    double              bump)
+
+{
+    FreeAllTempMemory();
+
+    //  Make sure the last input is given
+    if (numPath <= 0) return TempErr12(xlerrNA);
+
+    //  Make sure we have a product
+    const string pid = getString(productid);
+    //  Make sure we have an id
+    if (pid.empty()) return TempErr12(xlerrNA);
+
+    //  Unpack
+    vector<double> vstrikes = to_vector(strikes);
+    vector<double> vmats = to_vector(mats);
+    vector<double> vspots = to_vector(spots);
+    vector<double> vtimes = to_vector(times);
+
+    //  Numerical params
+    const auto num = xl2num(useSobol, seed1, seed2, numPath, parallel);
+    //  Make sure we have a numPath
+    if (!num.numPath) return TempErr12(xlerrNA);
+
+    //  Payoffs and notionals, removing blanks
+    map<string, double> notionals;
     {
         size_t rows = getRows(xPayoffs);
         size_t cols = getCols(xPayoffs);;
@@ -1108,6 +1869,43 @@ double xMerton(double spot, double vol, double mat, double strike, double intens
     return merton(spot, strike, vol, mat, intens, meanJmp, stdJmp);
 }
 
+//  Series against COS, see mertonComparison() in main.h
+extern "C" __declspec(dllexport)
+LPXLOPER12 xMertonComparison(
+    double              spot, 
+    double              vol, 
+    double              mat, 
+    double              intens, 
+    double              meanJmp, 
+    double              stdJmp,
+    FP12*               strikes,
+    double              numTerms)
+{
+    FreeAllTempMemory();
+
+    const vector<double> vstrikes = to_vector(strikes);
+    if (vstrikes.empty() || mat <= 0.0) return TempErr12(xlerrNA);
+
+    const size_t terms = numTerms > 0.5 ? static_cast<size_t>(numTerms + EPS) : 256;
+    const auto results = mertonComparison(spot, vol, mat, intens, meanJmp, stdJmp, vstrikes, terms);
+
+    //  Strikes in rows, then timings
+    const size_t n = vstrikes.size();
+    vector<string> rows(n + 1);
+    matrix<double> prices(n + 1, 2);
+    for (size_t i = 0; i < n; ++i)
+    {
+        rows[i] = to_string(vstrikes[i]);
+        prices[i][0] = results.series[i];
+        prices[i][1] = results.cos[i];
+    }
+    rows[n] = "time (ms)";
+    prices[n][0] = results.seriesTime;
+    prices[n][1] = results.cosTime;
+
+    return from_labelledMatrix(rows, { "series", "cos" }, prices);
+}
+
 extern "C" __declspec(dllexport)
 double xBarrierBlackScholes(double spot, double rate, double div, double vol, double mat, double strike, double barrier)
 {
@@ -1273,6 +2071,42 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
         (LPXLOPER12)TempStr12(L"Restarts the thread pool with n threads"),
         (LPXLOPER12)TempStr12(L""));
 
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xResizeThreadPool"),
+        (LPXLOPER12)TempStr12(L"BB"),
+        (LPXLOPER12)TempStr12(L"xResizeThreadPool"),
+        (LPXLOPER12)TempStr12(L"numThreads"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Resizes the thread pool to n threads while calculations run"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xSetTapeOutOfCore"),
+        (LPXLOPER12)TempStr12(L"BBQ"),
+        (LPXLOPER12)TempStr12(L"xSetTapeOutOfCore"),
+        (LPXLOPER12)TempStr12(L"windowMB, [dir]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Keeps windowMB of every tape block list in RAM and spills the rest to a temporary file"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xSetQmcCache"),
+        (LPXLOPER12)TempStr12(L"BBQ"),
+        (LPXLOPER12)TempStr12(L"xSetQmcCache"),
+        (LPXLOPER12)TempStr12(L"enabled, [dir]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Caches the Gaussians of Sobol's sequence, in memory and in files in dir"),
+        (LPXLOPER12)TempStr12(L""));
+
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xPutBlackScholes"),
         (LPXLOPER12)TempStr12(L"QBBBBBQ"),
@@ -1311,9 +2145,9 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
 
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xPutDupire"),
-        (LPXLOPER12)TempStr12(L"QBK%K%K%BQ"),
+        (LPXLOPER12)TempStr12(L"QBK%K%K%BQBB"),
         (LPXLOPER12)TempStr12(L"xPutDupire"),
-        (LPXLOPER12)TempStr12(L"spot, spots, times, vols, maxDt, id"),
+        (LPXLOPER12)TempStr12(L"spot, spots, times, vols, maxDt, id, [tolerance], [trapezoid]"),
         (LPXLOPER12)TempStr12(L"1"),
         (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
         (LPXLOPER12)TempStr12(L""),
@@ -1431,9 +2265,9 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
 
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xValue"),
-        (LPXLOPER12)TempStr12(L"QQQBBBBB"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBBBB"),
         (LPXLOPER12)TempStr12(L"xValue"),
-        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [Parallel]"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [Parallel], [strata], [LatinHypercube], [generators]"),
         (LPXLOPER12)TempStr12(L"1"),
         (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
         (LPXLOPER12)TempStr12(L""),
@@ -1455,9 +2289,9 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
 	
 	Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xAADrisk"),
-        (LPXLOPER12)TempStr12(L"QQQQBBBBB"),
+        (LPXLOPER12)TempStr12(L"QQQQBBBBBBBBB"),
         (LPXLOPER12)TempStr12(L"xAADrisk"),
-        (LPXLOPER12)TempStr12(L"modelId, productId, riskPayoff, useSobol, [seed1], [seed2], N, [Parallel]"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, riskPayoff, useSobol, [seed1], [seed2], N, [Parallel], [greeks], [strata], [LatinHypercube], [errorBatches]"),
         (LPXLOPER12)TempStr12(L"1"),
         (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
         (LPXLOPER12)TempStr12(L""),
@@ -1467,9 +2301,9 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
 
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xAADriskAggregate"),
-        (LPXLOPER12)TempStr12(L"QQQQK%BBBBB"),
+        (LPXLOPER12)TempStr12(L"QQQQK%BBBBBB"),
         (LPXLOPER12)TempStr12(L"xAADriskAggregate"),
-        (LPXLOPER12)TempStr12(L"modelId, productId, payoffs, notionals, useSobol, [seed1], [seed2], N, [Parallel]"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, payoffs, notionals, useSobol, [seed1], [seed2], N, [Parallel], [greeks]"),
         (LPXLOPER12)TempStr12(L"1"),
         (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
         (LPXLOPER12)TempStr12(L""),
@@ -1477,6 +2311,30 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
         (LPXLOPER12)TempStr12(L"AAD risk report for aggregate book of payoffs"),
         (LPXLOPER12)TempStr12(L""));
 
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xValueBook"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBB"),
+        (LPXLOPER12)TempStr12(L"xValueBook"),
+        (LPXLOPER12)TempStr12(L"modelIds, productIds, useSobol, [seed1], [seed2], N, [pilot], [tradeStreams?]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Values a book of trades in one parallel simulation"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xAADriskBook"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBBB"),
+        (LPXLOPER12)TempStr12(L"xAADriskBook"),
+        (LPXLOPER12)TempStr12(L"modelIds, productIds, useSobol, [seed1], [seed2], N, [greeks], [pilot], [tradeStreams?]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"AAD risk report of a book of trades in one parallel simulation"),
+        (LPXLOPER12)TempStr12(L""));
+
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xBumprisk"),
         (LPXLOPER12)TempStr12(L"QQQBBBBBBQ"),
@@ -1501,6 +2359,126 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
         (LPXLOPER12)TempStr12(L"AAD risk report for multiple payoffs"),
         (LPXLOPER12)TempStr12(L""));
 
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xAADriskMultiSparse"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBB"),
+        (LPXLOPER12)TempStr12(L"xAADriskMultiSparse"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [Parallel]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Non-zero AAD risks for multiple payoffs"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xPrecisionReport"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBB"),
+        (LPXLOPER12)TempStr12(L"xPrecisionReport"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [Parallel]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Error on AAD risks of float derivatives on tape"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xQuantiles"),
+        (LPXLOPER12)TempStr12(L"QQQK%BBBBBB"),
+        (LPXLOPER12)TempStr12(L"xQuantiles"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, probs, useSobol, [seed1], [seed2], N, [Parallel], [k]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Quantiles of the payoffs with streaming sketches"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xEstimateCost"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBBB"),
+        (LPXLOPER12)TempStr12(L"xEstimateCost"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, calculation, useSobol, [seed1], [seed2], N, [Parallel], [pilot]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Pre-flight estimate of time and memory"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xSubmitJob"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBBQB"),
+        (LPXLOPER12)TempStr12(L"xSubmitJob"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [bumps?], [batch?], jobId, [maxThreads]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Submit a risk report to run in the background"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xJobProgress"),
+        (LPXLOPER12)TempStr12(L"QQ"),
+        (LPXLOPER12)TempStr12(L"xJobProgress"),
+        (LPXLOPER12)TempStr12(L"jobId"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Progress and partial estimates of a background job"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xCancelJob"),
+        (LPXLOPER12)TempStr12(L"QQ"),
+        (LPXLOPER12)TempStr12(L"xCancelJob"),
+        (LPXLOPER12)TempStr12(L"jobId"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Cancel a background job"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xJobResult"),
+        (LPXLOPER12)TempStr12(L"QQBQ"),
+        (LPXLOPER12)TempStr12(L"xJobResult"),
+        (LPXLOPER12)TempStr12(L"jobId, [display?], [storeId]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Risk report of a completed background job"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xPdeRisk"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBQ"),
+        (LPXLOPER12)TempStr12(L"xPdeRisk"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, [numX], [numT], [numStd], [display?], [storeId]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"PDE risk report for single asset products in Black-Scholes or Dupire"),
+        (LPXLOPER12)TempStr12(L""));
+
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xForwardStats"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBBBQ"),
+        (LPXLOPER12)TempStr12(L"xForwardStats"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [Parallel], dateIdx, [increments?], [paramId]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Means and covariances of forwards, or their AAD risk to a parameter"),
+        (LPXLOPER12)TempStr12(L""));
+
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xDisplayRisk"),
         (LPXLOPER12)TempStr12(L"QQQ"),
@@ -1537,6 +2515,18 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
         (LPXLOPER12)TempStr12(L"Calibrates Dupire"),
         (LPXLOPER12)TempStr12(L""));
 
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xDupireConvergence"),
+        (LPXLOPER12)TempStr12(L"QQQBBBBBK%K%Q"),
+        (LPXLOPER12)TempStr12(L"xDupireConvergence"),
+        (LPXLOPER12)TempStr12(L"modelId, productId, useSobol, [seed1], [seed2], N, [Parallel], maxDts, tolerances, [payoffId]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Dupire value against number of time steps, uniform and adaptive"),
+        (LPXLOPER12)TempStr12(L""));
+
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xMerton"),
         (LPXLOPER12)TempStr12(L"BBBBBBBB"),
@@ -1549,6 +2539,18 @@ extern "C" __declspec(dllexport) int xlAutoOpen(void)
         (LPXLOPER12)TempStr12(L"Merton"),
         (LPXLOPER12)TempStr12(L""));
 
+    Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
+        (LPXLOPER12)TempStr12(L"xMertonComparison"),
+        (LPXLOPER12)TempStr12(L"QBBBBBBK%B"),
+        (LPXLOPER12)TempStr12(L"xMertonComparison"),
+        (LPXLOPER12)TempStr12(L"spot, vol, mat, intens, meanJmp, stdJmp, strikes, [numTerms]"),
+        (LPXLOPER12)TempStr12(L"1"),
+        (LPXLOPER12)TempStr12(L"myOwnCppFunctions"),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L""),
+        (LPXLOPER12)TempStr12(L"Merton calls with the series and the COS pricer, with timings"),
+        (LPXLOPER12)TempStr12(L""));
+
     Excel12f(xlfRegister, 0, 11, (LPXLOPER12)&xDLL,
         (LPXLOPER12)TempStr12(L"xBarrierBlackScholes"),
         (LPXLOPER12)TempStr12(L"BBBBBBBB"),